@@ -0,0 +1,523 @@
+// Connect Four
+// Author: Scott Helms
+
+// bench times the game primitives and the search without the terminal. Every
+// result is printed as one line of "key value" pairs so runs of different
+// versions can be compared by a script.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitboard.h"
+#include "eval.h"
+#include "game.h"
+#include "search.h"
+#include "selfplay.h"
+#include "slab.h"
+#include "solver.h"
+#include "transposition.h"
+#include "winbatch.h"
+
+/*** Define ***/
+
+// A benchmark runs for at least BENCH_MIN_NS, doubling the iterations until
+// it does.
+#define BENCH_MIN_NS 200000000
+// BENCH_BATCH_BOARDS boards are checked per call of the batch win checks.
+#define BENCH_BATCH_BOARDS 4096
+#define BENCH_POSITIONS 64
+#define BENCH_SEED 12345
+#define BENCH_SEARCH_DEPTH 18
+// The searches with evaluated leaves cut off far less, so they stop earlier.
+#define BENCH_EVAL_DEPTH 14
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+/*** Structures ***/
+
+typedef struct BenchState {
+  TerminalSettings terminal_settings;
+  // states holds BENCH_POSITIONS game states, reset once all are taken.
+  SlabPool states;
+  // games holds positions from random games, none of them won yet.
+  GameData games[BENCH_POSITIONS];
+  GameData empty_game;
+  // batch_masks holds every position of random games played to the end in
+  // structure of arrays layout, for the batch win checks.
+  bitboard batch_masks[2][BENCH_BATCH_BOARDS];
+  WinBatch batch;
+  uint8_t batch_wins[BENCH_BATCH_BOARDS];
+} BenchState;
+
+// BenchFunction runs the operation iterations times and returns a checksum of
+// the results, so the compiler cannot drop the work.
+typedef uint64_t (*BenchFunction)(BenchState* state, uint64_t iterations);
+
+/*** Globals ***/
+
+// The search and solve positions are move strings picked for the default
+// board, where solve_positions are known to be a win, a loss and a draw. On
+// any other board they would not parse or not hold, so those benchmarks only
+// run on the default board.
+#if BOARD_WIDTH == 7 && BOARD_HEIGHT == 7 && CONNECT_LENGTH == 4
+#define BENCH_SEARCH 1
+// search_positions are searched to BENCH_SEARCH_DEPTH and, with evaluated
+// leaves, to BENCH_EVAL_DEPTH, solve_positions to the end of the game.
+static const char* search_positions[] = {"", "44", "4453", "1234567"};
+// solve_positions are a win, a loss and a draw for the player to move.
+static const char* solve_positions[] = {
+    "4515216243277427", "6116472265437233", "1226564252137115"};
+#endif
+
+/*** Declorations ***/
+
+// benchAllocateGameState takes a game state from the slab pool, plays a move
+// in it and returns it.
+static uint64_t benchAllocateGameState(BenchState* state, uint64_t iterations);
+
+// benchBatchWins checks one board per iteration with findBatchWins.
+static uint64_t benchBatchWins(BenchState* state, uint64_t iterations);
+
+// benchBatchWinsScalar checks one board per iteration with
+// findBatchWinsScalar.
+static uint64_t benchBatchWinsScalar(BenchState* state, uint64_t iterations);
+
+// benchConnectFourHorizontal checks the horizontal line at every cell.
+static uint64_t benchConnectFourHorizontal(BenchState* state,
+                                           uint64_t iterations);
+
+// benchConnectFourLeftDiagonal checks the left diagonal line at every cell.
+static uint64_t benchConnectFourLeftDiagonal(BenchState* state,
+                                             uint64_t iterations);
+
+// benchConnectFourPresent checks a whole board for a connect four.
+static uint64_t benchConnectFourPresent(BenchState* state,
+                                        uint64_t iterations);
+
+// benchConnectFourRightDiagonal checks the right diagonal line at every cell.
+static uint64_t benchConnectFourRightDiagonal(BenchState* state,
+                                              uint64_t iterations);
+
+// benchConnectFourVertical checks the vertical line at every cell.
+static uint64_t benchConnectFourVertical(BenchState* state,
+                                         uint64_t iterations);
+
+// benchCreateGameData builds the game data of a new game.
+static uint64_t benchCreateGameData(BenchState* state, uint64_t iterations);
+
+// benchDisplayTokens draws every token of the board into the frame buffer.
+static uint64_t benchDisplayTokens(BenchState* state, uint64_t iterations);
+
+// benchDisplayTokensDiff draws the frame after one token changed.
+static uint64_t benchDisplayTokensDiff(BenchState* state, uint64_t iterations);
+
+// benchDropToken drops one token, starting a new game once the board is full.
+static uint64_t benchDropToken(BenchState* state, uint64_t iterations);
+
+// benchEvaluatePosition scores one game's position with evaluatePosition.
+static uint64_t benchEvaluatePosition(BenchState* state, uint64_t iterations);
+
+// benchEvaluationToken updates an evaluation by one token with
+// addEvaluationToken, starting a new game once the board is full.
+static uint64_t benchEvaluationToken(BenchState* state, uint64_t iterations);
+
+// benchEvaluationScratch builds one game's evaluation with createEvaluation,
+// what addEvaluationToken saves the search at every node.
+static uint64_t benchEvaluationScratch(BenchState* state, uint64_t iterations);
+
+// createBenchState fills the state with random positions that have no connect
+// four and a batch of boards from random games played to the end.
+static void createBenchState(BenchState* state);
+
+// runBatchWins checks iterations boards, BENCH_BATCH_BOARDS per call of
+// find, and returns the number of wins.
+static uint64_t runBatchWins(BenchState* state, uint64_t iterations,
+                             void (*find)(const WinBatch*, uint8_t*));
+
+// runBenchmark times the function and prints ns/op and ops/sec.
+static void runBenchmark(const char* name, BenchFunction function,
+                         BenchState* state);
+
+// runSearchBenchmarks prints the nodes/sec of searchBestMove, without and
+// with evaluated leaves, and of solvePosition on the fixed positions. Other
+// boards than the default one print that the benchmarks are skipped.
+static void runSearchBenchmarks();
+
+/*** Functions ***/
+
+static uint64_t benchAllocateGameState(BenchState* state,
+                                       uint64_t iterations) {
+  uint64_t checksum = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameState* game = allocateSlot(&state->states);
+    if (game == NULL) {
+      resetSlabPool(&state->states);
+      game = allocateSlot(&state->states);
+    }
+    *game = createGameState();
+    playGameMove(game, i % BOARD_WIDTH);
+    checksum += game->position.player_masks[RED];
+    // Every other state goes back to the pool, the rest wait for the reset.
+    if (i % 2 == 0) {
+      freeSlot(&state->states, game);
+    }
+  }
+  return checksum;
+}
+
+static uint64_t benchBatchWins(BenchState* state, uint64_t iterations) {
+  return runBatchWins(state, iterations, findBatchWins);
+}
+
+static uint64_t benchBatchWinsScalar(BenchState* state, uint64_t iterations) {
+  return runBatchWins(state, iterations, findBatchWinsScalar);
+}
+
+static uint64_t benchConnectFourHorizontal(BenchState* state,
+                                           uint64_t iterations) {
+  uint64_t found = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameData* game = &state->games[i % BENCH_POSITIONS];
+    int cell = i % BOARD_CELLS;
+    found += connectFourHorizontal(game->array, cell / BOARD_WIDTH,
+                                   cell % BOARD_WIDTH);
+  }
+  return found;
+}
+
+static uint64_t benchConnectFourLeftDiagonal(BenchState* state,
+                                             uint64_t iterations) {
+  uint64_t found = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameData* game = &state->games[i % BENCH_POSITIONS];
+    int cell = i % BOARD_CELLS;
+    found += connectFourLeftDiagonal(game->array, cell / BOARD_WIDTH,
+                                     cell % BOARD_WIDTH);
+  }
+  return found;
+}
+
+static uint64_t benchConnectFourPresent(BenchState* state,
+                                        uint64_t iterations) {
+  uint64_t found = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    found += connectFourPresent(&state->games[i % BENCH_POSITIONS]);
+  }
+  return found;
+}
+
+static uint64_t benchConnectFourRightDiagonal(BenchState* state,
+                                              uint64_t iterations) {
+  uint64_t found = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameData* game = &state->games[i % BENCH_POSITIONS];
+    int cell = i % BOARD_CELLS;
+    found += connectFourRightDiagonal(game->array, cell / BOARD_WIDTH,
+                                      cell % BOARD_WIDTH);
+  }
+  return found;
+}
+
+static uint64_t benchConnectFourVertical(BenchState* state,
+                                         uint64_t iterations) {
+  uint64_t found = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameData* game = &state->games[i % BENCH_POSITIONS];
+    int cell = i % BOARD_CELLS;
+    found += connectFourVertical(game->array, cell / BOARD_WIDTH,
+                                 cell % BOARD_WIDTH);
+  }
+  return found;
+}
+
+static uint64_t benchCreateGameData(BenchState* state, uint64_t iterations) {
+  uint64_t checksum = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameData game = createGameData(&state->terminal_settings);
+    checksum += game.first_token_location.col + game.array[i % BOARD_HEIGHT][0];
+  }
+  return checksum;
+}
+
+static uint64_t benchDisplayTokens(BenchState* state, uint64_t iterations) {
+  uint64_t bytes = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    GameData* game = &state->games[i % BENCH_POSITIONS];
+    resetDrawnScreen(&game->drawn);
+    displayTokens(game);
+    bytes += discardFrame();
+  }
+  return bytes;
+}
+
+static uint64_t benchDisplayTokensDiff(BenchState* state, uint64_t iterations) {
+  GameData game = state->empty_game;
+  displayTokens(&game);
+  discardFrame();
+
+  uint64_t bytes = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    // The bottom left token alternates, the rest of the board stays drawn.
+    game.array[BOARD_HEIGHT - 1][0] = i % 2 == 0 ? RED : EMPTY;
+    displayTokens(&game);
+    bytes += discardFrame();
+  }
+  return bytes;
+}
+
+static uint64_t benchDropToken(BenchState* state, uint64_t iterations) {
+  GameData game = state->empty_game;
+  uint64_t dropped = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    if (game.state.position.move_counter == BOARD_CELLS) {
+      game = state->empty_game;
+      discardFrame();
+    }
+    // Stepping by 3 columns spreads the tokens over the whole board.
+    int col = (game.state.position.move_counter * 3) % BOARD_WIDTH;
+    while (!canPlay(&game.state.position, col)) {
+      col = (col + 1) % BOARD_WIDTH;
+    }
+    dropped += dropToken(&game, col);
+  }
+  discardFrame();
+  return dropped;
+}
+
+static uint64_t benchEvaluatePosition(BenchState* state, uint64_t iterations) {
+  uint64_t checksum = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    const GameData* game = &state->games[i % BENCH_POSITIONS];
+    checksum += evaluatePosition(&game->evaluation, &game->state.position);
+  }
+  return checksum;
+}
+
+static uint64_t benchEvaluationToken(BenchState* state, uint64_t iterations) {
+  Position position = state->empty_game.state.position;
+  Evaluation evaluation = state->empty_game.evaluation;
+  uint64_t checksum = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    if (position.move_counter == BOARD_CELLS) {
+      position = state->empty_game.state.position;
+      evaluation = state->empty_game.evaluation;
+    }
+    // The same columns as benchDropToken, without the drawing.
+    int col = (position.move_counter * 3) % BOARD_WIDTH;
+    while (!canPlay(&position, col)) {
+      col = (col + 1) % BOARD_WIDTH;
+    }
+    addEvaluationToken(&evaluation, &position, col);
+    playMove(&position, col);
+    checksum += evaluation.threats[RED] ^ evaluation.open_lines[YELLOW][1];
+  }
+  return checksum;
+}
+
+static uint64_t benchEvaluationScratch(BenchState* state,
+                                       uint64_t iterations) {
+  uint64_t checksum = 0;
+  uint64_t i;
+  for (i = 0; i < iterations; ++i) {
+    Evaluation evaluation =
+        createEvaluation(&state->games[i % BENCH_POSITIONS].state.position);
+    checksum += evaluation.threats[RED] ^ evaluation.open_lines[YELLOW][1];
+  }
+  return checksum;
+}
+
+static void createBenchState(BenchState* state) {
+  state->terminal_settings.successful_initialization = 0;
+  state->terminal_settings.screen_rows = 40;
+  state->terminal_settings.screen_cols = 100;
+  state->empty_game = createGameData(&state->terminal_settings);
+  if (createSlabPool(&state->states, sizeof(GameState), BENCH_POSITIONS) ==
+      -1) {
+    perror("createBenchState->createSlabPool");
+    exit(1);
+  }
+
+  uint64_t random_state = BENCH_SEED;
+  int i;
+  for (i = 0; i < BENCH_POSITIONS; ++i) {
+    GameData* game = &state->games[i];
+    *game = state->empty_game;
+    // The positions run from the opening to a nearly full board.
+    int plies = 4 + i * (BOARD_CELLS - 8) / BENCH_POSITIONS;
+    while (game->state.position.move_counter < plies) {
+      int col = nextRandom(&random_state) % BOARD_WIDTH;
+      if (!canPlay(&game->state.position, col)) {
+        continue;
+      }
+      if (isWinningMove(&game->state.position, col)) {
+        // Starts over, a won position ends the game it was dropped in.
+        *game = state->empty_game;
+        continue;
+      }
+      dropToken(game, col);
+      discardFrame();
+    }
+  }
+
+  // Games are played to the end, so the batch holds won boards as well.
+  Position position = createPosition();
+  size_t board;
+  for (board = 0; board < BENCH_BATCH_BOARDS; ++board) {
+    if (hasConnectFour(position.player_masks[RED]) ||
+        hasConnectFour(position.player_masks[YELLOW]) ||
+        isBoardFull(&position)) {
+      position = createPosition();
+    }
+    int col;
+    do {
+      col = nextRandom(&random_state) % BOARD_WIDTH;
+    } while (!canPlay(&position, col));
+    playMove(&position, col);
+    state->batch_masks[RED][board] = position.player_masks[RED];
+    state->batch_masks[YELLOW][board] = position.player_masks[YELLOW];
+  }
+  state->batch.player_masks[RED] = state->batch_masks[RED];
+  state->batch.player_masks[YELLOW] = state->batch_masks[YELLOW];
+  state->batch.count = BENCH_BATCH_BOARDS;
+}
+
+static uint64_t runBatchWins(BenchState* state, uint64_t iterations,
+                             void (*find)(const WinBatch*, uint8_t*)) {
+  uint64_t wins = 0;
+  uint64_t done;
+  for (done = 0; done < iterations; done += BENCH_BATCH_BOARDS) {
+    find(&state->batch, state->batch_wins);
+    wins += state->batch_wins[done / BENCH_BATCH_BOARDS % BENCH_BATCH_BOARDS];
+  }
+  return wins;
+}
+
+static void runBenchmark(const char* name, BenchFunction function,
+                         BenchState* state) {
+  uint64_t iterations = 1;
+  uint64_t checksum;
+  int64_t elapsed_ns;
+  while (TRUE) {
+    int64_t start_ns = currentTimeNs();
+    checksum = function(state, iterations);
+    elapsed_ns = currentTimeNs() - start_ns;
+    if (elapsed_ns >= BENCH_MIN_NS) {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  double ns_per_op = (double)elapsed_ns / iterations;
+  printf("bench %s iterations %llu ns_per_op %.2f ops_per_s %.0f checksum "
+         "%llu\n",
+         name, (unsigned long long)iterations, ns_per_op, 1e9 / ns_per_op,
+         (unsigned long long)checksum);
+  fflush(stdout);
+}
+
+static void runSearchBenchmarks() {
+#ifndef BENCH_SEARCH
+  printf("bench search skipped, its positions are for the 7x7 board with "
+         "4 in a row\n");
+#else
+  TranspositionTable table;
+  if (createTranspositionTable(&table, DEFAULT_HASH_MEGABYTES) == -1) {
+    perror("runSearchBenchmarks->createTranspositionTable");
+    exit(1);
+  }
+
+  size_t i;
+  for (i = 0; i < sizeof(search_positions) / sizeof(search_positions[0]);
+       ++i) {
+    Position position;
+    createPositionFromMoves(search_positions[i], &position);
+    SearchLimits limits = createSearchLimits(BENCH_SEARCH_DEPTH, 0);
+    clearTranspositionTable(&table);
+    SearchResult result = searchBestMove(&position, limits, &table, NULL);
+    double ns_per_node = (double)result.elapsed_ns / result.nodes;
+    printf("bench search position %s depth %d nodes %llu ns_per_op %.2f "
+           "ops_per_s %.0f move %d score %d\n",
+           search_positions[i][0] != '\0' ? search_positions[i] : "-",
+           result.depth, (unsigned long long)result.nodes, ns_per_node,
+           1e9 / ns_per_node, result.best_move + 1, result.score);
+    fflush(stdout);
+  }
+
+  for (i = 0; i < sizeof(search_positions) / sizeof(search_positions[0]);
+       ++i) {
+    Position position;
+    createPositionFromMoves(search_positions[i], &position);
+    Evaluation evaluation = createEvaluation(&position);
+    SearchLimits limits = createSearchLimits(BENCH_EVAL_DEPTH, 0);
+    limits.evaluation = &evaluation;
+    clearTranspositionTable(&table);
+    SearchResult result = searchBestMove(&position, limits, &table, NULL);
+    double ns_per_node = (double)result.elapsed_ns / result.nodes;
+    printf("bench search_eval position %s depth %d nodes %llu ns_per_op %.2f "
+           "ops_per_s %.0f move %d score %d\n",
+           search_positions[i][0] != '\0' ? search_positions[i] : "-",
+           result.depth, (unsigned long long)result.nodes, ns_per_node,
+           1e9 / ns_per_node, result.best_move + 1, result.score);
+    fflush(stdout);
+  }
+
+  for (i = 0; i < sizeof(solve_positions) / sizeof(solve_positions[0]); ++i) {
+    Position position;
+    createPositionFromMoves(solve_positions[i], &position);
+    clearTranspositionTable(&table);
+    SolveResult result;
+    solvePosition(&position, &table, &result);
+    double ns_per_node = (double)result.elapsed_ns / result.nodes;
+    printf("bench solve position %s nodes %llu ns_per_op %.2f ops_per_s %.0f "
+           "move %d score %d\n",
+           solve_positions[i], (unsigned long long)result.nodes, ns_per_node,
+           1e9 / ns_per_node, result.best_move + 1, result.score);
+    fflush(stdout);
+  }
+
+  destroyTranspositionTable(&table);
+#endif
+}
+
+/*** Main ***/
+
+int main() {
+  static BenchState state;
+  createBenchState(&state);
+
+  printf("version %s\n", BENCH_VERSION);
+  runBenchmark("createGameData", benchCreateGameData, &state);
+  runBenchmark("allocateGameState", benchAllocateGameState, &state);
+  runBenchmark("dropToken", benchDropToken, &state);
+  runBenchmark("evaluatePosition", benchEvaluatePosition, &state);
+  runBenchmark("evaluationToken", benchEvaluationToken, &state);
+  runBenchmark("evaluationScratch", benchEvaluationScratch, &state);
+  runBenchmark("connectFourPresent", benchConnectFourPresent, &state);
+  runBenchmark("connectFourHorizontal", benchConnectFourHorizontal, &state);
+  runBenchmark("connectFourLeftDiagonal", benchConnectFourLeftDiagonal,
+               &state);
+  runBenchmark("connectFourRightDiagonal", benchConnectFourRightDiagonal,
+               &state);
+  runBenchmark("connectFourVertical", benchConnectFourVertical, &state);
+  runBenchmark("batchWins", benchBatchWins, &state);
+  runBenchmark("batchWinsScalar", benchBatchWinsScalar, &state);
+  printf("batch_wins_kernel %s\n", findBatchWinsKernel());
+  runBenchmark("displayTokens", benchDisplayTokens, &state);
+  runBenchmark("displayTokensDiff", benchDisplayTokensDiff, &state);
+  runSearchBenchmarks();
+  return 0;
+}
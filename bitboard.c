@@ -0,0 +1,125 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "bitboard.h"
+
+#include <string.h>
+
+/*** Functions ***/
+
+GameState createGameState() {
+  GameState NewState;
+  NewState.position = createPosition();
+  NewState.last_drop_row = -1;
+  NewState.last_drop_col = -1;
+  return NewState;
+}
+
+Position createPosition() {
+  Position NewPosition;
+  memset(&NewPosition, 0, sizeof(NewPosition));
+  return NewPosition;
+}
+
+int createPositionFromArray(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                            Position* out_position) {
+  *out_position = createPosition();
+
+  // Columns are read from the bottom row up so that the heights table only
+  // grows while tokens are found.
+  int row, col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    for (row = BOARD_HEIGHT - 1; row >= 0; --row) {
+      if (array[row][col] == EMPTY) {
+        break;
+      }
+      out_position->player_masks[array[row][col]] |= cellBit(row, col);
+      out_position->heights[col]++;
+      out_position->move_counter++;
+    }
+    // Anything above the first empty cell has to be empty as well.
+    for (; row >= 0; --row) {
+      if (array[row][col] != EMPTY) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+Position createPositionFromKey(bitboard key) {
+  Position NewPosition = createPosition();
+  bitboard player_mask = 0;
+  bitboard mask = 0;
+  int col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    bitboard column = (key >> (col * COLUMN_BITS)) &
+                      (((bitboard)1 << COLUMN_BITS) - 1);
+    // The highest bit of the column is the marker just above its top token,
+    // the bits under it are the current player's tokens.
+    int height = 63 - __builtin_clzll(column);
+    bitboard marker = (bitboard)1 << height;
+    NewPosition.heights[col] = height;
+    NewPosition.move_counter += height;
+    player_mask |= (column - marker) << (col * COLUMN_BITS);
+    mask |= (marker - 1) << (col * COLUMN_BITS);
+  }
+  NewPosition.player_masks[currentPlayer(&NewPosition)] = player_mask;
+  NewPosition.player_masks[currentPlayer(&NewPosition) ^ 1] =
+      mask ^ player_mask;
+  return NewPosition;
+}
+
+int createPositionFromMoves(const char* moves, Position* out_position) {
+  *out_position = createPosition();
+
+  boolean game_won = FALSE;
+  for (; *moves != '\0'; ++moves) {
+    int col = *moves - '1';
+    if (game_won || col < 0 || col >= BOARD_WIDTH ||
+        !canPlay(out_position, col)) {
+      return -1;
+    }
+    game_won = isWinningMove(out_position, col);
+    playMove(out_position, col);
+  }
+  return 0;
+}
+
+boolean findConnectFourThrough(const Position* position, int row, int col,
+                               ConnectFourLine* out_line) {
+  int player = findTokenAt(position, row, col);
+  if (player == EMPTY) {
+    return FALSE;
+  }
+
+  bitboard mask = position->player_masks[player];
+  bitboard bit = cellBit(row, col);
+  int vector;
+  for (vector = HORIZONTAL; vector <= RIGHTDIAG; ++vector) {
+    int shift = vectorShift(vector);
+    // A line contains the token if its lowest cell is the token or one of the
+    // CONNECT_LENGTH - 1 cells below it along the vector.
+    bitboard cells = 0;
+    int i;
+    for (i = 0; i < CONNECT_LENGTH; ++i) {
+      cells |= bit >> (i * shift);
+    }
+    bitboard starts = findFourInARow(mask, vector) & cells;
+    if (starts == 0) {
+      continue;
+    }
+
+    // showConnectFour walks horizontal and left diagonal lines towards the
+    // left, so those lines start from their highest bit instead.
+    int index = __builtin_ctzll(starts);
+    if (vector == HORIZONTAL || vector == LEFTDIAG) {
+      index += (CONNECT_LENGTH - 1) * shift;
+    }
+    out_line->row = BOARD_HEIGHT - 1 - index % COLUMN_BITS;
+    out_line->col = index / COLUMN_BITS;
+    out_line->vector = vector;
+    return TRUE;
+  }
+  return FALSE;
+}
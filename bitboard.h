@@ -0,0 +1,342 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+
+/*** Define ***/
+
+// The board is fixed at compile time (make WIDTH=7 HEIGHT=6 CONNECT=4), so
+// every loop over it has constant bounds and every mask is a constant.
+#ifndef BOARD_HEIGHT
+#define BOARD_HEIGHT 7
+#endif
+#ifndef BOARD_WIDTH
+#define BOARD_WIDTH 7
+#endif
+#ifndef CONNECT_LENGTH
+#define CONNECT_LENGTH 4
+#endif
+#define BOARD_CELLS (BOARD_WIDTH * BOARD_HEIGHT)
+// Every column owns one extra bit above its top row. The spare bit keeps the
+// shifted masks from spilling into the next column and makes position keys
+// unique.
+#define COLUMN_BITS (BOARD_HEIGHT + 1)
+
+#if BOARD_WIDTH * COLUMN_BITS > 64
+#error "a bitboard holds at most 64 bits, BOARD_WIDTH * (BOARD_HEIGHT + 1)"
+#endif
+#if BOARD_WIDTH > 9
+#error "moves are written with one digit per column, 1 to BOARD_WIDTH"
+#endif
+#if CONNECT_LENGTH < 2 ||                                                      \
+    (CONNECT_LENGTH > BOARD_WIDTH && CONNECT_LENGTH > BOARD_HEIGHT)
+#error "CONNECT_LENGTH must fit on the board"
+#endif
+#if (CONNECT_LENGTH - 1) * (COLUMN_BITS + 1) >= 64
+#error "a diagonal of CONNECT_LENGTH cells must fit in one shift"
+#endif
+
+/*** Enum ***/
+
+typedef enum boolean { FALSE, TRUE } boolean;
+enum token { EMPTY = -1, RED, YELLOW };
+enum vectors { HORIZONTAL, LEFTDIAG, VERTICAL, RIGHTDIAG };
+
+/*** Structures ***/
+
+typedef uint64_t bitboard;
+
+// Position is the compact form of the board. Bit (col * COLUMN_BITS + height)
+// of player_masks[player] is set when the player owns the cell in that column
+// at that height, where height 0 is the bottom row of the board.
+typedef struct Position {
+  bitboard player_masks[2];
+  uint8_t heights[BOARD_WIDTH];
+  uint8_t move_counter;
+} Position;
+
+// GameState is one game and nothing about how it is drawn: the position and
+// the last move, whose four in a row is the one shown. It takes 32 bytes, two
+// to a cache line, so hosts of many games keep it in a SlabPool.
+typedef struct GameState {
+  Position position;
+  // last_drop_row and last_drop_col are the GameData array index (row 0 is
+  // the top row) of the last token, both -1 before the first move.
+  int8_t last_drop_row;
+  int8_t last_drop_col;
+} GameState;
+
+// ConnectFourLine describes four tokens in a row the way showConnectFour walks
+// them: the row and column of the first token in the GameData array and the
+// vector that leads from it to the other three.
+typedef struct ConnectFourLine {
+  int row;
+  int col;
+  int vector;
+} ConnectFourLine;
+
+/*** Declorations ***/
+
+// createGameState returns a game with no token dropped yet.
+GameState createGameState();
+
+// createPosition returns an empty position with RED to move.
+Position createPosition();
+
+// createPositionFromArray builds a position from the array used by GameData,
+// where array[0] is the top row. Returns 0, or -1 if a token is floating.
+int createPositionFromArray(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                            Position* out_position);
+
+// createPositionFromKey rebuilds the position a key from findPositionKey was
+// made from.
+Position createPositionFromKey(bitboard key);
+
+// createPositionFromMoves plays the moves, a string of columns numbered 1 to
+// BOARD_WIDTH, from the empty board. Returns -1 if a character is not a column,
+// a column is full or the game is won before the last move, 0 otherwise.
+int createPositionFromMoves(const char* moves, Position* out_position);
+
+// findConnectFourThrough checks only the four vectors that pass through the
+// token at the row and column of the GameData array. Returns TRUE and fills
+// out_line if that token is part of a connect four, FALSE otherwise.
+boolean findConnectFourThrough(const Position* position, int row, int col,
+                               ConnectFourLine* out_line);
+
+/*** Inline Functions ***/
+
+// bottomMask returns a mask with the bottom cell of every column set.
+static inline bitboard bottomMask() {
+  bitboard mask = 0;
+  int col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    mask |= (bitboard)1 << (col * COLUMN_BITS);
+  }
+  return mask;
+}
+
+// boardMask returns a mask with every cell of the board set, the spare bit of
+// each column left out.
+static inline bitboard boardMask() {
+  return bottomMask() * (((bitboard)1 << BOARD_HEIGHT) - 1);
+}
+
+// topMask returns a mask with the top cell of every column set.
+static inline bitboard topMask() {
+  return bottomMask() << (BOARD_HEIGHT - 1);
+}
+
+// vectorShift returns the distance in bits between two neighbouring cells
+// along the vector.
+static inline int vectorShift(int vector) {
+  switch (vector) {
+  case HORIZONTAL:
+    return COLUMN_BITS;
+  case LEFTDIAG:
+    return COLUMN_BITS - 1;
+  case VERTICAL:
+    return 1;
+  default:
+    return COLUMN_BITS + 1;
+  }
+}
+
+// findFourInARow returns a mask of the lowest cell of every CONNECT_LENGTH in
+// a row along the vector. Runs are doubled in length as long as they fit and
+// the last step overlaps, so connect four takes two shifts and connect five
+// three.
+static inline bitboard findFourInARow(bitboard mask, int vector) {
+  int shift = vectorShift(vector);
+  bitboard runs = mask;
+  int length = 1;
+  while (2 * length <= CONNECT_LENGTH) {
+    runs &= runs >> (length * shift);
+    length *= 2;
+  }
+  if (length < CONNECT_LENGTH) {
+    runs &= runs >> ((CONNECT_LENGTH - length) * shift);
+  }
+  return runs;
+}
+
+// hasConnectFour returns TRUE if the mask holds CONNECT_LENGTH in a row in any
+// vector.
+static inline boolean hasConnectFour(bitboard mask) {
+  return (findFourInARow(mask, HORIZONTAL) | findFourInARow(mask, LEFTDIAG) |
+          findFourInARow(mask, VERTICAL) |
+          findFourInARow(mask, RIGHTDIAG)) != 0;
+}
+
+// canPlay returns TRUE if the column still has an empty cell.
+static inline boolean canPlay(const Position* position, int col) {
+  return position->heights[col] < BOARD_HEIGHT;
+}
+
+// columnOrder returns the column to try at the index of the move ordering. The
+// center column comes first and the order works outwards from there, because
+// center tokens take part in the most four in a rows.
+static inline int columnOrder(int index) {
+  if (index % 2 == 0) {
+    return BOARD_WIDTH / 2 + index / 2;
+  }
+  return BOARD_WIDTH / 2 - (index + 1) / 2;
+}
+
+// cellBit returns the single bit for the cell at the row and column of the
+// GameData array (row 0 is the top row).
+static inline bitboard cellBit(int row, int col) {
+  return (bitboard)1 << (col * COLUMN_BITS + (BOARD_HEIGHT - 1 - row));
+}
+
+// currentPlayer returns the token of the player to move.
+static inline int currentPlayer(const Position* position) {
+  return position->move_counter & 1;
+}
+
+// findPlayableCells returns a mask of the cell every open column would take
+// its next token in.
+static inline bitboard findPlayableCells(const Position* position) {
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  return (mask + bottomMask()) & boardMask();
+}
+
+// findColumnOrderIndex returns the index of the column in the move ordering,
+// the inverse of columnOrder.
+static inline int findColumnOrderIndex(int col) {
+  if (col >= BOARD_WIDTH / 2) {
+    return 2 * (col - BOARD_WIDTH / 2);
+  }
+  return 2 * (BOARD_WIDTH / 2 - col) - 1;
+}
+
+// findLegalMoves returns the open columns as a mask in the move ordering: bit
+// i is set when column columnOrder(i) can be played. Taking the lowest bit
+// first (see popLegalMove) tries the center first. The top row of the board
+// shows every full column at once, no column is looked at on its own.
+static inline unsigned findLegalMoves(const Position* position) {
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  bitboard open = topMask() & ~mask;
+  unsigned moves = 0;
+  int i;
+  for (i = 0; i < BOARD_WIDTH; ++i) {
+    int top = columnOrder(i) * COLUMN_BITS + BOARD_HEIGHT - 1;
+    moves |= (unsigned)(open >> top & 1) << i;
+  }
+  return moves;
+}
+
+// findPositionKey returns a key that is unique to the position and the player
+// to move. Adding the bottom mask to the occupied mask turns every column into
+// a single marker bit just above its top token.
+static inline bitboard findPositionKey(const Position* position) {
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  return position->player_masks[currentPlayer(position)] + mask + bottomMask();
+}
+
+// findWinningCellsAlong returns a mask of the cells that would complete
+// CONNECT_LENGTH in a row for player_mask along the vector, occupied or not.
+// A cell wins when the player's tokens fill the rest of a line through it,
+// tried with the cell at every place of the line from its bottom up. The spare
+// bit of every column is never set, so no line wraps around.
+static inline bitboard findWinningCellsAlong(bitboard player_mask,
+                                             int vector) {
+  int shift = vectorShift(vector);
+  // before holds the cells with gap tokens in a row right below them.
+  bitboard before = ~(bitboard)0;
+  bitboard cells = 0;
+  int gap, i;
+  for (gap = 0; gap < CONNECT_LENGTH; ++gap) {
+    bitboard line = before;
+    for (i = 1; i < CONNECT_LENGTH - gap; ++i) {
+      line &= player_mask >> i * shift;
+    }
+    cells |= line;
+    before &= player_mask << (gap + 1) * shift;
+  }
+  return cells;
+}
+
+// findWinningCells returns a mask of the empty cells that would complete
+// CONNECT_LENGTH in a row for player_mask, whether or not the cells can be
+// played yet. mask holds every occupied cell.
+static inline bitboard findWinningCells(bitboard player_mask, bitboard mask) {
+  bitboard cells = findWinningCellsAlong(player_mask, HORIZONTAL) |
+                   findWinningCellsAlong(player_mask, LEFTDIAG) |
+                   findWinningCellsAlong(player_mask, VERTICAL) |
+                   findWinningCellsAlong(player_mask, RIGHTDIAG);
+  return cells & (boardMask() ^ mask);
+}
+
+// findTokenAt returns the token at the row and column of the GameData array
+// (row 0 is the top row).
+static inline int findTokenAt(const Position* position, int row, int col) {
+  bitboard bit = cellBit(row, col);
+  if (position->player_masks[RED] & bit) {
+    return RED;
+  }
+  if (position->player_masks[YELLOW] & bit) {
+    return YELLOW;
+  }
+  return EMPTY;
+}
+
+// hasWinningMove returns TRUE if the current player connects four with any
+// playable move.
+static inline boolean hasWinningMove(const Position* position) {
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  return (findWinningCells(position->player_masks[currentPlayer(position)],
+                           mask) &
+          findPlayableCells(position)) != 0;
+}
+
+// isBoardFull returns TRUE once every cell holds a token. A full board without
+// a connect four is a draw.
+static inline boolean isBoardFull(const Position* position) {
+  return position->move_counter == BOARD_CELLS;
+}
+
+// isGameOver returns TRUE once either player has CONNECT_LENGTH in a row or
+// the board is full, so no move is left to play.
+static inline boolean isGameOver(const Position* position) {
+  return hasConnectFour(position->player_masks[RED]) ||
+         hasConnectFour(position->player_masks[YELLOW]) ||
+         isBoardFull(position);
+}
+
+// isWinningMove returns TRUE if the current player connects four by playing in
+// the column. The column must be playable (see canPlay).
+static inline boolean isWinningMove(const Position* position, int col) {
+  bitboard mask = position->player_masks[currentPlayer(position)] |
+                  (bitboard)1 << (col * COLUMN_BITS + position->heights[col]);
+  return hasConnectFour(mask);
+}
+
+// playMove stacks the current player's token in the column. The column must be
+// playable (see canPlay).
+static inline void playMove(Position* position, int col) {
+  position->player_masks[currentPlayer(position)] |=
+      (bitboard)1 << (col * COLUMN_BITS + position->heights[col]);
+  position->heights[col]++;
+  position->move_counter++;
+}
+
+// playGameMove plays the column like playMove and keeps it as the last drop.
+// The column must be playable (see canPlay).
+static inline void playGameMove(GameState* state, int col) {
+  state->last_drop_row = BOARD_HEIGHT - 1 - state->position.heights[col];
+  state->last_drop_col = col;
+  playMove(&state->position, col);
+}
+
+// popLegalMove removes the first move of the ordering from a findLegalMoves
+// mask and returns its column. The mask must not be empty.
+static inline int popLegalMove(unsigned* moves) {
+  int index = __builtin_ctz(*moves);
+  *moves &= *moves - 1;
+  return columnOrder(index);
+}
+
+#endif
@@ -0,0 +1,283 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "book.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*** Structures ***/
+
+// BookPosition is a position of the generator together with its book key.
+typedef struct BookPosition {
+  bitboard key;
+  Position position;
+} BookPosition;
+
+/*** Declorations ***/
+
+// compareBookPositions orders book positions by key for qsort.
+static int compareBookPositions(const void* first, const void* second);
+
+// compareEntries orders book entries for qsort.
+static int compareEntries(const void* first, const void* second);
+
+// createBookPosition returns the position or its mirror image, whichever has
+// the smaller key, with that key.
+static BookPosition createBookPosition(const Position* position);
+
+// expandBookLevel frees level and returns the positions one move after it,
+// mirror images and transpositions removed, with their number in count.
+// Returns NULL if the allocation fails.
+static BookPosition* expandBookLevel(BookPosition* level, size_t* count);
+
+// mirrorPosition returns the position with the columns in reverse order.
+static Position mirrorPosition(const Position* position);
+
+// writeOpeningBookFile writes the header and the sorted entries to the file at
+// path. Returns -1 if the file cannot be written, 0 otherwise.
+static int writeOpeningBookFile(const char* path, int plies,
+                                const uint64_t* entries, size_t entry_count);
+
+/*** Functions ***/
+
+void closeOpeningBook(OpeningBook* book) {
+  munmap(book->mapping, book->mapping_size);
+  book->mapping = NULL;
+  book->entries = NULL;
+  book->entry_count = 0;
+}
+
+static int compareBookPositions(const void* first, const void* second) {
+  bitboard first_key = ((const BookPosition*)first)->key;
+  bitboard second_key = ((const BookPosition*)second)->key;
+  return (first_key > second_key) - (first_key < second_key);
+}
+
+static int compareEntries(const void* first, const void* second) {
+  uint64_t first_entry = *(const uint64_t*)first;
+  uint64_t second_entry = *(const uint64_t*)second;
+  return (first_entry > second_entry) - (first_entry < second_entry);
+}
+
+static BookPosition createBookPosition(const Position* position) {
+  BookPosition Book;
+  Position mirror = mirrorPosition(position);
+  bitboard key = findPositionKey(position);
+  bitboard mirror_key = findPositionKey(&mirror);
+  if (mirror_key < key) {
+    Book.key = mirror_key;
+    Book.position = mirror;
+  } else {
+    Book.key = key;
+    Book.position = *position;
+  }
+  return Book;
+}
+
+int64_t createOpeningBookFile(const char* path, int plies, SearchLimits limits,
+                              TranspositionTable* table) {
+  if (!BOOK_KEY_FITS) {
+    return -1;
+  }
+  size_t count = 1;
+  BookPosition* level = malloc(sizeof(BookPosition));
+  uint64_t* entries = NULL;
+  size_t entry_count = 0;
+  boolean failed = level == NULL;
+  if (!failed) {
+    Position empty = createPosition();
+    level[0] = createBookPosition(&empty);
+  }
+
+  int ply;
+  for (ply = 0; ply < plies && count > 0 && !failed; ++ply) {
+    uint64_t* grown =
+        realloc(entries, (entry_count + count) * sizeof(uint64_t));
+    if (grown == NULL) {
+      failed = TRUE;
+      break;
+    }
+    entries = grown;
+
+    size_t i;
+    for (i = 0; i < count; ++i) {
+      SearchResult best =
+          searchBestMove(&level[i].position, limits, table, NULL);
+      if (best.best_move != -1) {
+        entries[entry_count++] =
+            level[i].key << BOOK_MOVE_BITS | (uint64_t)best.best_move;
+      }
+    }
+
+    if (ply + 1 < plies) {
+      level = expandBookLevel(level, &count);
+      failed = level == NULL;
+    }
+  }
+  free(level);
+
+  int64_t result = -1;
+  if (!failed) {
+    qsort(entries, entry_count, sizeof(uint64_t), compareEntries);
+    if (writeOpeningBookFile(path, plies, entries, entry_count) == 0) {
+      result = entry_count;
+    }
+  }
+  free(entries);
+  return result;
+}
+
+static BookPosition* expandBookLevel(BookPosition* level, size_t* count) {
+  BookPosition* next = malloc(*count * BOARD_WIDTH * sizeof(BookPosition));
+  if (next == NULL) {
+    free(level);
+    return NULL;
+  }
+
+  size_t next_count = 0;
+  size_t i;
+  int col;
+  for (i = 0; i < *count; ++i) {
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      // A winning move ends the game, there is nothing to look up after it.
+      if (!canPlay(&level[i].position, col) ||
+          isWinningMove(&level[i].position, col)) {
+        continue;
+      }
+      Position child = level[i].position;
+      playMove(&child, col);
+      next[next_count++] = createBookPosition(&child);
+    }
+  }
+  free(level);
+
+  qsort(next, next_count, sizeof(BookPosition), compareBookPositions);
+  size_t unique = 0;
+  for (i = 0; i < next_count; ++i) {
+    if (unique == 0 || next[i].key != next[unique - 1].key) {
+      next[unique++] = next[i];
+    }
+  }
+  *count = unique;
+  return next;
+}
+
+static Position mirrorPosition(const Position* position) {
+  Position Mirror = *position;
+  bitboard column = ((bitboard)1 << COLUMN_BITS) - 1;
+  int col, player;
+  for (player = RED; player <= YELLOW; ++player) {
+    Mirror.player_masks[player] = 0;
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      bitboard bits =
+          (position->player_masks[player] >> (col * COLUMN_BITS)) & column;
+      Mirror.player_masks[player] |=
+          bits << ((BOARD_WIDTH - 1 - col) * COLUMN_BITS);
+    }
+  }
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    Mirror.heights[col] = position->heights[BOARD_WIDTH - 1 - col];
+  }
+  return Mirror;
+}
+
+int openOpeningBook(const char* path, OpeningBook* out_book) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+  struct stat status;
+  if (fstat(fd, &status) == -1 ||
+      (size_t)status.st_size < sizeof(OpeningBookHeader)) {
+    close(fd);
+    return -1;
+  }
+  void* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid once the descriptor is closed.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return -1;
+  }
+
+  const OpeningBookHeader* header = mapping;
+  if (memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 ||
+      header->board_width != BOARD_WIDTH ||
+      header->board_height != BOARD_HEIGHT ||
+      header->connect_length != CONNECT_LENGTH ||
+      (size_t)status.st_size !=
+          sizeof(OpeningBookHeader) + header->entry_count * sizeof(uint64_t)) {
+    munmap(mapping, status.st_size);
+    return -1;
+  }
+
+  out_book->entries =
+      (const uint64_t*)((const char*)mapping + sizeof(OpeningBookHeader));
+  out_book->entry_count = header->entry_count;
+  out_book->plies = header->plies;
+  out_book->mapping = mapping;
+  out_book->mapping_size = status.st_size;
+  return 0;
+}
+
+int probeOpeningBook(const OpeningBook* book, const Position* position) {
+  if (position->move_counter >= book->plies) {
+    return -1;
+  }
+
+  Position mirror = mirrorPosition(position);
+  bitboard key = findPositionKey(position);
+  bitboard mirror_key = findPositionKey(&mirror);
+  boolean mirrored = mirror_key < key;
+  if (mirrored) {
+    key = mirror_key;
+  }
+
+  uint64_t low = 0;
+  uint64_t high = book->entry_count;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    bitboard entry_key = book->entries[middle] >> BOOK_MOVE_BITS;
+    if (entry_key < key) {
+      low = middle + 1;
+    } else if (entry_key > key) {
+      high = middle;
+    } else {
+      int col = book->entries[middle] & ((1 << BOOK_MOVE_BITS) - 1);
+      if (mirrored) {
+        col = BOARD_WIDTH - 1 - col;
+      }
+      return col < BOARD_WIDTH && canPlay(position, col) ? col : -1;
+    }
+  }
+  return -1;
+}
+
+static int writeOpeningBookFile(const char* path, int plies,
+                                const uint64_t* entries, size_t entry_count) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return -1;
+  }
+
+  OpeningBookHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  memcpy(Header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+  Header.board_width = BOARD_WIDTH;
+  Header.board_height = BOARD_HEIGHT;
+  Header.connect_length = CONNECT_LENGTH;
+  Header.plies = plies;
+  Header.entry_count = entry_count;
+  boolean written =
+      fwrite(&Header, sizeof(Header), 1, file) == 1 &&
+      fwrite(entries, sizeof(uint64_t), entry_count, file) == entry_count;
+  if (fclose(file) != 0 || !written) {
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "search.h"
+#include "transposition.h"
+
+/*** Define ***/
+
+#define BOOK_MAGIC "C4BOOK2"
+// An entry is the position key shifted past BOOK_MOVE_BITS with the column of
+// the best move in the low bits.
+#define BOOK_MOVE_BITS 4
+// BOOK_KEY_FITS is FALSE on boards whose keys leave no room for the move, which
+// have no book.
+#define BOOK_KEY_FITS (BOARD_WIDTH * COLUMN_BITS + BOOK_MOVE_BITS <= 64)
+// A book covers DEFAULT_BOOK_PLIES moves unless told otherwise, and every
+// position is searched to DEFAULT_BOOK_DEPTH without a limit of its own, which
+// takes a few seconds on the 7x7 board.
+#define DEFAULT_BOOK_PLIES 4
+#define DEFAULT_BOOK_DEPTH 14
+
+/*** Structures ***/
+
+// OpeningBookHeader starts the book file and is followed by entry_count
+// entries sorted by key. Keys are the smaller of the position's key and its
+// mirror image's, so a position and its mirror share one entry. The file is in
+// the byte order of the machine that wrote it.
+typedef struct OpeningBookHeader {
+  char magic[8];
+  uint32_t board_width;
+  uint32_t board_height;
+  uint32_t plies;
+  uint32_t connect_length;
+  uint64_t entry_count;
+} OpeningBookHeader;
+
+// OpeningBook is a book file mapped into memory. Probing it reads the mapping
+// in place, nothing is parsed or allocated.
+typedef struct OpeningBook {
+  const uint64_t* entries;
+  uint64_t entry_count;
+  int plies;
+  void* mapping;
+  size_t mapping_size;
+} OpeningBook;
+
+/*** Declorations ***/
+
+// closeOpeningBook unmaps the book.
+void closeOpeningBook(OpeningBook* book);
+
+// createOpeningBookFile searches every position of the first plies moves with
+// the limits and writes the best moves to the file at path. Positions that are
+// mirror images of each other are searched once. Returns -1 if the book cannot
+// be built or written or the board has no book, otherwise the number of
+// entries.
+int64_t createOpeningBookFile(const char* path, int plies, SearchLimits limits,
+                              TranspositionTable* table);
+
+// openOpeningBook maps the book file at path. Returns -1 if the file cannot be
+// mapped or is not a book for this board, 0 otherwise.
+int openOpeningBook(const char* path, OpeningBook* out_book);
+
+// probeOpeningBook returns the book move of the position with a binary search,
+// -1 if the position is not in the book.
+int probeOpeningBook(const OpeningBook* book, const Position* position);
+
+#endif
@@ -0,0 +1,187 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "eval.h"
+
+#include <string.h>
+
+#include "win_lines.h"
+
+/*** Define ***/
+
+// Counting the tokens of lines is most of the work. x86-64 only has a popcnt
+// instruction from SSE4.2 on, so without it in the build the evaluation is
+// also compiled for it and picks it at run time, a library call otherwise.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__POPCNT__)
+#define EVAL_POPCNT
+#endif
+
+/*** Declorations ***/
+
+// addTokenLines is addEvaluationToken. It is inlined into every version of
+// it, so each is compiled with its own instruction set.
+static inline void addTokenLines(Evaluation* evaluation,
+                                 const Position* position, int col)
+    __attribute__((always_inline));
+
+#ifdef EVAL_POPCNT
+// addTokenLinesPopcnt is addTokenLines compiled for popcnt.
+static void addTokenLinesPopcnt(Evaluation* evaluation,
+                                const Position* position, int col)
+    __attribute__((target("popcnt")));
+#endif
+
+// findAboveMask returns a mask of the cells above the cells of mask in their
+// columns.
+static bitboard findAboveMask(bitboard mask);
+
+// findParityRows returns a mask of the rows that win the zugzwang for the
+// token: the odd rows counted from 1 at the bottom for RED, the even rows for
+// YELLOW. With one player replying in the column the other played, the first
+// player ends up with the odd rows.
+static bitboard findParityRows(int token);
+
+#ifdef EVAL_POPCNT
+// scorePopcnt is evaluatePosition compiled for popcnt.
+static int scorePopcnt(const Evaluation* evaluation, int token)
+    __attribute__((target("popcnt")));
+#endif
+
+// scorePosition is evaluatePosition for the token to move. It is inlined
+// into every version of it.
+static inline int scorePosition(const Evaluation* evaluation, int token)
+    __attribute__((always_inline));
+
+// scoreToken returns the evaluation of the token's side alone.
+static inline int scoreToken(const Evaluation* evaluation, int token)
+    __attribute__((always_inline));
+
+/*** Functions ***/
+
+void addEvaluationToken(Evaluation* evaluation, const Position* position,
+                        int col) {
+#ifdef EVAL_POPCNT
+  if (__builtin_cpu_supports("popcnt")) {
+    addTokenLinesPopcnt(evaluation, position, col);
+    return;
+  }
+#endif
+  addTokenLines(evaluation, position, col);
+}
+
+static inline void addTokenLines(Evaluation* evaluation,
+                                 const Position* position, int col) {
+  int token = currentPlayer(position);
+  int other = token ^ 1;
+  int row = BOARD_HEIGHT - 1 - position->heights[col];
+  bitboard bit = cellBit(row, col);
+  bitboard mask =
+      position->player_masks[RED] | position->player_masks[YELLOW] | bit;
+  int i;
+  for (i = 0; i < CELL_LINE_COUNTS[row][col]; ++i) {
+    int line = CELL_LINES[row][col][i];
+    bitboard line_mask = WIN_LINE_MASKS[line];
+    int own = __builtin_popcountll(position->player_masks[token] & line_mask);
+    int others =
+        __builtin_popcountll(position->player_masks[other] & line_mask);
+    // A line the game was already won on is left alone.
+    if (others == 0 && own < CONNECT_LENGTH) {
+      // The line stays open for the token with one more of its tokens, an
+      // empty line stops being open for the other token.
+      evaluation->open_lines[token][own]--;
+      if (own + 1 < CONNECT_LENGTH) {
+        evaluation->open_lines[token][own + 1]++;
+      }
+      if (own + 1 == CONNECT_LENGTH - 1) {
+        evaluation->threats[token] |= line_mask & ~mask;
+      }
+      if (own == 0) {
+        evaluation->open_lines[other][0]--;
+      }
+    } else if (own == 0 && others < CONNECT_LENGTH) {
+      evaluation->open_lines[other][others]--;
+    }
+  }
+  // A threat only goes away when its cell is filled.
+  evaluation->threats[RED] &= ~bit;
+  evaluation->threats[YELLOW] &= ~bit;
+}
+
+#ifdef EVAL_POPCNT
+static void addTokenLinesPopcnt(Evaluation* evaluation,
+                                const Position* position, int col) {
+  addTokenLines(evaluation, position, col);
+}
+#endif
+
+Evaluation createEvaluation(const Position* position) {
+  Evaluation NewEvaluation;
+  memset(&NewEvaluation, 0, sizeof(NewEvaluation));
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  int line, token;
+  for (line = 0; line < WIN_LINE_COUNT; ++line) {
+    int counts[2];
+    for (token = RED; token <= YELLOW; ++token) {
+      counts[token] = __builtin_popcountll(position->player_masks[token] &
+                                           WIN_LINE_MASKS[line]);
+    }
+    for (token = RED; token <= YELLOW; ++token) {
+      if (counts[token ^ 1] == 0 && counts[token] < CONNECT_LENGTH) {
+        NewEvaluation.open_lines[token][counts[token]]++;
+      }
+    }
+  }
+  for (token = RED; token <= YELLOW; ++token) {
+    NewEvaluation.threats[token] =
+        findWinningCells(position->player_masks[token], mask);
+  }
+  return NewEvaluation;
+}
+
+int evaluatePosition(const Evaluation* evaluation, const Position* position) {
+#ifdef EVAL_POPCNT
+  if (__builtin_cpu_supports("popcnt")) {
+    return scorePopcnt(evaluation, currentPlayer(position));
+  }
+#endif
+  return scorePosition(evaluation, currentPlayer(position));
+}
+
+static bitboard findAboveMask(bitboard mask) {
+  // With the spare bit of every column set, taking the bottom row away only
+  // borrows within each column, flipping its lowest cell of mask and the
+  // cells below. A column without one flips whole.
+  bitboard guarded = mask | topMask() << 1;
+  return boardMask() & ~(guarded ^ (guarded - bottomMask()));
+}
+
+static bitboard findParityRows(int token) {
+  bitboard column_rows = (token == RED ? 0x5555555555555555ULL
+                                       : 0xaaaaaaaaaaaaaaaaULL) &
+                         (((bitboard)1 << BOARD_HEIGHT) - 1);
+  return bottomMask() * column_rows;
+}
+
+#ifdef EVAL_POPCNT
+static int scorePopcnt(const Evaluation* evaluation, int token) {
+  return scorePosition(evaluation, token);
+}
+#endif
+
+static inline int scorePosition(const Evaluation* evaluation, int token) {
+  return scoreToken(evaluation, token) - scoreToken(evaluation, token ^ 1);
+}
+
+static inline int scoreToken(const Evaluation* evaluation, int token) {
+  bitboard threats = evaluation->threats[token];
+  // A threat above one of the opponent's never gets to be played for the win,
+  // the one below it decides the column first.
+  bitboard parity_threats = threats & findParityRows(token) &
+                            ~findAboveMask(evaluation->threats[token ^ 1]);
+  return EVAL_TWO_WEIGHT *
+             evaluation->open_lines[token][CONNECT_LENGTH - 2] +
+         EVAL_THREE_WEIGHT *
+             evaluation->open_lines[token][CONNECT_LENGTH - 1] +
+         EVAL_THREAT_WEIGHT * __builtin_popcountll(threats) +
+         EVAL_PARITY_WEIGHT * __builtin_popcountll(parity_threats);
+}
@@ -0,0 +1,62 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <stdint.h>
+
+#include "bitboard.h"
+
+/*** Define ***/
+
+// The weights are in the score units of the search. The largest evaluation
+// of any board stays far below the slowest win, WIN_SCORE - BOARD_CELLS.
+// A line scores more the closer it is to a win, and an open three counts
+// twice over, as a line and as the threat in its empty cell. The parity
+// weight was picked by searching the empty 7x6 and 7x7 boards to depths 6 to
+// 14: at half the threat weight every depth opens in the centre, and searched
+// to depth 11 the first moves rank the centre, then its neighbours, then the
+// rest, the order of their solved values on 7x6. Weighted 16, a parity threat
+// is worth three plain ones and depth 14 opens in the second column.
+#define EVAL_TWO_WEIGHT 1
+#define EVAL_THREE_WEIGHT 4
+#define EVAL_THREAT_WEIGHT 8
+// EVAL_PARITY_WEIGHT is added for a threat on a row of the parity that wins
+// the zugzwang at the end of the game, odd rows for RED and even rows for
+// YELLOW counted from 1 at the bottom, that has no threat of the opponent
+// below it in its column.
+#define EVAL_PARITY_WEIGHT 4
+
+/*** Structures ***/
+
+// Evaluation is what the static evaluation knows about a board, kept up to
+// date one token at a time by addEvaluationToken. A line is open for a token
+// while the other token has no cell of it.
+typedef struct Evaluation {
+  // open_lines[token][k] counts the lines open for the token that hold k of
+  // its tokens, k below CONNECT_LENGTH. The empty lines are counted for both.
+  int16_t open_lines[2][CONNECT_LENGTH];
+  // threats[token] holds the empty cells that complete a line for the token.
+  bitboard threats[2];
+} Evaluation;
+
+/*** Declorations ***/
+
+// addEvaluationToken updates the evaluation of the position for the token of
+// the player to move dropped in col. Only the lines through the cell the
+// token lands in change, so it is called with the position before the drop.
+void addEvaluationToken(Evaluation* evaluation, const Position* position,
+                        int col);
+
+// createEvaluation returns the evaluation of the position from scratch, line
+// by line.
+Evaluation createEvaluation(const Position* position);
+
+// evaluatePosition returns the static score of the position for the player to
+// move, positive when the player is ahead: the open two and three in a rows
+// (CONNECT_LENGTH - 2 and - 1) and the threats of both players, with the
+// threats that win the column parity weighted up.
+int evaluatePosition(const Evaluation* evaluation, const Position* position);
+
+#endif
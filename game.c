@@ -0,0 +1,1480 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "game.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "win_lines.h"
+
+/*** Define ***/
+
+#define BLANK_LINE "                                           "
+#define BLINKING_OFF "\x1b[m"
+#define BLINKING_ON "\x1b[1;5;7m"
+#define BLUE_COLOR "\x1b[34m"
+// The board is drawn with CELL_TEXT_WIDTH characters per column and two lines
+// per row, plus the closing edge.
+#define CELL_TEXT_WIDTH 4
+#define BOARD_TEXT_HEIGHT (2 * BOARD_HEIGHT + 1)
+#define BOARD_TEXT_WIDTH (CELL_TEXT_WIDTH * BOARD_WIDTH + 1)
+// BOARD_TOP_OFFSET is the row of the board's top edge from the middle of the
+// terminal, which keeps the board centered. The title and the status bars are
+// placed above the top edge and below the bottom edge, so they never overlap
+// the board whatever its height.
+#define BOARD_TOP_OFFSET (2 - BOARD_TEXT_HEIGHT / 2)
+#define TITLE_OFFSET (BOARD_TOP_OFFSET - 9)
+#define SEARCH_BAR_OFFSET (BOARD_TOP_OFFSET - 5)
+#define TURN_BAR_OFFSET (BOARD_TOP_OFFSET - 3)
+#define PLAYERS_OFFSET (BOARD_TOP_OFFSET - 1)
+#define FIRST_TOKEN_OFFSET (BOARD_TOP_OFFSET + 1)
+// The bars under the board leave two blank lines below its bottom edge.
+#define BOTTOM_BAR_OFFSET (BOARD_TOP_OFFSET + BOARD_TEXT_HEIGHT + 2)
+#define CLEAR "\x1b[2J"
+#define CORNER "H"
+#define CTRL_KEY(k) ((k)&0x1f)
+#define DEFAULT_COLOR "\x1b[39m"
+#define DIRECTION_ARROW "PRESS ARROW KEY TO MOVE THE TOKEN"
+#define DIRECTIONS_ENTER "PRESS ENTER KEY TO DROP THE TOKEN"
+#define DOWN "B"
+#define DRAW "THE GAME IS A DRAW"
+#define ENDGAME_DIRECTIONS "GAME OVER, DO YOU WANT TO PLAY AGAIN? (Y/N)"
+#define ESC "\x1b["
+// An escape byte without the rest of its sequence after ESCAPE_TIMEOUT_MS is
+// taken as a key of its own.
+#define ESCAPE_TIMEOUT_MS 50
+#define FRAME_BUFFER_SIZE 16384
+#define HIDE "\x1b[?25l"
+#define INPUT_BUFFER_SIZE 64
+#define INPUT_READY 4
+#define LEFT "D"
+#define PLAYER1 "X"
+#define PLAYER2 "O"
+#define P1TURN "PLAYER 1's TURN"
+#define P1WIN "PLAYER 1 IS THE WINNER"
+#define P2TURN "PLAYER 2's TURN"
+#define P2WIN "PLAYER 2 IS THE WINNER"
+#define RED_COLOR "\x1b[31m"
+#define RIGHT "C"
+#define TITLE "CONNECT FOUR"
+#define UNDRAWN_TOKEN -2
+#define UNHIDE "\x1b[?25h"
+#define UP "A"
+#define YELLOW_COLOR "\x1b[33m"
+
+/*** Enum ***/
+
+enum arrow_enter { ENTER = 13, RIGHT_ARROW = 67, LEFT_ARROW = 68 };
+enum bounds { LEFT_BOUNDARY = 0, RIGHT_BOUNDARY = BOARD_WIDTH - 1 };
+// status_bar names what is on screen in a status bar row. UNDRAWN_BAR means
+// the row has to be drawn no matter what it held.
+enum status_bar {
+  UNDRAWN_BAR,
+  P1_TURN_BAR,
+  P2_TURN_BAR,
+  WIN_BAR,
+  DIRECTIONS_BAR,
+  END_GAME_BAR
+};
+
+/*** Structures ***/
+
+// InputBuffer holds the bytes read from the terminal that are not parsed into
+// keys yet. A single read() can return a whole escape sequence or several
+// keys.
+typedef struct InputBuffer {
+  char data[INPUT_BUFFER_SIZE];
+  int start;
+  int length;
+} InputBuffer;
+
+// ComputerSearch is the search for the computer's move, running on its own
+// thread while the input loop keeps handling keys. The search thread writes
+// to search_pipe whenever progress or done changes.
+typedef struct ComputerSearch {
+  pthread_t thread;
+  Position position;
+  // evaluation is the evaluation of position the search starts from when
+  // limits.evaluation points to it.
+  Evaluation evaluation;
+  SearchLimits limits;
+  TranspositionTable* table;
+  const Tablebase* tablebase;
+  // stop is set by the input loop to make the search return early.
+  int stop;
+  int64_t start_ns;
+  // lock guards progress, result and done.
+  pthread_mutex_t lock;
+  SearchResult progress;
+  SearchResult result;
+  boolean done;
+} ComputerSearch;
+
+// FrameBuffer collects everything drawn for a frame so that it reaches the
+// terminal with a single write() in flushFrame.
+typedef struct FrameBuffer {
+  char data[FRAME_BUFFER_SIZE];
+  int length;
+} FrameBuffer;
+
+/*** Globals ***/
+
+// frame_buffer is shared by all the display functions, which draw at the
+// current cursor position and carry no state of their own.
+static FrameBuffer frame_buffer;
+static InputBuffer input_buffer;
+// resize_pipe carries a byte from the SIGWINCH handler to the input loop, so
+// a resize wakes poll() the same way a key press does.
+static int resize_pipe[2] = {-1, -1};
+// search_pipe does the same for the computer's search thread.
+static int search_pipe[2] = {-1, -1};
+// ponder_search runs during the player's turn, searching the computer's reply
+// to the move the player is expected to make, while pondering is TRUE.
+static ComputerSearch ponder_search;
+static boolean pondering = FALSE;
+
+/*** Declorations ***/
+
+// computerSearchThread runs the computer's search and marks it done.
+static void* computerSearchThread(void* computer_search);
+
+// handleWindowResize is the SIGWINCH handler. It only writes to resize_pipe.
+static void handleWindowResize(int signal_number);
+
+// notifySearchEvent wakes the input loop to look at the computer's search.
+static void notifySearchEvent();
+
+// parseInputKey takes the next key out of the input buffer and stores it in
+// out_key. An arrow key's escape sequence is stored as its last byte. Returns
+// FALSE if the buffer does not hold a whole key yet.
+static boolean parseInputKey(char* out_key);
+
+// ponderHit returns TRUE if the search running on the player's turn is on
+// the position, so the computer can take it over.
+static boolean ponderHit(const Position* position);
+
+// reportSearchProgress stores the result of a completed depth of the
+// computer's search for the input loop to display.
+static void reportSearchProgress(const SearchResult* result,
+                                 void* computer_search);
+
+// startComputerSearch starts searching the position with the limits on a
+// search thread, scoring its leaves from the evaluation of the position with
+// --eval. Returns -1 if the thread cannot be started, 0 otherwise.
+static int startComputerSearch(ComputerSearch* search,
+                               const Position* position,
+                               const Evaluation* evaluation,
+                               SearchLimits limits, GameOptions* options);
+
+// stopComputerSearch stops the search thread, waits for it to return and
+// drops the events it left in search_pipe.
+static void stopComputerSearch(ComputerSearch* search);
+
+// waitForComputerSearch displays the progress of the search and handles keys
+// until it is done. The search is stopped at deadline_ns (0 for never) or when
+// ENTER or space is pressed, and then plays the best move of its last complete
+// depth. Returns -1 if the player quit or an error occurred, 0 otherwise.
+static int waitForComputerSearch(GameData* game_data, ComputerSearch* search,
+                                 int64_t deadline_ns, char* error_message);
+
+// waitForInput blocks in poll() until the terminal has input, the window was
+// resized, the computer's search has news or timeout_ms passed (-1 for no
+// timeout), and reads the input into the input buffer. Returns -1 on an
+// error, WINDOW_RESIZED, SEARCH_PROGRESS, INPUT_READY or 0 on a timeout.
+static int waitForInput(int timeout_ms, char* error_message);
+
+/*** Functions ***/
+
+void appendToFrame(const char* bytes, int length) {
+  if (frame_buffer.length + length > FRAME_BUFFER_SIZE) {
+    flushFrame();
+  }
+  if (length > FRAME_BUFFER_SIZE) {
+    write(STDOUT_FILENO, bytes, length);
+    return;
+  }
+  memcpy(frame_buffer.data + frame_buffer.length, bytes, length);
+  frame_buffer.length += length;
+}
+
+int applyNewterminal_settings(struct termios new_settings,
+                              char* error_message) {
+  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &new_settings) == -1) {
+    strcat(error_message,
+           "enableRawMode->applyNewterminal_settings->tcsetattr");
+    return -1;
+  }
+  return 0;
+}
+
+int centerText(char* text) { return strlen(text) / (2); }
+
+void clearScreen() { appendToFrame(CLEAR, strlen(CLEAR)); }
+
+void clearSearchStatusBar(GameData* game_data) {
+  putCursorAt(game_data->search_status_bar_location.row,
+              game_data->blank_line_column_location.col);
+  displayStrings(BLANK_LINE);
+}
+
+void clearTerm() {
+  hideCursor();
+  clearScreen();
+  moveCursor(0, CORNER);
+}
+
+boolean connectFourAtLastDrop(GameData* game_data) {
+  if (game_data->state.last_drop_row == -1) {
+    return FALSE;
+  }
+
+  // Only a line through the last token can have been completed by the move.
+  ConnectFourLine line;
+  if (findConnectFourThrough(&game_data->state.position,
+                             game_data->state.last_drop_row,
+                             game_data->state.last_drop_col, &line)) {
+    showConnectFour(game_data, line.row, line.col, line.vector);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+boolean connectFourOnLine(int array[BOARD_HEIGHT][BOARD_WIDTH], int line) {
+  if (line == -1) {
+    return FALSE;
+  }
+
+  const uint8_t* cells = WIN_LINE_CELLS[line];
+  int token = array[cells[0] / BOARD_WIDTH][cells[0] % BOARD_WIDTH];
+  if (token == EMPTY) {
+    return FALSE;
+  }
+  int i;
+  for (i = 1; i < CONNECT_LENGTH; ++i) {
+    if (array[cells[i] / BOARD_WIDTH][cells[i] % BOARD_WIDTH] != token) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+boolean connectFourPresent(GameData* game_data) {
+  // Every line on the board comes from the WIN_LINE_MASKS table, so a line is
+  // found with a mask compare instead of walking the array.
+  bitboard red = game_data->state.position.player_masks[RED];
+  bitboard yellow = game_data->state.position.player_masks[YELLOW];
+  int line;
+  for (line = 0; line < WIN_LINE_COUNT; ++line) {
+    bitboard mask = WIN_LINE_MASKS[line];
+    if ((red & mask) == mask || (yellow & mask) == mask) {
+      showConnectFour(game_data, WIN_LINES[line].row, WIN_LINES[line].col,
+                      WIN_LINES[line].vector);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+// The four vectors look up the line that starts at the row and column in the
+// LINE_STARTING_AT table, which is -1 where the line would leave the board.
+boolean connectFourHorizontal(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                              int row, int col) {
+  return connectFourOnLine(array, LINE_STARTING_AT[row][col][HORIZONTAL]);
+}
+
+boolean connectFourLeftDiagonal(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                                int row, int col) {
+  return connectFourOnLine(array, LINE_STARTING_AT[row][col][LEFTDIAG]);
+}
+
+boolean connectFourRightDiagonal(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                                 int row, int col) {
+  return connectFourOnLine(array, LINE_STARTING_AT[row][col][RIGHTDIAG]);
+}
+
+boolean connectFourVertical(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                            int row, int col) {
+  return connectFourOnLine(array, LINE_STARTING_AT[row][col][VERTICAL]);
+}
+
+static void* computerSearchThread(void* computer_search) {
+  ComputerSearch* search = computer_search;
+  SearchResult result = searchBestMove(&search->position, search->limits,
+                                       search->table, search->tablebase);
+  pthread_mutex_lock(&search->lock);
+  search->result = result;
+  search->done = TRUE;
+  pthread_mutex_unlock(&search->lock);
+  notifySearchEvent();
+  return NULL;
+}
+
+boolean computerTurn(GameData* game_data, GameOptions* options,
+                     char* error_message) {
+  // The player's move is shown while the computer thinks.
+  flushFrame();
+  int best_move = -1;
+  // Opening moves come straight from the book without a search.
+  if (options->computer_book != NULL) {
+    best_move =
+        probeOpeningBook(options->computer_book, &game_data->state.position);
+  }
+  if (best_move != -1) {
+    stopPondering();
+  } else if (ponderHit(&game_data->state.position)) {
+    // The player made the expected move, so the search of the player's turn
+    // goes on as the computer's. The time it already spent counts.
+    int64_t deadline_ns = 0;
+    if (options->computer_limits.time_ms > 0) {
+      deadline_ns = ponder_search.start_ns +
+                    (int64_t)options->computer_limits.time_ms * 1000000;
+    }
+    pondering = FALSE;
+    if (waitForComputerSearch(game_data, &ponder_search, deadline_ns,
+                              error_message) == -1) {
+      return FALSE;
+    }
+    best_move = ponder_search.result.best_move;
+  } else {
+    stopPondering();
+    ComputerSearch Search;
+    if (startComputerSearch(&Search, &game_data->state.position,
+                            &game_data->evaluation, options->computer_limits,
+                            options) == 0) {
+      if (waitForComputerSearch(game_data, &Search, 0, error_message) == -1) {
+        return FALSE;
+      }
+      best_move = Search.result.best_move;
+    } else {
+      // Without a thread the game waits for the search like it used to.
+      SearchLimits limits = options->computer_limits;
+      if (options->evaluate) {
+        limits.evaluation = &game_data->evaluation;
+      }
+      best_move = searchBestMove(&game_data->state.position, limits,
+                                 options->computer_table,
+                                 options->computer_tablebase)
+                      .best_move;
+    }
+  }
+  if (best_move == -1) {
+    return TRUE;
+  }
+
+  // dropToken clears the token over the column, so the cursor is placed there
+  // first just like it would be for the player.
+  putCursorAt(game_data->players_initial_location.row,
+              game_data->players_initial_location.col +
+                  (best_move * CELL_TEXT_WIDTH));
+  dropToken(game_data, best_move);
+  return TRUE;
+}
+
+GameData createGameData(TerminalSettings* terminal_settings) {
+  GameData NewGame;
+
+  NewGame.state = createGameState();
+  NewGame.evaluation = createEvaluation(&NewGame.state.position);
+  NewGame.record.length = 0;
+  resetDrawnScreen(&NewGame.drawn);
+
+  // Populates array with BOARD_CELLS EMPTY tokes.
+  int i, j;
+  for (i = 0; i < BOARD_HEIGHT; ++i) {
+    for (j = 0; j < BOARD_WIDTH; ++j) {
+      NewGame.array[i][j] = EMPTY;
+    }
+  }
+
+  findGameLocations(&NewGame, terminal_settings);
+
+  return NewGame;
+}
+
+void disableBlinkingText() {
+  appendToFrame(BLINKING_OFF, strlen(BLINKING_OFF));
+}
+
+int disableRawInputMode(TerminalSettings* terminal_settings,
+                        char* error_message) {
+  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &terminal_settings->orig_termios) ==
+      -1) {
+    strcat(error_message, "die->disableRawInputMode->tcsetattr");
+    return -1;
+  }
+  return 0;
+}
+
+void displayBlueColorText() { appendToFrame(BLUE_COLOR, strlen(BLUE_COLOR)); }
+
+int discardFrame() {
+  int length = frame_buffer.length;
+  frame_buffer.length = 0;
+  return length;
+}
+
+void displayCurrentPlayersToken(char* current_players_token) {
+  if (strcmp(current_players_token, PLAYER1) == 0) {
+    displayRedColorText();
+  } else {
+    displayYellowColorText();
+  }
+  displayStrings(current_players_token);
+  moveCursor(1, LEFT);
+
+  displayDefaultColorText();
+}
+
+void displayDefaultColorText() {
+  appendToFrame(DEFAULT_COLOR, strlen(DEFAULT_COLOR));
+}
+
+void displayDirectionsStatusBar(GameData* game_data) {
+  if (game_data->drawn.directions_status_bar == DIRECTIONS_BAR) {
+    return;
+  }
+  game_data->drawn.directions_status_bar = DIRECTIONS_BAR;
+
+  putCursorAt(game_data->directions_status_bar_location.row,
+              game_data->blank_line_column_location.col);
+  displayStrings(BLANK_LINE);
+  putCursorAt(game_data->directions_status_bar_location.row + 1,
+              game_data->blank_line_column_location.col);
+  displayStrings(BLANK_LINE);
+
+  putCursorAt(game_data->directions_status_bar_location.row,
+              game_data->directions_status_bar_location.col);
+  displayBlueColorText();
+  displayStrings(DIRECTION_ARROW);
+  putCursorAt(game_data->directions_status_bar_location.row + 1,
+              game_data->directions_status_bar_location.col);
+  displayStrings(DIRECTIONS_ENTER);
+  displayDefaultColorText();
+}
+
+void displayEndGameStatusBar(GameData* game_data) {
+  game_data->drawn.directions_status_bar = END_GAME_BAR;
+
+  putCursorAt(game_data->end_game_status_bar_location.row,
+              game_data->blank_line_column_location.col);
+  displayStrings(BLANK_LINE);
+  putCursorAt(game_data->end_game_status_bar_location.row + 1,
+              game_data->blank_line_column_location.col);
+  displayStrings(BLANK_LINE);
+
+  putCursorAt(game_data->end_game_status_bar_location.row,
+              game_data->end_game_status_bar_location.col);
+  displayBlueColorText();
+  displayStrings(ENDGAME_DIRECTIONS);
+  displayDefaultColorText();
+}
+
+void displayGameBoard(GameData* game_data) {
+  clearTerm();
+  resetDrawnScreen(&game_data->drawn);
+  displayTitle(game_data->connect_four_title_location);
+  displayDirectionsStatusBar(game_data);
+  drawGameBoard(game_data->game_board_location);
+}
+
+void displaySearchStatusBar(GameData* game_data, const SearchResult* progress) {
+  char status[sizeof(BLANK_LINE)];
+  double seconds = progress->elapsed_ns / 1e9;
+  snprintf(status, sizeof(status), "DEPTH %d MOVE %d SCORE %d %.0fK NPS",
+           progress->depth, progress->best_move + 1, progress->score,
+           seconds > 0 ? progress->nodes / seconds / 1000 : 0);
+
+  clearSearchStatusBar(game_data);
+  putCursorAt(game_data->search_status_bar_location.row,
+              game_data->blank_line_column_location.col +
+                  centerText(BLANK_LINE) - centerText(status));
+  displayBlueColorText();
+  displayStrings(status);
+  displayDefaultColorText();
+}
+
+void displayStrings(char* item) { appendToFrame(item, strlen(item)); }
+
+void displayRedColorText() { appendToFrame(RED_COLOR, strlen(RED_COLOR)); }
+
+void displayTitle(CursorLocation connect_four_title_location) {
+  putCursorAt(connect_four_title_location.row, connect_four_title_location.col);
+  displayStrings(TITLE);
+}
+
+void displayTokenAt(int array[BOARD_HEIGHT][BOARD_WIDTH], int col, int row) {
+  if (array[row][col] == 0) {
+    displayRedColorText();
+    appendToFrame(PLAYER1, strlen(PLAYER1));
+    displayDefaultColorText();
+  } else if (array[row][col] == 1) {
+    displayYellowColorText();
+    appendToFrame(PLAYER2, strlen(PLAYER2));
+    displayDefaultColorText();
+  } else {
+    appendToFrame(" ", 1);
+  }
+}
+
+void displayTokens(GameData* game_data) {
+  int cursor_col = game_data->first_token_location.col;
+  int cursor_row = game_data->first_token_location.row;
+  int token_col, token_row;
+  for (token_col = 0; token_col < BOARD_WIDTH; ++token_col) {
+    for (token_row = 0; token_row < BOARD_HEIGHT; ++token_row) {
+      // Only the cells that changed since the last frame are drawn.
+      int* drawn_token = &game_data->drawn.array[token_row][token_col];
+      if (*drawn_token != game_data->array[token_row][token_col]) {
+        *drawn_token = game_data->array[token_row][token_col];
+        putCursorAt(cursor_row, cursor_col);
+        displayTokenAt(game_data->array, token_col, token_row);
+      }
+      // Plus 2 is used because there are two spaces between the rows on the
+      // ASCII representation of the board.
+      cursor_row += 2;
+    }
+    cursor_row = game_data->first_token_location.row;
+    // Plus CELL_TEXT_WIDTH is used because that is the distance between the
+    // columns on the ASCII representation of the board.
+    cursor_col += CELL_TEXT_WIDTH;
+  }
+}
+
+void displayTurnStatusBar(GameData* game_data) {
+  int turn_status_bar = currentPlayer(&game_data->state.position) == RED
+                            ? P1_TURN_BAR
+                            : P2_TURN_BAR;
+  if (game_data->drawn.turn_status_bar == turn_status_bar) {
+    return;
+  }
+  // P1TURN and P2TURN are the same length, so one covers the other without
+  // blanking the line first.
+  if (game_data->drawn.turn_status_bar != P1_TURN_BAR &&
+      game_data->drawn.turn_status_bar != P2_TURN_BAR) {
+    putCursorAt(game_data->turn_status_bar_location.row,
+                game_data->blank_line_column_location.col);
+    displayStrings(BLANK_LINE);
+  }
+  game_data->drawn.turn_status_bar = turn_status_bar;
+
+  putCursorAt(game_data->turn_status_bar_location.row,
+              game_data->turn_status_bar_location.col);
+  if (currentPlayer(&game_data->state.position) == RED) {
+    displayRedColorText();
+    displayStrings(P1TURN);
+    displayDefaultColorText();
+  } else {
+    displayYellowColorText();
+    displayStrings(P2TURN);
+    displayDefaultColorText();
+  }
+}
+
+void displayWinStatusBar(GameData* game_data) {
+  game_data->drawn.turn_status_bar = WIN_BAR;
+
+  putCursorAt(game_data->winner_status_bar_location.row,
+              game_data->blank_line_column_location.col);
+  displayStrings(BLANK_LINE);
+
+  // The last token fills the board in a draw, without completing a line.
+  // The bar is placed for the winner strings, a draw is centered within it.
+  ConnectFourLine line;
+  boolean draw = game_data->state.last_drop_row == -1 ||
+                 !findConnectFourThrough(&game_data->state.position,
+                                         game_data->state.last_drop_row,
+                                         game_data->state.last_drop_col, &line);
+  putCursorAt(game_data->winner_status_bar_location.row,
+              game_data->winner_status_bar_location.col +
+                  (draw ? centerText(P1WIN) - centerText(DRAW) : 0));
+  enableBlinkingText();
+  if (draw) {
+    displayStrings(DRAW);
+  } else if (currentPlayer(&game_data->state.position) == RED) {
+    displayYellowColorText();
+    displayStrings(P2WIN);
+  } else {
+    displayRedColorText();
+    displayStrings(P1WIN);
+  }
+  displayDefaultColorText();
+  disableBlinkingText();
+}
+
+void displayYellowColorText() {
+  appendToFrame(YELLOW_COLOR, strlen(YELLOW_COLOR));
+}
+
+void drawGameBoard(CursorLocation game_board_location) {
+  putCursorAt(game_board_location.row, game_board_location.col);
+  displayBlueColorText();
+
+  int i, j;
+  for (i = 0; i < BOARD_TEXT_HEIGHT; ++i) {
+    moveCursor(1, DOWN);
+
+    for (j = 0; j < BOARD_TEXT_WIDTH; ++j) {
+      if (i % 2 == 0) {
+        displayStrings(j % CELL_TEXT_WIDTH == 0 ? "+" : "-");
+      } else if (j % CELL_TEXT_WIDTH == 0) {
+        displayStrings("|");
+      } else
+        displayStrings(" ");
+    }
+    moveCursor(BOARD_TEXT_WIDTH, LEFT);
+  }
+
+  displayDefaultColorText();
+}
+
+boolean dropToken(GameData* game_data, int current_col_position) {
+  if (!canPlay(&game_data->state.position, current_col_position)) {
+    return FALSE;
+  }
+
+  // The height table gives the row the token lands in, the array only mirrors
+  // it for drawing.
+  game_data->array[BOARD_HEIGHT - 1 -
+                   game_data->state.position.heights[current_col_position]]
+                  [current_col_position] =
+      currentPlayer(&game_data->state.position);
+  addEvaluationToken(&game_data->evaluation, &game_data->state.position,
+                     current_col_position);
+  playGameMove(&game_data->state, current_col_position);
+  addRecordMove(&game_data->record, current_col_position);
+  displayStrings(" ");
+  return TRUE;
+}
+
+void enableBlinkingText() {
+  appendToFrame(BLINKING_ON, strlen(BLINKING_ON));
+}
+
+int enableRawInputMode(struct termios OriginalTerm, char* error_message) {
+  struct termios new_settings = OriginalTerm;
+
+  // Documentation for termios.h flags:
+  // pubs.opengroup.org/onlinepubs/000095399/basedefs/termios.h.html
+  turnOffIflags(&new_settings.c_iflag);
+  turnOffOflags(&new_settings.c_oflag);
+  turnOffCflags(&new_settings.c_cflag);
+  turnOffLflags(&new_settings.c_lflag);
+  enableBlockingRead(&new_settings);
+  return applyNewterminal_settings(new_settings, error_message);
+}
+
+void enableBlockingRead(struct termios* new_settings) {
+  new_settings->c_cc[VMIN] = 1;
+  new_settings->c_cc[VTIME] = 0;
+}
+
+boolean endGame(GameData* game_data, char* error_message) {
+  displayEndGameStatusBar(game_data);
+
+  char player_input;
+  while (TRUE) {
+    int input = playerInputReader(&player_input, error_message);
+    if (input == -1) {
+      return 0;
+    }
+    if (input == SEARCH_PROGRESS) {
+      continue;
+    }
+    if (input == WINDOW_RESIZED) {
+      resizeGame(game_data);
+      displayWinStatusBar(game_data);
+      displayEndGameStatusBar(game_data);
+      connectFourAtLastDrop(game_data);
+      continue;
+    }
+
+    switch (player_input) {
+    case 'y':
+    case 'Y':
+      return TRUE;
+      break;
+    case CTRL_KEY('q'):
+    case 'n':
+    case 'N':
+      return FALSE;
+      break;
+    }
+  }
+}
+
+void exitProgram(TerminalSettings* terminal_settings, char* error_message) {
+  clearScreen();
+  moveCursor(0, CORNER);
+  unhideCursor();
+  flushFrame();
+
+  if (disableRawInputMode(terminal_settings, error_message) == -1) {
+    strcat(error_message,
+           " Failed to disable Raw Input Mode. Restart terminal.");
+  }
+
+  if (strcmp(error_message, NO_ERRORS) == 0) {
+    exit(0);
+  } else {
+    perror(error_message);
+    exit(1);
+  }
+}
+
+void flushFrame() {
+  int written = 0;
+  while (written < frame_buffer.length) {
+    int result = write(STDOUT_FILENO, frame_buffer.data + written,
+                       frame_buffer.length - written);
+    if (result == -1 && errno != EINTR && errno != EAGAIN) {
+      break;
+    }
+    if (result > 0) {
+      written += result;
+    }
+  }
+  frame_buffer.length = 0;
+}
+
+CursorLocation findBlankLineLocation(TerminalSettings* terminal_settings) {
+  CursorLocation BlankLineCol;
+  BlankLineCol.col =
+      (terminal_settings->screen_cols / 2) - centerText(BLANK_LINE);
+  BlankLineCol.row = 0;
+  return BlankLineCol;
+}
+
+CursorLocation
+findConnectFourTitleLocation(TerminalSettings* terminal_settings) {
+  CursorLocation Title;
+
+  Title.col = (terminal_settings->screen_cols / 2) - centerText(TITLE);
+  Title.row = (terminal_settings->screen_rows / 2) + TITLE_OFFSET;
+
+  return Title;
+}
+
+char* findCurrentPlayersToken(int move_counter) {
+  if (move_counter % 2 == 0) {
+    return PLAYER1;
+  } else {
+    return PLAYER2;
+  }
+}
+
+CursorLocation
+findDirectionsStatusBarLocation(TerminalSettings* terminal_settings) {
+  CursorLocation Direct;
+
+  Direct.col =
+      (terminal_settings->screen_cols / 2) - centerText(DIRECTION_ARROW);
+  Direct.row = (terminal_settings->screen_rows / 2) + BOTTOM_BAR_OFFSET;
+
+  return Direct;
+}
+
+CursorLocation
+findEndGameStatusBarLocation(TerminalSettings* terminal_settings) {
+  CursorLocation End;
+
+  End.col =
+      (terminal_settings->screen_cols / 2) - centerText(ENDGAME_DIRECTIONS);
+  End.row = (terminal_settings->screen_rows / 2) + BOTTOM_BAR_OFFSET;
+
+  return End;
+}
+
+CursorLocation findFirstTokenLocation(TerminalSettings* terminal_settings) {
+  CursorLocation FirstToken;
+
+  FirstToken.col =
+      (terminal_settings->screen_cols / 2) - ((BOARD_TEXT_WIDTH / 2) - 2);
+  FirstToken.row = (terminal_settings->screen_rows / 2) + FIRST_TOKEN_OFFSET;
+
+  return FirstToken;
+}
+
+CursorLocation findGameBoardLocation(TerminalSettings* terminal_settings) {
+  CursorLocation GameBoard;
+
+  GameBoard.col = (terminal_settings->screen_cols / 2) - (BOARD_TEXT_WIDTH / 2);
+  // drawGameBoard moves down a line before it draws the top edge.
+  GameBoard.row =
+      (terminal_settings->screen_rows / 2) + BOARD_TOP_OFFSET - 1;
+
+  return GameBoard;
+}
+
+void findGameLocations(GameData* game_data,
+                       TerminalSettings* terminal_settings) {
+  game_data->connect_four_title_location =
+      findConnectFourTitleLocation(terminal_settings);
+  game_data->game_board_location = findGameBoardLocation(terminal_settings);
+  game_data->first_token_location = findFirstTokenLocation(terminal_settings);
+  game_data->players_initial_location =
+      findPlayersInitialLocation(terminal_settings);
+  game_data->directions_status_bar_location =
+      findDirectionsStatusBarLocation(terminal_settings);
+  game_data->turn_status_bar_location =
+      findTurnStatusBarLocation(terminal_settings);
+  game_data->search_status_bar_location =
+      findSearchStatusBarLocation(terminal_settings);
+  game_data->winner_status_bar_location =
+      findWinnerStatusBarLocation(terminal_settings);
+  game_data->blank_line_column_location =
+      findBlankLineLocation(terminal_settings);
+  game_data->end_game_status_bar_location =
+      findEndGameStatusBarLocation(terminal_settings);
+}
+
+CursorLocation findPlayersInitialLocation(TerminalSettings* terminal_settings) {
+  CursorLocation Players;
+
+  Players.col =
+      (terminal_settings->screen_cols / 2) - ((BOARD_TEXT_WIDTH / 2) - 2);
+  Players.row = (terminal_settings->screen_rows / 2) + PLAYERS_OFFSET;
+
+  return Players;
+}
+
+CursorLocation
+findSearchStatusBarLocation(TerminalSettings* terminal_settings) {
+  CursorLocation Search;
+
+  Search.col = (terminal_settings->screen_cols / 2) - centerText(BLANK_LINE);
+  Search.row = (terminal_settings->screen_rows / 2) + SEARCH_BAR_OFFSET;
+
+  return Search;
+}
+
+CursorLocation findTurnStatusBarLocation(TerminalSettings* terminal_settings) {
+  CursorLocation Turn;
+
+  Turn.col = (terminal_settings->screen_cols / 2) - centerText(P1TURN);
+  Turn.row = (terminal_settings->screen_rows / 2) + TURN_BAR_OFFSET;
+
+  return Turn;
+}
+
+CursorLocation
+findWinnerStatusBarLocation(TerminalSettings* terminal_settings) {
+  CursorLocation WinStatusBar;
+
+  WinStatusBar.col = (terminal_settings->screen_cols / 2) - centerText(P1WIN);
+  WinStatusBar.row = (terminal_settings->screen_rows / 2) + TURN_BAR_OFFSET;
+
+  return WinStatusBar;
+}
+
+boolean gamePlayLoop(GameData* game_data, GameOptions* options,
+                     char* error_message) {
+  if (options->computer_opponent &&
+      currentPlayer(&game_data->state.position) == YELLOW) {
+    int move_counter = game_data->state.position.move_counter;
+    if (!computerTurn(game_data, options, error_message)) {
+      return FALSE;
+    }
+    // Without a move to make the turn falls to the keyboard, where the game
+    // can still be quit.
+    if (game_data->state.position.move_counter != move_counter) {
+      return TRUE;
+    }
+  }
+  // The computer searches its reply while the player thinks.
+  if (options->computer_opponent && options->ponder &&
+      currentPlayer(&game_data->state.position) == RED) {
+    startPondering(game_data, options);
+  }
+
+  char* current_players_token =
+      findCurrentPlayersToken(game_data->state.position.move_counter);
+  putCursorAt(game_data->players_initial_location.row,
+              game_data->players_initial_location.col);
+  displayCurrentPlayersToken(current_players_token);
+
+  char player_input;
+  int current_player_turn = TRUE;
+  int current_position = 0;
+  while (current_player_turn) {
+    int input = playerInputReader(&player_input, error_message);
+    if (input == -1) {
+      stopPondering();
+      return FALSE;
+    }
+    // The pondering search reports to nobody until it becomes the computer's.
+    if (input == SEARCH_PROGRESS) {
+      continue;
+    }
+    if (input == WINDOW_RESIZED) {
+      resizeGame(game_data);
+      displayTurnStatusBar(game_data);
+      putCursorAt(game_data->players_initial_location.row,
+                  game_data->players_initial_location.col +
+                      (current_position * CELL_TEXT_WIDTH));
+      displayCurrentPlayersToken(current_players_token);
+      continue;
+    }
+
+    switch (player_input) {
+    // Used for quitting the game manually.
+    case CTRL_KEY('q'):
+      stopPondering();
+      return FALSE;
+      break;
+
+    case RIGHT_ARROW:
+      // Wrap token to the other side logic. If the token is at the right
+      // boundary and the player hits the right key, the token is placed at the
+      // left boundary.
+      if (current_position == RIGHT_BOUNDARY) {
+        placeTokenAtLeftBoundary(current_players_token, &current_position);
+      } else {
+        moveTokenRight(current_players_token, &current_position);
+      }
+      break;
+
+    case LEFT_ARROW:
+      // Wrap token to the other side logic. If the token is at the left
+      // boundary and the player hits the left key, the token is placed at the
+      // right boundary.
+      if (current_position == LEFT_BOUNDARY) {
+        placeTokenAtRightBoundary(current_players_token, &current_position);
+      } else {
+        moveTokenLeft(current_players_token, &current_position);
+      }
+      break;
+
+    case ENTER:
+      if (dropToken(game_data, current_position)) {
+        current_player_turn = FALSE;
+        // Any other move than the expected one makes the pondering useless.
+        if (!ponderHit(&game_data->state.position)) {
+          stopPondering();
+        }
+      }
+      break;
+    }
+  }
+  return TRUE;
+}
+
+int getWindowSize(int* out_rows, int* out_cols) {
+  struct winsize Ws;
+
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &Ws) == -1 || Ws.ws_col == 0) {
+    return -1;
+  } else {
+    *out_cols = Ws.ws_col;
+    *out_rows = Ws.ws_row;
+    return 0;
+  }
+}
+
+static void handleWindowResize(int signal_number) {
+  (void)signal_number;
+  int saved_errno = errno;
+  // A full pipe already holds a pending resize.
+  ssize_t written = write(resize_pipe[1], "", 1);
+  (void)written;
+  errno = saved_errno;
+}
+
+void hideCursor() { appendToFrame(HIDE, strlen(HIDE)); }
+
+TerminalSettings initializeTerminalSettings(char* error_message) {
+  TerminalSettings OldSettings;
+  OldSettings.successful_initialization = 0;
+
+  if (tcgetattr(STDIN_FILENO, &OldSettings.orig_termios) == -1) {
+    strcat(error_message, "initializeTerminalSettings->tcgetattr");
+    OldSettings.successful_initialization = -1;
+  }
+
+  // find terminal window size to center the game display.
+  if (getWindowSize(&OldSettings.screen_rows, &OldSettings.screen_cols) == -1) {
+    strcat(error_message, "initialize_terminal_settings->getWindowSize");
+    OldSettings.successful_initialization = -1;
+  }
+
+  return OldSettings;
+}
+
+int initializeInputEvents(char* error_message) {
+  int* pipes[2] = {resize_pipe, search_pipe};
+  int i, j;
+  for (i = 0; i < 2; ++i) {
+    if (pipe(pipes[i]) == -1) {
+      strcat(error_message, "initializeInputEvents->pipe");
+      return -1;
+    }
+    for (j = 0; j < 2; ++j) {
+      if (fcntl(pipes[i][j], F_SETFL, O_NONBLOCK) == -1 ||
+          fcntl(pipes[i][j], F_SETFD, FD_CLOEXEC) == -1) {
+        strcat(error_message, "initializeInputEvents->fcntl");
+        return -1;
+      }
+    }
+  }
+
+  struct sigaction Action;
+  memset(&Action, 0, sizeof(Action));
+  Action.sa_handler = handleWindowResize;
+  sigemptyset(&Action.sa_mask);
+  Action.sa_flags = SA_RESTART;
+  if (sigaction(SIGWINCH, &Action, NULL) == -1) {
+    strcat(error_message, "initializeInputEvents->sigaction");
+    return -1;
+  }
+  return 0;
+}
+
+void logGame(GameData* game_data, GameOptions* options) {
+  if (options->game_log == NULL || game_data->record.length == 0) {
+    return;
+  }
+  // A lost record is not worth interrupting the game for.
+  appendGameRecord(options->game_log, &game_data->record);
+  game_data->record.length = 0;
+}
+
+void moveCursor(int amount, char* direction) {
+  char esc[20] = ESC;
+  if (amount > 1) {
+    char buffer[12];
+
+    sprintf(buffer, "%d", amount);
+    strcat(esc, buffer);
+  }
+  strcat(esc, direction);
+
+  appendToFrame(esc, strlen(esc));
+}
+
+void moveTokenLeft(char* current_players_token, int* current_position) {
+  displayStrings(" ");
+  moveCursor(CELL_TEXT_WIDTH + 1, LEFT);
+  displayCurrentPlayersToken(current_players_token);
+  *current_position = *current_position - 1;
+}
+
+void moveTokenRight(char* current_players_token, int* current_position) {
+  displayStrings(" ");
+  moveCursor(CELL_TEXT_WIDTH - 1, RIGHT);
+  displayCurrentPlayersToken(current_players_token);
+  *current_position = *current_position + 1;
+}
+
+static void notifySearchEvent() {
+  // A full pipe already holds a pending event.
+  ssize_t written = write(search_pipe[1], "", 1);
+  (void)written;
+}
+
+static boolean parseInputKey(char* out_key) {
+  const char* bytes = input_buffer.data + input_buffer.start;
+  int used;
+  if (input_buffer.length == 0) {
+    return FALSE;
+  }
+  if (bytes[0] != '\x1b') {
+    used = 1;
+  } else if (input_buffer.length < 2) {
+    return FALSE;
+  } else if (bytes[1] != '[') {
+    used = 2;
+  } else if (input_buffer.length < 3) {
+    return FALSE;
+  } else {
+    used = 3;
+  }
+
+  *out_key = bytes[used - 1];
+  input_buffer.start += used;
+  input_buffer.length -= used;
+  return TRUE;
+}
+
+void placeTokenAtLeftBoundary(char* current_players_token,
+                              int* current_position) {
+  displayStrings(" ");
+  moveCursor(CELL_TEXT_WIDTH * (BOARD_WIDTH - 1) + 1, LEFT);
+  displayCurrentPlayersToken(current_players_token);
+  *current_position = LEFT_BOUNDARY;
+}
+
+void placeTokenAtRightBoundary(char* current_players_token,
+                               int* current_position) {
+  displayStrings(" ");
+  moveCursor(CELL_TEXT_WIDTH * (BOARD_WIDTH - 1) - 1, RIGHT);
+  displayCurrentPlayersToken(current_players_token);
+  *current_position = RIGHT_BOUNDARY;
+}
+
+int playerInputReader(char* player_input, char* error_message) {
+  return playerInputReaderUntil(player_input, 0, error_message);
+}
+
+int playerInputReaderUntil(char* player_input, int64_t deadline_ns,
+                           char* error_message) {
+  // Everything drawn since the last key press goes out before waiting on the
+  // next one.
+  flushFrame();
+
+  while (!parseInputKey(player_input)) {
+    int timeout_ms = -1;
+    if (deadline_ns != 0) {
+      int64_t remaining_ns = deadline_ns - currentTimeNs();
+      if (remaining_ns <= 0) {
+        return INPUT_TIMEOUT;
+      }
+      timeout_ms = remaining_ns / 1000000 + 1;
+    }
+    // Only the start of an escape sequence is buffered. The rest of it is
+    // normally already on its way, a lone escape key is not.
+    if (input_buffer.length > 0 &&
+        (timeout_ms == -1 || timeout_ms > ESCAPE_TIMEOUT_MS)) {
+      timeout_ms = ESCAPE_TIMEOUT_MS;
+    }
+
+    int event = waitForInput(timeout_ms, error_message);
+    if (event == -1 || event == WINDOW_RESIZED || event == SEARCH_PROGRESS) {
+      return event;
+    }
+    if (event == 0 && input_buffer.length > 0) {
+      *player_input = input_buffer.data[input_buffer.start +
+                                        input_buffer.length - 1];
+      input_buffer.length = 0;
+      break;
+    }
+  }
+  return 0;
+}
+
+static boolean ponderHit(const Position* position) {
+  return pondering &&
+         findPositionKey(&ponder_search.position) == findPositionKey(position);
+}
+
+void putCursorAt(int row, int col) {
+  char esc[32] = ESC;
+
+  char buffer[12];
+  sprintf(buffer, "%d", row);
+  strcat(esc, buffer);
+  strcat(esc, ";");
+
+  sprintf(buffer, "%d", col);
+  strcat(esc, buffer);
+
+  strcat(esc, "H");
+
+  appendToFrame(esc, strlen(esc));
+}
+
+void showConnectFour(GameData* game_data, int row, int col, int vector) {
+  enableBlinkingText();
+  int i;
+  int temp_col = col;
+  int temp_row = row;
+  switch (vector) {
+  // Using the first token as a base, the rows and col have thier indexs
+  // multipled by the distance between tokens(2 and 4 respectively) to overwrite
+  // the token in that position with a blinking token.
+  case HORIZONTAL:
+    for (i = 0; i < CONNECT_LENGTH; ++i) {
+      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
+                  game_data->first_token_location.col +
+                      (temp_col * CELL_TEXT_WIDTH));
+      displayTokenAt(game_data->array, temp_col--, temp_row);
+    }
+
+    break;
+
+  case LEFTDIAG:
+    for (i = 0; i < CONNECT_LENGTH; ++i) {
+      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
+                  game_data->first_token_location.col +
+                      (temp_col * CELL_TEXT_WIDTH));
+      displayTokenAt(game_data->array, temp_col--, temp_row--);
+    }
+
+    break;
+
+  case VERTICAL:
+    for (i = 0; i < CONNECT_LENGTH; ++i) {
+      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
+                  game_data->first_token_location.col +
+                      (temp_col * CELL_TEXT_WIDTH));
+      displayTokenAt(game_data->array, temp_col, temp_row--);
+    }
+
+    break;
+
+  case RIGHTDIAG:
+    for (i = 0; i < CONNECT_LENGTH; ++i) {
+      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
+                  game_data->first_token_location.col +
+                      (temp_col * CELL_TEXT_WIDTH));
+      displayTokenAt(game_data->array, temp_col++, temp_row--);
+    }
+
+    break;
+  }
+  disableBlinkingText();
+}
+
+void recreateGame(GameData* game_data) {
+  game_data->state = createGameState();
+  game_data->evaluation = createEvaluation(&game_data->state.position);
+  game_data->record.length = 0;
+  int i, j;
+  for (i = 0; i < BOARD_HEIGHT; ++i) {
+    for (j = 0; j < BOARD_WIDTH; ++j) {
+      game_data->array[i][j] = EMPTY;
+    }
+  }
+
+  displayDirectionsStatusBar(game_data);
+  displayTurnStatusBar(game_data);
+  displayTokens(game_data);
+}
+
+static void reportSearchProgress(const SearchResult* result,
+                                 void* computer_search) {
+  ComputerSearch* search = computer_search;
+  pthread_mutex_lock(&search->lock);
+  search->progress = *result;
+  pthread_mutex_unlock(&search->lock);
+  notifySearchEvent();
+}
+
+void resetDrawnScreen(DrawnScreen* drawn) {
+  int i, j;
+  for (i = 0; i < BOARD_HEIGHT; ++i) {
+    for (j = 0; j < BOARD_WIDTH; ++j) {
+      drawn->array[i][j] = UNDRAWN_TOKEN;
+    }
+  }
+  drawn->turn_status_bar = UNDRAWN_BAR;
+  drawn->directions_status_bar = UNDRAWN_BAR;
+}
+
+void resizeGame(GameData* game_data) {
+  TerminalSettings Resized;
+  if (getWindowSize(&Resized.screen_rows, &Resized.screen_cols) == 0) {
+    findGameLocations(game_data, &Resized);
+  }
+  displayGameBoard(game_data);
+  displayTokens(game_data);
+}
+
+static int startComputerSearch(ComputerSearch* search,
+                               const Position* position,
+                               const Evaluation* evaluation,
+                               SearchLimits limits, GameOptions* options) {
+  search->position = *position;
+  search->evaluation = *evaluation;
+  search->limits = limits;
+  if (options->evaluate) {
+    search->limits.evaluation = &search->evaluation;
+  }
+  search->limits.stop = &search->stop;
+  search->limits.report = reportSearchProgress;
+  search->limits.report_data = search;
+  search->table = options->computer_table;
+  search->tablebase = options->computer_tablebase;
+  search->stop = 0;
+  search->start_ns = currentTimeNs();
+  search->progress.depth = 0;
+  search->done = FALSE;
+  pthread_mutex_init(&search->lock, NULL);
+  if (pthread_create(&search->thread, NULL, computerSearchThread, search) !=
+      0) {
+    pthread_mutex_destroy(&search->lock);
+    return -1;
+  }
+  return 0;
+}
+
+void startPondering(GameData* game_data, GameOptions* options) {
+  if (pondering) {
+    return;
+  }
+
+  Position expected = game_data->state.position;
+  int col = NO_MOVE;
+  TranspositionEntry entry;
+  if (options->computer_table != NULL &&
+      probeTranspositionTable(options->computer_table,
+                              findPositionKey(&expected), &entry)) {
+    col = entry.best_move;
+  }
+  unsigned moves = findLegalMoves(&expected);
+  if (moves == 0) {
+    return;
+  }
+  if (col == NO_MOVE || !canPlay(&expected, col)) {
+    col = popLegalMove(&moves);
+  }
+  // A move that ends the game leaves no reply to search.
+  if (isWinningMove(&expected, col) ||
+      expected.move_counter + 1 == BOARD_CELLS) {
+    return;
+  }
+  Evaluation evaluation = game_data->evaluation;
+  addEvaluationToken(&evaluation, &expected, col);
+  playMove(&expected, col);
+
+  // The computer's time budget only starts once the player moved.
+  SearchLimits limits = options->computer_limits;
+  limits.time_ms = 0;
+  pondering = startComputerSearch(&ponder_search, &expected, &evaluation,
+                                  limits, options) == 0;
+}
+
+static void stopComputerSearch(ComputerSearch* search) {
+  __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+  pthread_join(search->thread, NULL);
+  pthread_mutex_destroy(&search->lock);
+  // The thread's last event can still be in the pipe when done was seen
+  // first, and no event outlives its search.
+  char drained[16];
+  while (read(search_pipe[0], drained, sizeof(drained)) > 0) {
+  }
+}
+
+void stopPondering() {
+  if (pondering) {
+    stopComputerSearch(&ponder_search);
+    pondering = FALSE;
+  }
+}
+
+void turnOffCflags(tcflag_t* c_cflag) {
+  // CS8: misc flag
+  *c_cflag |= (CS8);
+}
+
+void turnOffIflags(tcflag_t* c_iflag) {
+  // BRKINT: misc flag, ICRNL: ctrl-m, INPCK: misc flag,
+  // ISTRIP: misc flag, IXON: ctrl_s and ctrl_q
+  *c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+}
+
+void turnOffLflags(tcflag_t* c_lflag) {
+  // ECHO:Print text to screen, ICANON:Canonical Mode, IEXTEN & ISIG:ctrl=c
+  // and ctrl-v
+  *c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+}
+
+void turnOffOflags(tcflag_t* c_oflag) {
+  // OPOST: output processing /r/n
+  *c_oflag &= ~(OPOST);
+}
+
+void unhideCursor() { appendToFrame(UNHIDE, strlen(UNHIDE)); }
+
+static int waitForComputerSearch(GameData* game_data, ComputerSearch* search,
+                                 int64_t deadline_ns, char* error_message) {
+  int status = 0;
+  char key;
+  while (TRUE) {
+    pthread_mutex_lock(&search->lock);
+    SearchResult progress = search->progress;
+    boolean done = search->done;
+    pthread_mutex_unlock(&search->lock);
+    if (progress.depth > 0) {
+      displaySearchStatusBar(game_data, &progress);
+    }
+    if (done) {
+      break;
+    }
+
+    // The progress is read again at the top of the loop after every event.
+    int input = playerInputReaderUntil(&key, deadline_ns, error_message);
+    if (input == WINDOW_RESIZED) {
+      resizeGame(game_data);
+      displayTurnStatusBar(game_data);
+    } else if (input == INPUT_TIMEOUT) {
+      __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+      deadline_ns = 0;
+    } else if (input == -1 || (input == 0 && key == CTRL_KEY('q'))) {
+      status = -1;
+      break;
+    } else if (input == 0 && (key == ENTER || key == ' ')) {
+      // The computer plays the best move of the last complete depth.
+      __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+    }
+  }
+
+  stopComputerSearch(search);
+  clearSearchStatusBar(game_data);
+  return status;
+}
+
+static int waitForInput(int timeout_ms, char* error_message) {
+  struct pollfd Events[3];
+  Events[0].fd = STDIN_FILENO;
+  Events[0].events = POLLIN;
+  Events[1].fd = resize_pipe[0];
+  Events[1].events = POLLIN;
+  Events[2].fd = search_pipe[0];
+  Events[2].events = POLLIN;
+  // Before initializeInputEvents there are no pipes, and poll() skips a
+  // negative fd.
+  int ready = poll(Events, 3, timeout_ms);
+  if (ready == -1) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    strcat(error_message, "playerInputReader->waitForInput->poll");
+    return -1;
+  }
+  if (ready == 0) {
+    return 0;
+  }
+
+  if (Events[1].revents & POLLIN) {
+    char drained[16];
+    while (read(resize_pipe[0], drained, sizeof(drained)) > 0) {
+    }
+    return WINDOW_RESIZED;
+  }
+
+  if (Events[2].revents & POLLIN) {
+    char drained[16];
+    while (read(search_pipe[0], drained, sizeof(drained)) > 0) {
+    }
+    return SEARCH_PROGRESS;
+  }
+
+  if (Events[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+    memmove(input_buffer.data, input_buffer.data + input_buffer.start,
+            input_buffer.length);
+    input_buffer.start = 0;
+    ssize_t bytes =
+        read(STDIN_FILENO, input_buffer.data + input_buffer.length,
+             INPUT_BUFFER_SIZE - input_buffer.length);
+    if (bytes <= 0) {
+      if (bytes == -1 && (errno == EINTR || errno == EAGAIN)) {
+        return 0;
+      }
+      // The terminal is gone, nothing will ever be read again.
+      strcat(error_message, "playerInputReader->waitForInput->read");
+      return -1;
+    }
+    input_buffer.length += bytes;
+    return INPUT_READY;
+  }
+  return 0;
+}
@@ -0,0 +1,412 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef GAME_H
+#define GAME_H
+
+#include <termios.h>
+
+#include "bitboard.h"
+#include "book.h"
+#include "eval.h"
+#include "record.h"
+#include "search.h"
+
+/*** Define ***/
+
+#define NO_ERRORS ""
+#define WINDOW_RESIZED 1
+#define SEARCH_PROGRESS 2
+#define INPUT_TIMEOUT 3
+
+/*** Structures ***/
+
+// DrawnScreen is the shadow of what the terminal currently shows, so a frame
+// only redraws the cells and status bars that changed. A token of
+// UNDRAWN_TOKEN is redrawn whatever the array holds.
+typedef struct DrawnScreen {
+  int array[BOARD_HEIGHT][BOARD_WIDTH];
+  int turn_status_bar;
+  int directions_status_bar;
+} DrawnScreen;
+
+typedef struct CursorLocation {
+  int row;
+  int col;
+} CursorLocation;
+
+// GameData is a game as the terminal shows it. The game itself is state, the
+// rest is where and what the terminal draws.
+typedef struct GameData {
+  GameState state;
+  // array mirrors state.position cell by cell for drawing. dropToken keeps
+  // both in sync.
+  int array[BOARD_HEIGHT][BOARD_WIDTH];
+  // evaluation is the static evaluation of state.position, updated by
+  // dropToken one token at a time.
+  Evaluation evaluation;
+  // record holds the moves of the game for the --log file.
+  GameRecord record;
+  // drawn outlives the game so a new game only clears the old tokens.
+  DrawnScreen drawn;
+  CursorLocation connect_four_title_location;
+  CursorLocation game_board_location;
+  CursorLocation first_token_location;
+  CursorLocation players_initial_location;
+  CursorLocation turn_status_bar_location;
+  CursorLocation search_status_bar_location;
+  CursorLocation directions_status_bar_location;
+  CursorLocation winner_status_bar_location;
+  CursorLocation end_game_status_bar_location;
+  CursorLocation blank_line_column_location;
+} GameData;
+
+// GameOptions holds what the game on the board needs of the command line: the
+// computer opponent and the game log.
+typedef struct GameOptions {
+  boolean computer_opponent;
+  SearchLimits computer_limits;
+  // evaluate makes the computer and --search score the positions at the depth
+  // limit with the static evaluation.
+  boolean evaluate;
+  // ponder makes the computer search its reply to the expected move during the
+  // player's turn.
+  boolean ponder;
+  // computer_table is kept between moves and games so the search starts warm.
+  TranspositionTable* computer_table;
+  // computer_book is the opening book given with --book, NULL without one.
+  OpeningBook* computer_book;
+  // computer_tablebase is the tablebase given with --tablebase, NULL without
+  // one.
+  Tablebase* computer_tablebase;
+  // game_log is the log given with --log that the games are appended to, NULL
+  // without one.
+  GameLog* game_log;
+} GameOptions;
+
+typedef struct TerminalSettings {
+  int successful_initialization;
+  int screen_rows;
+  int screen_cols;
+  struct termios orig_termios;
+} TerminalSettings;
+
+/*** Declorations ***/
+
+// appendToFrame adds length bytes to the frame buffer. The frame is flushed
+// first if the bytes do not fit.
+void appendToFrame(const char* bytes, int length);
+
+// applyNewTerSettings returns the new terminal settings that
+// initializeTerminalSettings() function establishes. error_message is used
+// incase of failures.
+int applyNewterminal_settings(struct termios new_settings, char* error_message);
+
+// centerText returns the offset of half the text length, which is used to
+// center the text in the terminal.
+int centerText(char* text);
+
+// clearScreen clears the screen.
+void clearScreen();
+
+// clearSearchStatusBar blanks the computer's search status bar.
+void clearSearchStatusBar(GameData* game_data);
+
+// clearTerm clears the terminal by clearing the screen, hiding the cursor, and
+// placing the cursor to the top right corner.
+void clearTerm();
+
+// connectFourAtLastDrop checks the four vectors through the last dropped token
+// and highlights the connect four if one is found. Returns 1 if found, 0
+// otherwise.
+boolean connectFourAtLastDrop(GameData* game_data);
+
+// connectFourOnLine returns 1 if the tokens of the line from the WIN_LINES
+// table are all the same player's, 0 otherwise or if the line is -1.
+boolean connectFourOnLine(int array[BOARD_HEIGHT][BOARD_WIDTH], int line);
+
+// connectFourPresent searches for the presence of a four tokens in a line
+// hoizontally, left diagonally, vertically, and right diagonally. Returns 1 if
+// found, 0 otherwise.
+boolean connectFourPresent(GameData* game_data);
+
+// connectFourHorizontal returns 1 if a connect four is found in the horizontal
+// vector in the array at the row and column index, 0 otherwise.
+boolean connectFourHorizontal(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                              int row, int col);
+
+// connectFourLeftDiagonal returns 1 if a connect four is found in the left
+// diagonal vector in the array at the row and column index, 0 otherwise.
+boolean connectFourLeftDiagonal(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                                int row, int col);
+
+// connectFourRightDiagonal returns 1 if a connect four is found in the right
+// diagonal vector in the array at the row and column index, 0 otherwise.
+boolean connectFourRightDiagonal(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                                 int row, int col);
+
+// connectFourVertical returns 1 if a connect four is found in the vertical
+// vector in the array at the row and column index, 0 otherwise.
+boolean connectFourVertical(int array[BOARD_HEIGHT][BOARD_WIDTH],
+                            int row, int col);
+
+// computerTurn searches for the computer's move on a search thread, showing
+// its progress and handling keys meanwhile, and drops the token in that
+// column the same way an ENTER key press does. Returns 0 if the player quit
+// or an error occurred, 1 otherwise.
+boolean computerTurn(GameData* game_data, GameOptions* options,
+                     char* error_message);
+
+// createGameData initializes the elements of the game_data struct.
+GameData createGameData(TerminalSettings* terminal_settings);
+
+// disableBlinkinText applies the default esc sequence to return the text to
+// default.
+void disableBlinkingText();
+
+// disableRawInputMode returns the terminal to the previous settings.
+// error_message is used in case of failures.
+int disableRawInputMode(TerminalSettings* terminal_settings,
+                        char* error_message);
+
+// discardFrame empties the frame buffer without writing it to the terminal.
+// Returns the number of bytes dropped.
+int discardFrame();
+
+// displayBlueColorText changes the text color to blue.
+void displayBlueColorText();
+
+// displayCurrentPlayersToken displays the current token that the player
+// interacts with prior to the token getting dropped.
+void displayCurrentPlayersToken(char* current_players_token);
+
+// displayDefaultColorText returns colored text to the default color.
+void displayDefaultColorText();
+
+// displayDirectionsStatusBar displays the status bar that contains the
+// directions for playing the game.
+void displayDirectionsStatusBar(GameData* game_data);
+
+// displayEndGameStatusBar displays the end game status bar upon a connect four
+// being found.
+void displayEndGameStatusBar(GameData* game_data);
+
+// displayGameBoard displays the title and game board.
+void displayGameBoard(GameData* game_data);
+
+// displayBlueColorText changes the text color to red.
+void displayRedColorText();
+
+// displaySearchStatusBar shows the depth, best move, score and nodes/sec of
+// the last completed depth of the computer's search.
+void displaySearchStatusBar(GameData* game_data, const SearchResult* progress);
+
+// displayStrings adds the string to the frame buffer.
+void displayStrings(char* item);
+
+// displayTitle displays the "CONNECT FOUR" title.
+void displayTitle(CursorLocation connect_four_title_location);
+
+// displayTokenAt displays the token in the game board in the array at the
+// column and row.
+void displayTokenAt(int array[BOARD_HEIGHT][BOARD_WIDTH], int col, int row);
+
+// displayTokens displays all the tokens that are present in the game data
+// array.
+void displayTokens(GameData* game_data);
+
+// displayTurnStatusBar displays which players turn it is by number and color.
+void displayTurnStatusBar(GameData* game_data);
+
+// displayWinStatusBar displays which player won when a connect four is
+// discovered, or that the game is a draw when the board filled up without
+// one.
+void displayWinStatusBar(GameData* game_data);
+
+// displayBlueColorText changes the text color to yellow.
+void displayYellowColorText();
+
+// drawGameBoard displays the outline of the game board.
+void drawGameBoard(CursorLocation game_board_location);
+
+// dropToken place the token in the game data array in the current column
+// position and stacks the token on top of the highest unused row index.
+// Returns FALSE if the column is full.
+boolean dropToken(GameData* game_data, int current_col_position);
+
+// enableBlinkingText bolds, inverts, and blinks the text. Used for the player
+// status bar and highlights the connect four tokens.
+void enableBlinkingText();
+
+// enableRawInputMode is user to prepare the terminal for the game.
+int enableRawInputMode(struct termios OriginalTerm, char* error_message);
+
+// enableBlockingRead makes read() wait for at least one byte. The input loop
+// only reads once poll() reports input, so the read never waits.
+void enableBlockingRead(struct termios* new_settings);
+
+// endGame is used after the game is won to allow the player to determine if
+// they want to replay the game or quit.
+boolean endGame(GameData* game_data, char* error_message);
+
+// exitProgram exits the game for both error and non error game states.
+void exitProgram(TerminalSettings* terminal_settings, char* error_message);
+
+// findBlankLineLocation returns the location to place the BLANK_LINE string,
+// based of the center of the terminal. Only finds the col, row is not used.
+CursorLocation findBlankLineLocation(TerminalSettings* terminal_settings);
+
+// findConnectFourLocation returns the location to place the TITLE string, based
+// of the center of the terminal.
+CursorLocation
+findConnectFourTitleLocation(TerminalSettings* terminal_settings);
+
+char* findCurrentPlayersToken(int move_counter);
+
+// findDirectionStatusBarLocation finds the location to place the
+// DIRECTION_ARROW and DIRECTION_ENTER strings, based of the center of the
+// terminal.
+CursorLocation
+findDirectionsStatusBarLocation(TerminalSettings* terminal_settings);
+
+// findEndGameStatusBarLocation returns the location to place the P1WIN and
+// P2WIN strings, based of the center of the terminal.
+CursorLocation
+findEndGameStatusBarLocation(TerminalSettings* terminal_settings);
+
+// findFirstTokenLocation returns the location to place the token at the [0][0]
+// index of the game data array, based of the center of the terminal.
+CursorLocation findFirstTokenLocation(TerminalSettings* terminal_settings);
+
+// findGameBoardLocation returns the location to place the game board, based of
+// the center of the terminal.
+CursorLocation findGameBoardLocation(TerminalSettings* terminal_settings);
+
+// findGameLocations places every part of the game, based of the center of the
+// terminal.
+void findGameLocations(GameData* game_data,
+                       TerminalSettings* terminal_settings);
+
+// findPlayersInitialLocation returns the location to place the token being
+// moved and dropped, based of the center of the terminal.
+CursorLocation findPlayersInitialLocation(TerminalSettings* terminal_settings);
+
+// findSearchStatusBarLocation returns the location of the computer's search
+// status bar, above the turn status bar.
+CursorLocation
+findSearchStatusBarLocation(TerminalSettings* terminal_settings);
+
+// findTurnStatusBarLocation returns the location to place the P1TURN and P2TURN
+// strings, based of the center of the terminal.
+CursorLocation findTurnStatusBarLocation(TerminalSettings* terminal_settings);
+
+// findWinnerStatusBarLocation returns the location to place a the
+// ENDGAME_DIRECTIONS string, based of the center of the terminal.
+CursorLocation findWinnerStatusBarLocation(TerminalSettings* terminal_settings);
+
+// flushFrame writes the frame buffer to the terminal with one write() and
+// empties it.
+void flushFrame();
+
+// gamePlayLoop contains the while loop that takes user input to move the
+// players token and drop the token. On the computer's turn the move comes from
+// computerTurn instead. error_message is used in case of failures.
+boolean gamePlayLoop(GameData* game_data, GameOptions* options,
+                     char* error_message);
+
+// getWindowSize gets the terminal size, which is used to center display.
+int getWindowSize(int* out_rows, int* out_cols);
+
+// hideCursor hides the cursor.
+void hideCursor();
+
+// initializeInputEvents makes SIGWINCH wake the input loop through a pipe.
+// error_message is used in case of failures.
+int initializeInputEvents(char* error_message);
+
+// initSettingsData initializes the elements of the termSettingData struct.
+TerminalSettings initializeTerminalSettings(char* error_message);
+
+// logGame appends the game played so far to options->game_log unless there is
+// no log or the game has no moves yet.
+void logGame(GameData* game_data, GameOptions* options);
+
+// moveCursor moves the cursor by an amount in the direction by adding the
+// escape sequence to the frame buffer.
+void moveCursor(int amount, char* direction);
+
+// moveTokenLeft moves the current token in play left.
+void moveTokenLeft(char* current_players_token, int* current_position);
+
+// moveTokenRight moves the current token in play right.
+void moveTokenRight(char* current_players_token, int* current_position);
+
+// placeTokenAtLeftBoundary moves the current token to the left boundary if the
+// token is at the right boundary and the player uses the right arrow key.
+void placeTokenAtLeftBoundary(char* current_players_token,
+                              int* current_position);
+
+// placeTokenAtRightBoundary moves the current token to the right boundary if
+// the token is at the left boundary and the player uses the left arrow key.
+void placeTokenAtRightBoundary(char* current_players_token,
+                               int* current_position);
+
+// playerInputReader stores the next key the player presses in player_input.
+// It sleeps in poll() until there is input, the window is resized or the
+// computer's search has news, so an idle game does not wake the CPU. Returns
+// -1 on an error, WINDOW_RESIZED or SEARCH_PROGRESS if that happened before a
+// key was pressed, 0 otherwise.
+int playerInputReader(char* player_input, char* error_message);
+
+// playerInputReaderUntil is playerInputReader that gives up at deadline_ns, a
+// currentTimeNs time stamp (0 for never), and returns INPUT_TIMEOUT then.
+int playerInputReaderUntil(char* player_input, int64_t deadline_ns,
+                           char* error_message);
+
+// putCursorAt puts the cursor at the row and col on the terminal by adding the
+// escape sequence to the frame buffer.
+void putCursorAt(int row, int col);
+
+// recreateGame resets the game state, its record and the board to restart the
+// game. The layout is kept, resizeGame keeps it up to date.
+void recreateGame(GameData* game_data);
+
+// resetDrawnScreen marks every token and status bar as undrawn so the next
+// frame draws all of them.
+void resetDrawnScreen(DrawnScreen* drawn);
+
+// resizeGame centers the game on the current window size and redraws the
+// board and the tokens. The caller redraws the status bars it shows.
+void resizeGame(GameData* game_data);
+
+// showConnectFour highlights the connect four tokens found by
+// connectFourPresent functions.
+void showConnectFour(GameData* game_data, int row, int col, int vector);
+
+// startPondering starts searching the computer's reply to the player's
+// expected move: the best move the table holds for the player, or the first
+// legal column without one.
+void startPondering(GameData* game_data, GameOptions* options);
+
+// stopPondering stops the search of the player's turn, if there is one, and
+// drops the events it left for the input loop.
+void stopPondering();
+
+// turnOffCflags turns off CS8 flag. Used by enableRawInputMode.
+void turnOffCflags(tcflag_t* c_cflag);
+
+// turnOffIflags turns off BRKINT, ICRNL, INPCK, ISTRIP, IXON flags. Used by
+// enableRawInputMode.
+void turnOffIflags(tcflag_t* c_iflag);
+
+// turnOffLflags turns off ECHO, ICANNON, IEXTEN, ISIG flags. Used by
+// enableRawInputMode.
+void turnOffLflags(tcflag_t* c_lflag);
+
+// turnOffOflags turns off OPOST flag. Used by enableRawInputMode.
+void turnOffOflags(tcflag_t* c_oflag);
+
+// unhideCursor unhides the cursor.
+void unhideCursor();
+
+#endif
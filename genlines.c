@@ -0,0 +1,209 @@
+// Connect Four
+// Author: Scott Helms
+
+// genlines writes win_lines.h, the table of every four in a row on the board.
+// It runs at build time so the table is compiled in as constants and the win
+// checks never have to work out the board boundaries themselves.
+
+#include <stdio.h>
+
+#include "bitboard.h"
+
+/*** Define ***/
+
+// Every cell starts at most one line per vector and is part of at most
+// CONNECT_LENGTH lines per vector.
+#define MAX_LINES (4 * BOARD_CELLS)
+#define MAX_LINES_PER_CELL (4 * CONNECT_LENGTH)
+
+/*** Structures ***/
+
+typedef struct WinLine {
+  ConnectFourLine start;
+  int rows[CONNECT_LENGTH];
+  int cols[CONNECT_LENGTH];
+  bitboard mask;
+} WinLine;
+
+/*** Declorations ***/
+
+// findWinLines fills lines with every four in a row on the board, in the
+// order showConnectFour walks them. Returns the number of lines.
+int findWinLines(WinLine lines[MAX_LINES]);
+
+// printTables prints the header to stdout.
+void printTables(WinLine lines[MAX_LINES], int line_count);
+
+// stepAlongVector moves the row and column one token along the vector, the
+// same way showConnectFour does.
+void stepAlongVector(int vector, int* row, int* col);
+
+/*** Functions ***/
+
+int findWinLines(WinLine lines[MAX_LINES]) {
+  int line_count = 0;
+  int vector, row, col, i;
+  for (vector = HORIZONTAL; vector <= RIGHTDIAG; ++vector) {
+    for (row = 0; row < BOARD_HEIGHT; ++row) {
+      for (col = 0; col < BOARD_WIDTH; ++col) {
+        WinLine line;
+        line.start.row = row;
+        line.start.col = col;
+        line.start.vector = vector;
+        line.mask = 0;
+
+        int line_row = row;
+        int line_col = col;
+        for (i = 0; i < CONNECT_LENGTH; ++i) {
+          if (line_row < 0 || line_row >= BOARD_HEIGHT || line_col < 0 ||
+              line_col >= BOARD_WIDTH) {
+            break;
+          }
+          line.rows[i] = line_row;
+          line.cols[i] = line_col;
+          line.mask |= cellBit(line_row, line_col);
+          stepAlongVector(vector, &line_row, &line_col);
+        }
+
+        if (i == CONNECT_LENGTH) {
+          lines[line_count++] = line;
+        }
+      }
+    }
+  }
+  return line_count;
+}
+
+void printTables(WinLine lines[MAX_LINES], int line_count) {
+  int cell_lines[BOARD_HEIGHT][BOARD_WIDTH][MAX_LINES_PER_CELL];
+  int cell_line_counts[BOARD_HEIGHT][BOARD_WIDTH] = {{0}};
+  int line_starting_at[BOARD_HEIGHT][BOARD_WIDTH][4];
+  int max_cell_lines = 0;
+  int row, col, vector, i, j;
+
+  for (row = 0; row < BOARD_HEIGHT; ++row) {
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      for (vector = HORIZONTAL; vector <= RIGHTDIAG; ++vector) {
+        line_starting_at[row][col][vector] = -1;
+      }
+    }
+  }
+  for (i = 0; i < line_count; ++i) {
+    line_starting_at[lines[i].start.row][lines[i].start.col]
+                    [lines[i].start.vector] = i;
+    for (j = 0; j < CONNECT_LENGTH; ++j) {
+      row = lines[i].rows[j];
+      col = lines[i].cols[j];
+      cell_lines[row][col][cell_line_counts[row][col]++] = i;
+      if (cell_line_counts[row][col] > max_cell_lines) {
+        max_cell_lines = cell_line_counts[row][col];
+      }
+    }
+  }
+
+  printf("// Generated by genlines from bitboard.h. Do not edit.\n\n");
+  printf("#ifndef WIN_LINES_H\n#define WIN_LINES_H\n\n");
+  printf("#include <stdint.h>\n\n#include \"bitboard.h\"\n\n");
+  printf("#define MAX_CELL_LINES %d\n", max_cell_lines);
+  printf("#define WIN_LINE_COUNT %d\n\n", line_count);
+
+  printf("// WIN_LINE_MASKS holds the bitboard mask of every line.\n");
+  printf("static const bitboard WIN_LINE_MASKS[WIN_LINE_COUNT] = {\n");
+  for (i = 0; i < line_count; ++i) {
+    printf("    0x%016llxULL,\n", (unsigned long long)lines[i].mask);
+  }
+  printf("};\n\n");
+
+  printf("// WIN_LINES holds the first token and vector of every line the way\n"
+         "// showConnectFour walks it.\n");
+  printf("static const ConnectFourLine WIN_LINES[WIN_LINE_COUNT] = {\n");
+  for (i = 0; i < line_count; ++i) {
+    printf("    {%d, %d, %d},\n", lines[i].start.row, lines[i].start.col,
+           lines[i].start.vector);
+  }
+  printf("};\n\n");
+
+  printf("// WIN_LINE_CELLS holds the array index (row * BOARD_WIDTH + col) "
+         "of the\n// tokens of every line.\n");
+  printf("static const uint8_t WIN_LINE_CELLS[WIN_LINE_COUNT][CONNECT_LENGTH] "
+         "= {\n");
+  for (i = 0; i < line_count; ++i) {
+    printf("    {");
+    for (j = 0; j < CONNECT_LENGTH; ++j) {
+      printf(j == 0 ? "%d" : ", %d",
+             lines[i].rows[j] * BOARD_WIDTH + lines[i].cols[j]);
+    }
+    printf("},\n");
+  }
+  printf("};\n\n");
+
+  printf("// CELL_LINE_COUNTS and CELL_LINES list the lines through every "
+         "cell.\n");
+  printf("static const uint8_t CELL_LINE_COUNTS[BOARD_HEIGHT][BOARD_WIDTH] = "
+         "{\n");
+  for (row = 0; row < BOARD_HEIGHT; ++row) {
+    printf("    {");
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      printf(col == 0 ? "%d" : ", %d", cell_line_counts[row][col]);
+    }
+    printf("},\n");
+  }
+  printf("};\n\n");
+  printf("static const uint8_t "
+         "CELL_LINES[BOARD_HEIGHT][BOARD_WIDTH][MAX_CELL_LINES] = {\n");
+  for (row = 0; row < BOARD_HEIGHT; ++row) {
+    printf("    {\n");
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      printf("        {");
+      for (j = 0; j < cell_line_counts[row][col]; ++j) {
+        printf(j == 0 ? "%d" : ", %d", cell_lines[row][col][j]);
+      }
+      printf("},\n");
+    }
+    printf("    },\n");
+  }
+  printf("};\n\n");
+
+  printf("// LINE_STARTING_AT holds the line that starts at the cell and runs "
+         "along\n// the vector, -1 if the line would leave the board.\n");
+  printf("static const int16_t LINE_STARTING_AT[BOARD_HEIGHT][BOARD_WIDTH][4] "
+         "= {\n");
+  for (row = 0; row < BOARD_HEIGHT; ++row) {
+    printf("    {\n");
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      printf("        {%d, %d, %d, %d},\n", line_starting_at[row][col][0],
+             line_starting_at[row][col][1], line_starting_at[row][col][2],
+             line_starting_at[row][col][3]);
+    }
+    printf("    },\n");
+  }
+  printf("};\n\n#endif\n");
+}
+
+void stepAlongVector(int vector, int* row, int* col) {
+  switch (vector) {
+  case HORIZONTAL:
+    --*col;
+    break;
+  case LEFTDIAG:
+    --*row;
+    --*col;
+    break;
+  case VERTICAL:
+    --*row;
+    break;
+  case RIGHTDIAG:
+    --*row;
+    ++*col;
+    break;
+  }
+}
+
+/*** Main ***/
+
+int main() {
+  static WinLine lines[MAX_LINES];
+  int line_count = findWinLines(lines);
+  printTables(lines, line_count);
+  return 0;
+}
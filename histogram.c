@@ -0,0 +1,155 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "histogram.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*** Define ***/
+
+#define HALF_SUB_BUCKETS (HISTOGRAM_SUB_BUCKETS / 2)
+// HdrHistogram's default number of percentile lines every time the distance
+// to 100% halves.
+#define TICKS_PER_HALF_DISTANCE 5
+
+/*** Declorations ***/
+
+// findSlot returns the index of the slot counting the value.
+static int findSlot(uint64_t value);
+
+// findSlotHighestValue returns the largest value counted by the slot.
+static uint64_t findSlotHighestValue(int slot);
+
+/*** Functions ***/
+
+void clearHistogram(Histogram* histogram) {
+  memset(histogram, 0, sizeof(*histogram));
+  histogram->min = UINT64_MAX;
+}
+
+uint64_t findHistogramPercentile(const Histogram* histogram,
+                                 double percentile) {
+  if (histogram->total == 0) {
+    return 0;
+  }
+  double wanted = percentile / 100 * histogram->total;
+  uint64_t target = wanted;
+  if (target < wanted) {
+    target++;
+  }
+  if (target < 1) {
+    target = 1;
+  }
+
+  uint64_t cumulative = 0;
+  int slot;
+  for (slot = 0; slot < HISTOGRAM_SLOTS; ++slot) {
+    cumulative += histogram->counts[slot];
+    if (cumulative >= target) {
+      break;
+    }
+  }
+  uint64_t value = findSlotHighestValue(slot);
+  return value < histogram->max ? value : histogram->max;
+}
+
+static int findSlot(uint64_t value) {
+  if (value >= (uint64_t)1 << HISTOGRAM_MAX_BITS) {
+    value = ((uint64_t)1 << HISTOGRAM_MAX_BITS) - 1;
+  }
+  if (value < HISTOGRAM_SUB_BUCKETS) {
+    return value;
+  }
+  // The shift keeps the HISTOGRAM_SUB_BUCKET_BITS top bits of the value, the
+  // highest of which is always set.
+  int shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+  return (shift + 1) * HALF_SUB_BUCKETS + (value >> shift) - HALF_SUB_BUCKETS;
+}
+
+static uint64_t findSlotHighestValue(int slot) {
+  if (slot < HISTOGRAM_SUB_BUCKETS) {
+    return slot;
+  }
+  int shift = slot / HALF_SUB_BUCKETS - 1;
+  uint64_t sub_bucket = slot % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void mergeHistogram(Histogram* histogram, const Histogram* source) {
+  int slot;
+  for (slot = 0; slot < HISTOGRAM_SLOTS; ++slot) {
+    histogram->counts[slot] += source->counts[slot];
+  }
+  histogram->total += source->total;
+  histogram->sum += source->sum;
+  histogram->sum_squares += source->sum_squares;
+  if (source->min < histogram->min) {
+    histogram->min = source->min;
+  }
+  if (source->max > histogram->max) {
+    histogram->max = source->max;
+  }
+}
+
+void printHistogram(const Histogram* histogram, double value_scale) {
+  printf("%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount",
+         "1/(1-Percentile)");
+
+  // Like HdrHistogram, the percentiles get closer together every time the
+  // distance to 100% halves, and the last line is the maximum.
+  double percentile = 0;
+  uint64_t cumulative = 0;
+  int slot = 0;
+  while (histogram->total > 0) {
+    double wanted = percentile / 100 * histogram->total;
+    while (cumulative < wanted || cumulative == 0) {
+      cumulative += histogram->counts[slot++];
+    }
+    if (cumulative == histogram->total) {
+      break;
+    }
+    uint64_t value = findSlotHighestValue(slot - 1);
+    if (value > histogram->max) {
+      value = histogram->max;
+    }
+    printf("%12.3f %2.12f %10llu %14.2f\n", value / value_scale,
+           percentile / 100, (unsigned long long)cumulative,
+           1 / (1 - percentile / 100));
+
+    double half_distance = 2;
+    while (100 / (100 - percentile) >= half_distance) {
+      half_distance *= 2;
+    }
+    percentile += 100 / (half_distance * TICKS_PER_HALF_DISTANCE);
+  }
+  if (histogram->total > 0) {
+    printf("%12.3f %2.12f %10llu\n", histogram->max / value_scale, 1.0,
+           (unsigned long long)histogram->total);
+  }
+
+  double count = histogram->total > 0 ? histogram->total : 1;
+  double mean = histogram->sum / count;
+  double variance = histogram->sum_squares / count - mean * mean;
+  printf("#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean / value_scale,
+         variance > 0 ? sqrt(variance) / value_scale : 0);
+  printf("#[Max     = %12.3f, Total count    = %12llu]\n",
+         histogram->max / value_scale, (unsigned long long)histogram->total);
+  printf("#[Buckets = %12d, SubBuckets     = %12d]\n",
+         HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1,
+         HISTOGRAM_SUB_BUCKETS);
+}
+
+void recordHistogram(Histogram* histogram, uint64_t value) {
+  histogram->counts[findSlot(value)]++;
+  histogram->total++;
+  histogram->sum += value;
+  histogram->sum_squares += (double)value * value;
+  if (value < histogram->min) {
+    histogram->min = value;
+  }
+  if (value > histogram->max) {
+    histogram->max = value;
+  }
+}
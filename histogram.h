@@ -0,0 +1,57 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+/*** Define ***/
+
+// A value is kept to its HISTOGRAM_SUB_BUCKET_BITS most significant bits, so
+// every recorded value is within 0.1% of the value it is reported as.
+#define HISTOGRAM_SUB_BUCKET_BITS 11
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+// Values of HISTOGRAM_MAX_BITS bits and more are counted as the largest value
+// that fits.
+#define HISTOGRAM_MAX_BITS 36
+#define HISTOGRAM_SLOTS                                  \
+  ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2) * \
+   (HISTOGRAM_SUB_BUCKETS / 2))
+
+/*** Structures ***/
+
+// Histogram counts values in buckets of the same relative width, the layout
+// of an HdrHistogram. Values below HISTOGRAM_SUB_BUCKETS have a slot each,
+// every power of two above that is split into HISTOGRAM_SUB_BUCKETS / 2 slots.
+typedef struct Histogram {
+  uint64_t counts[HISTOGRAM_SLOTS];
+  uint64_t total;
+  uint64_t min;
+  uint64_t max;
+  double sum;
+  double sum_squares;
+} Histogram;
+
+/*** Declorations ***/
+
+// clearHistogram removes every value from the histogram.
+void clearHistogram(Histogram* histogram);
+
+// findHistogramPercentile returns the largest value of the slot that holds the
+// given percentile (0 to 100) of the recorded values, 0 if there are none.
+uint64_t findHistogramPercentile(const Histogram* histogram,
+                                 double percentile);
+
+// mergeHistogram adds the values of source to histogram.
+void mergeHistogram(Histogram* histogram, const Histogram* source);
+
+// printHistogram prints the percentile distribution the way HdrHistogram does,
+// with every value divided by value_scale, followed by the mean, standard
+// deviation, maximum and count.
+void printHistogram(const Histogram* histogram, double value_scale);
+
+// recordHistogram adds the value to the histogram.
+void recordHistogram(Histogram* histogram, uint64_t value);
+
+#endif
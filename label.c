@@ -0,0 +1,439 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "label.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "search.h"
+#include "solver.h"
+#include "transposition.h"
+#include "winbatch.h"
+
+/*** Define ***/
+
+#define LABEL_BATCH_POSITIONS 32
+// Every thread has this many batches to work ahead on before the reader
+// waits for the writer.
+#define LABEL_BATCHES_PER_THREAD 4
+// A line too long to fit holds more moves than there are cells, it is
+// labeled invalid and reported.
+#define LABEL_LINE_SIZE 64
+// LABEL_LINE_TOO_LONG is returned by readLabelLine for a line that does not
+// fit.
+#define LABEL_LINE_TOO_LONG 1
+
+/*** Enum ***/
+
+enum label_value {
+  LABEL_WIN,
+  LABEL_DRAW,
+  LABEL_LOSS,
+  LABEL_UNKNOWN,
+  LABEL_OVER,
+  LABEL_INVALID
+};
+
+// batch_state is where a batch of the ring is in the pipeline.
+enum batch_state { BATCH_FREE, BATCH_READ, BATCH_LABELED };
+
+/*** Structures ***/
+
+typedef struct LabelEntry {
+  char moves[LABEL_LINE_SIZE];
+  // unreadable is set for a blank or too long line. It is labeled invalid
+  // without playing its moves, so every input line keeps its output line.
+  boolean unreadable;
+  int value;
+  int score;
+  int best_move;
+} LabelEntry;
+
+typedef struct LabelBatch {
+  LabelEntry entries[LABEL_BATCH_POSITIONS];
+  int count;
+  int state;
+} LabelBatch;
+
+// LabelPipeline is the ring of batches shared by the stages. The batch with
+// sequence number n sits in slot n % batch_count, so the reader fills, the
+// threads label and the writer writes the slots in turn, and the writer
+// freeing a slot is what lets the reader go on.
+typedef struct LabelPipeline {
+  const LabelOptions* options;
+  LabelBatch* batches;
+  int batch_count;
+  pthread_mutex_t lock;
+  pthread_cond_t batch_free;
+  pthread_cond_t batch_read;
+  pthread_cond_t batch_labeled;
+  // read_count, next_label and next_write are the sequence numbers of the
+  // next batch of every stage.
+  uint64_t read_count;
+  uint64_t next_label;
+  uint64_t next_write;
+  boolean input_done;
+  int64_t write_wait_ns;
+} LabelPipeline;
+
+typedef struct LabelWorker {
+  pthread_t thread;
+  LabelPipeline* pipeline;
+  TranspositionTable table;
+  LabelStats stats;
+} LabelWorker;
+
+/*** Globals ***/
+
+// label_values is indexed by label_value.
+static const char* label_values[] = {"win",     "draw", "loss",
+                                     "unknown", "over", "invalid"};
+
+/*** Declorations ***/
+
+// labelBatch labels every entry of the batch.
+static void labelBatch(LabelWorker* worker, LabelBatch* batch);
+
+// labelEntry finds the value and the best move of the entry's position, which
+// is NULL if its moves cannot be played. wins holds the tokens with a connect
+// four on the board.
+static void labelEntry(LabelWorker* worker, LabelEntry* entry,
+                       const Position* position, int wins);
+
+// labelThread labels batches in input order until the input is done.
+static void* labelThread(void* label_worker);
+
+// labelWriterThread writes the labeled batches in input order and frees
+// them for the reader.
+static void* labelWriterThread(void* label_pipeline);
+
+// readLabelLine reads the next line into the entry's moves and marks a blank
+// or too long line unreadable. Returns -1 at the end of the input,
+// LABEL_LINE_TOO_LONG if the line did not fit, 0 otherwise.
+static int readLabelLine(FILE* input, LabelEntry* entry);
+
+// writeLabelEntry writes the label line of the entry.
+static void writeLabelEntry(const LabelEntry* entry);
+
+/*** Functions ***/
+
+static void labelBatch(LabelWorker* worker, LabelBatch* batch) {
+  // Every position is played out first, so the finished games of the whole
+  // batch are found with one batch win check.
+  Position positions[LABEL_BATCH_POSITIONS];
+  bitboard masks[2][LABEL_BATCH_POSITIONS];
+  boolean valid[LABEL_BATCH_POSITIONS];
+  uint8_t wins[LABEL_BATCH_POSITIONS];
+  int i;
+  for (i = 0; i < batch->count; ++i) {
+    positions[i] = createPosition();
+    valid[i] =
+        !batch->entries[i].unreadable &&
+        createPositionFromMoves(batch->entries[i].moves, &positions[i]) == 0;
+    masks[RED][i] = positions[i].player_masks[RED];
+    masks[YELLOW][i] = positions[i].player_masks[YELLOW];
+  }
+  WinBatch Batch;
+  Batch.player_masks[RED] = masks[RED];
+  Batch.player_masks[YELLOW] = masks[YELLOW];
+  Batch.count = batch->count;
+  findBatchWins(&Batch, wins);
+
+  for (i = 0; i < batch->count; ++i) {
+    labelEntry(worker, &batch->entries[i], valid[i] ? &positions[i] : NULL,
+               wins[i]);
+  }
+}
+
+static void labelEntry(LabelWorker* worker, LabelEntry* entry,
+                       const Position* position, int wins) {
+  const LabelOptions* options = worker->pipeline->options;
+  entry->score = 0;
+  entry->best_move = -1;
+  worker->stats.positions++;
+
+  if (position == NULL) {
+    entry->value = LABEL_INVALID;
+    worker->stats.invalid++;
+    return;
+  }
+  if (wins != 0 || isBoardFull(position)) {
+    entry->value = LABEL_OVER;
+    return;
+  }
+
+  boolean exhaustive = TRUE;
+  if (options->depth >= BOARD_CELLS) {
+    SolveResult Result;
+    solvePosition(position, &worker->table, &Result);
+    entry->score = Result.score;
+    entry->best_move = Result.best_move;
+    worker->stats.nodes += Result.nodes;
+  } else {
+    SearchResult Result =
+        searchBestMove(position, createSearchLimits(options->depth, 0),
+                       &worker->table, options->tablebase);
+    entry->score = Result.score;
+    entry->best_move = Result.best_move;
+    worker->stats.nodes += Result.nodes;
+    exhaustive = options->depth >= BOARD_CELLS - position->move_counter;
+  }
+
+  // A score of 0 from a search that stopped short of the end of the game
+  // only means neither side found a win.
+  if (entry->score > 0) {
+    entry->value = LABEL_WIN;
+  } else if (entry->score < 0) {
+    entry->value = LABEL_LOSS;
+  } else {
+    entry->value = exhaustive ? LABEL_DRAW : LABEL_UNKNOWN;
+  }
+}
+
+static void* labelThread(void* label_worker) {
+  LabelWorker* worker = label_worker;
+  LabelPipeline* pipeline = worker->pipeline;
+  while (TRUE) {
+    pthread_mutex_lock(&pipeline->lock);
+    int64_t wait_ns = currentTimeNs();
+    while (pipeline->next_label == pipeline->read_count &&
+           !pipeline->input_done) {
+      pthread_cond_wait(&pipeline->batch_read, &pipeline->lock);
+    }
+    worker->stats.label_wait_ns += currentTimeNs() - wait_ns;
+    if (pipeline->next_label == pipeline->read_count) {
+      pthread_mutex_unlock(&pipeline->lock);
+      break;
+    }
+    LabelBatch* batch =
+        &pipeline->batches[pipeline->next_label++ % pipeline->batch_count];
+    pthread_mutex_unlock(&pipeline->lock);
+
+    int64_t busy_ns = currentTimeNs();
+    labelBatch(worker, batch);
+    worker->stats.label_busy_ns += currentTimeNs() - busy_ns;
+
+    pthread_mutex_lock(&pipeline->lock);
+    batch->state = BATCH_LABELED;
+    pthread_cond_signal(&pipeline->batch_labeled);
+    pthread_mutex_unlock(&pipeline->lock);
+  }
+  return NULL;
+}
+
+static void* labelWriterThread(void* label_pipeline) {
+  LabelPipeline* pipeline = label_pipeline;
+  while (TRUE) {
+    pthread_mutex_lock(&pipeline->lock);
+    LabelBatch* batch =
+        &pipeline->batches[pipeline->next_write % pipeline->batch_count];
+    int64_t wait_ns = currentTimeNs();
+    while (batch->state != BATCH_LABELED &&
+           !(pipeline->input_done &&
+             pipeline->next_write == pipeline->read_count)) {
+      pthread_cond_wait(&pipeline->batch_labeled, &pipeline->lock);
+    }
+    pipeline->write_wait_ns += currentTimeNs() - wait_ns;
+    if (batch->state != BATCH_LABELED) {
+      pthread_mutex_unlock(&pipeline->lock);
+      break;
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+
+    int i;
+    for (i = 0; i < batch->count; ++i) {
+      writeLabelEntry(&batch->entries[i]);
+    }
+
+    pthread_mutex_lock(&pipeline->lock);
+    batch->state = BATCH_FREE;
+    pipeline->next_write++;
+    pthread_cond_signal(&pipeline->batch_free);
+    pthread_mutex_unlock(&pipeline->lock);
+  }
+  fflush(stdout);
+  return NULL;
+}
+
+void printLabelStats(const LabelOptions* options, const LabelStats* stats) {
+  double seconds = stats->elapsed_ns / 1e9;
+  double label_seconds = stats->label_busy_ns / 1e9;
+  fprintf(stderr,
+          "positions %llu invalid %llu batches %llu threads %d time_s %.3f "
+          "positions_per_s %.1f nodes %llu\n",
+          (unsigned long long)stats->positions,
+          (unsigned long long)stats->invalid,
+          (unsigned long long)stats->batches, options->threads, seconds,
+          seconds > 0 ? stats->positions / seconds : 0,
+          (unsigned long long)stats->nodes);
+  fprintf(stderr, "read wait_s %.3f\n", stats->read_wait_ns / 1e9);
+  fprintf(stderr,
+          "label busy_s %.3f wait_s %.3f positions_per_busy_s %.1f "
+          "utilization %.1f%%\n",
+          label_seconds, stats->label_wait_ns / 1e9,
+          label_seconds > 0 ? stats->positions / label_seconds : 0,
+          seconds > 0 ? 100 * label_seconds / (seconds * options->threads)
+                      : 0);
+  fprintf(stderr, "write wait_s %.3f\n", stats->write_wait_ns / 1e9);
+}
+
+static int readLabelLine(FILE* input, LabelEntry* entry) {
+  if (fgets(entry->moves, LABEL_LINE_SIZE, input) == NULL) {
+    return -1;
+  }
+  int result = 0;
+  size_t length = strlen(entry->moves);
+  // A full buffer without the newline is too long unless the newline or the
+  // end of the input comes right after it. The rest of the line is skipped.
+  if (length == LABEL_LINE_SIZE - 1 && entry->moves[length - 1] != '\n') {
+    int c = getc(input);
+    if (c != EOF && c != '\n') {
+      result = LABEL_LINE_TOO_LONG;
+      while ((c = getc(input)) != EOF && c != '\n') {
+      }
+    }
+  }
+  length = strcspn(entry->moves, "\r\n");
+  entry->moves[length] = '\0';
+  entry->unreadable = length == 0 || result == LABEL_LINE_TOO_LONG;
+  return result;
+}
+
+int runLabelPipeline(const LabelOptions* options, LabelStats* out_stats) {
+  memset(out_stats, 0, sizeof(*out_stats));
+  FILE* input = strcmp(options->input_path, "-") == 0
+                    ? stdin
+                    : fopen(options->input_path, "r");
+  if (input == NULL) {
+    return -1;
+  }
+
+  LabelPipeline Pipeline;
+  memset(&Pipeline, 0, sizeof(Pipeline));
+  Pipeline.options = options;
+  Pipeline.batch_count = options->threads * LABEL_BATCHES_PER_THREAD;
+  Pipeline.batches = calloc(Pipeline.batch_count, sizeof(LabelBatch));
+  pthread_mutex_init(&Pipeline.lock, NULL);
+  pthread_cond_init(&Pipeline.batch_free, NULL);
+  pthread_cond_init(&Pipeline.batch_read, NULL);
+  pthread_cond_init(&Pipeline.batch_labeled, NULL);
+  LabelWorker* workers = calloc(options->threads, sizeof(LabelWorker));
+  pthread_t writer;
+  if (Pipeline.batches == NULL || workers == NULL ||
+      pthread_create(&writer, NULL, labelWriterThread, &Pipeline) != 0) {
+    free(Pipeline.batches);
+    free(workers);
+    if (input != stdin) {
+      fclose(input);
+    }
+    return -1;
+  }
+
+  int table_megabytes = options->hash_megabytes / options->threads;
+  if (table_megabytes < 1) {
+    table_megabytes = 1;
+  }
+  int64_t start_ns = currentTimeNs();
+  int started = 0;
+  int i;
+  for (i = 0; i < options->threads; ++i) {
+    LabelWorker* worker = &workers[started];
+    worker->pipeline = &Pipeline;
+    if (createTranspositionTable(&worker->table, table_megabytes) == -1) {
+      break;
+    }
+    if (pthread_create(&worker->thread, NULL, labelThread, worker) != 0) {
+      destroyTranspositionTable(&worker->table);
+      break;
+    }
+    started++;
+  }
+
+  // The reader fills the slots in turn and waits for a slot the writer has
+  // not freed yet, which holds the whole pipeline to the pace of its slowest
+  // stage. Without a labeling thread nothing is read.
+  boolean input_done = started == 0;
+  uint64_t line_number = 0;
+  while (!input_done) {
+    LabelBatch* batch =
+        &Pipeline.batches[Pipeline.read_count % Pipeline.batch_count];
+    pthread_mutex_lock(&Pipeline.lock);
+    int64_t wait_ns = currentTimeNs();
+    while (batch->state != BATCH_FREE) {
+      pthread_cond_wait(&Pipeline.batch_free, &Pipeline.lock);
+    }
+    out_stats->read_wait_ns += currentTimeNs() - wait_ns;
+    pthread_mutex_unlock(&Pipeline.lock);
+
+    batch->count = 0;
+    while (batch->count < LABEL_BATCH_POSITIONS) {
+      int result = readLabelLine(input, &batch->entries[batch->count]);
+      if (result == -1) {
+        break;
+      }
+      line_number++;
+      if (result == LABEL_LINE_TOO_LONG) {
+        fprintf(stderr,
+                "runLabelPipeline: line %llu is longer than %d characters\n",
+                (unsigned long long)line_number, LABEL_LINE_SIZE - 1);
+      }
+      batch->count++;
+    }
+    input_done = batch->count < LABEL_BATCH_POSITIONS;
+
+    pthread_mutex_lock(&Pipeline.lock);
+    if (batch->count > 0) {
+      batch->state = BATCH_READ;
+      Pipeline.read_count++;
+      pthread_cond_signal(&Pipeline.batch_read);
+    }
+    pthread_mutex_unlock(&Pipeline.lock);
+  }
+  pthread_mutex_lock(&Pipeline.lock);
+  Pipeline.input_done = TRUE;
+  pthread_cond_broadcast(&Pipeline.batch_read);
+  pthread_cond_signal(&Pipeline.batch_labeled);
+  pthread_mutex_unlock(&Pipeline.lock);
+
+  for (i = 0; i < started; ++i) {
+    pthread_join(workers[i].thread, NULL);
+    destroyTranspositionTable(&workers[i].table);
+    out_stats->positions += workers[i].stats.positions;
+    out_stats->invalid += workers[i].stats.invalid;
+    out_stats->nodes += workers[i].stats.nodes;
+    out_stats->label_busy_ns += workers[i].stats.label_busy_ns;
+    out_stats->label_wait_ns += workers[i].stats.label_wait_ns;
+  }
+  pthread_join(writer, NULL);
+  out_stats->batches = Pipeline.read_count;
+  out_stats->write_wait_ns = Pipeline.write_wait_ns;
+  out_stats->elapsed_ns = currentTimeNs() - start_ns;
+
+  pthread_mutex_destroy(&Pipeline.lock);
+  pthread_cond_destroy(&Pipeline.batch_free);
+  pthread_cond_destroy(&Pipeline.batch_read);
+  pthread_cond_destroy(&Pipeline.batch_labeled);
+  free(Pipeline.batches);
+  free(workers);
+  if (input != stdin) {
+    fclose(input);
+  }
+  return started > 0 ? 0 : -1;
+}
+
+static void writeLabelEntry(const LabelEntry* entry) {
+  // An unreadable line is written as - so the line still has every field.
+  if (entry->unreadable) {
+    printf("- %s - -\n", label_values[entry->value]);
+    return;
+  }
+  if (entry->value == LABEL_OVER || entry->value == LABEL_INVALID) {
+    printf("%s %s - -\n", entry->moves, label_values[entry->value]);
+    return;
+  }
+  printf("%s %s %d %d\n", entry->moves, label_values[entry->value],
+         entry->score, entry->best_move + 1);
+}
@@ -0,0 +1,64 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef LABEL_H
+#define LABEL_H
+
+#include <stdint.h>
+
+#include "tablebase.h"
+
+/*** Structures ***/
+
+typedef struct LabelOptions {
+  // input_path is the file of positions to label, "-" for stdin, NULL when no
+  // labeling is requested.
+  const char* input_path;
+  int threads;
+  // depth below BOARD_CELLS labels with a search of that depth instead of
+  // solving the positions.
+  int depth;
+  // hash_megabytes is split between the threads' transposition tables.
+  int hash_megabytes;
+  // tablebase is used by the depth limited search, NULL for none.
+  const Tablebase* tablebase;
+} LabelOptions;
+
+// LabelStats counts the work of every stage of the pipeline. A stage waits
+// when the stage after it falls behind (backpressure) or the one before it
+// has nothing for it yet.
+typedef struct LabelStats {
+  uint64_t positions;
+  uint64_t invalid;
+  uint64_t nodes;
+  uint64_t batches;
+  // read_wait_ns is the time the reader waited for a free batch.
+  int64_t read_wait_ns;
+  // label_busy_ns and label_wait_ns are summed over the labeling threads.
+  int64_t label_busy_ns;
+  int64_t label_wait_ns;
+  // write_wait_ns is the time the writer waited for the next batch in input
+  // order.
+  int64_t write_wait_ns;
+  int64_t elapsed_ns;
+} LabelStats;
+
+/*** Declorations ***/
+
+// printLabelStats prints the throughput and the busy and waiting time of every
+// stage to stderr, stdout holds the labels.
+void printLabelStats(const LabelOptions* options, const LabelStats* stats);
+
+// runLabelPipeline reads one position per line as a move string (columns from
+// 1) and writes "MOVES VALUE SCORE MOVE" per position to stdout in input order.
+// VALUE is win, draw or loss for the player to move, unknown when a depth
+// limited search cannot tell, over when the game has ended and invalid when
+// the moves cannot be played. A blank line or one too long to be a position
+// is written as "- invalid - -", and a too long one is reported on stderr, so
+// output line n always labels input line n. Lines are read into a fixed ring
+// of batches that the threads label and a writer thread writes out in order,
+// so memory stays the same for any input. Returns -1 if the input cannot be
+// opened or no thread can be started, 0 otherwise.
+int runLabelPipeline(const LabelOptions* options, LabelStats* out_stats);
+
+#endif
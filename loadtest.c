@@ -0,0 +1,492 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "loadtest.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "search.h"
+#include "selfplay.h"
+#include "server.h"
+
+/*** Define ***/
+
+#define LOAD_LINE_SIZE 256
+#define LOAD_EVENTS 256
+
+/*** Enum ***/
+
+// load_game_state is the reply a game of the load test waits for next.
+enum load_game_state { LOAD_CREATING, LOAD_JOINING, LOAD_PLAYING, LOAD_FAILED };
+
+/*** Structures ***/
+
+struct LoadGame;
+
+typedef struct LoadConnection {
+  int fd;
+  int seat;
+  struct LoadGame* game;
+  char input[LOAD_LINE_SIZE];
+  int input_length;
+} LoadConnection;
+
+// LoadGame is a pair of connections that play one game after another. The
+// RED seat creates every game and the YELLOW seat joins it.
+typedef struct LoadGame {
+  LoadConnection seats[2];
+  uint64_t id;
+  int state;
+  Position position;
+  // expected is the state the server should answer the move in flight with.
+  const char* expected;
+  boolean waiting;
+  int64_t due_ns;
+} LoadGame;
+
+typedef struct LoadWorker {
+  pthread_t thread;
+  const LoadTestOptions* options;
+  LoadGame* games;
+  int game_count;
+  int epoll_fd;
+  // timer_fd wakes the worker when the next move is due or the test is over.
+  int timer_fd;
+  // ready holds the games whose next move waits for its turn under the rate,
+  // oldest first.
+  LoadGame** ready;
+  int ready_head;
+  int ready_count;
+  // interval_ns is the time between two moves of the worker, 0 without a
+  // rate.
+  int64_t interval_ns;
+  int64_t next_due_ns;
+  int64_t end_ns;
+  uint64_t random_state;
+  int script_length;
+  LoadTestStats stats;
+} LoadWorker;
+
+/*** Declorations ***/
+
+// armLoadTimer sets the worker's timer to the next due move or the end of
+// the test, whichever comes first.
+static void armLoadTimer(LoadWorker* worker);
+
+// chooseLoadMove returns the column of the next move of the game: the next
+// move of the script while it lasts, a random open column after it.
+static int chooseLoadMove(LoadWorker* worker, const LoadGame* game);
+
+// connectLoadGame opens both connections of the game and adds them to the
+// worker's epoll instance. Returns -1 if a connection cannot be opened, 0
+// otherwise.
+static int connectLoadGame(LoadWorker* worker, LoadGame* game, int port);
+
+// failLoadGame counts an error and stops the game.
+static void failLoadGame(LoadWorker* worker, LoadGame* game);
+
+// handleLoadLine acts on one reply the server sent the connection.
+static void handleLoadLine(LoadWorker* worker, LoadConnection* connection,
+                           const char* line);
+
+// loadTestThread plays the worker's games until the end of the test.
+static void* loadTestThread(void* load_worker);
+
+// queueLoadMove sends the next move of the game, at once without a rate and
+// once its turn comes with one.
+static void queueLoadMove(LoadWorker* worker, LoadGame* game);
+
+// readLoadConnection reads and handles the replies waiting on the
+// connection.
+static void readLoadConnection(LoadWorker* worker, LoadConnection* connection);
+
+// sendLoadLine sends the text on the connection. Returns -1 if it cannot be
+// sent whole, 0 otherwise.
+static int sendLoadLine(LoadConnection* connection, const char* text);
+
+// sendLoadMove sends the next move of the game, which was due at due_ns.
+static void sendLoadMove(LoadWorker* worker, LoadGame* game, int64_t due_ns);
+
+/*** Functions ***/
+
+static void armLoadTimer(LoadWorker* worker) {
+  int64_t wake_ns = worker->end_ns;
+  if (worker->ready_count > 0 && worker->next_due_ns < wake_ns) {
+    wake_ns = worker->next_due_ns;
+  }
+  struct itimerspec Timer;
+  memset(&Timer, 0, sizeof(Timer));
+  Timer.it_value.tv_sec = wake_ns / 1000000000;
+  Timer.it_value.tv_nsec = wake_ns % 1000000000;
+  timerfd_settime(worker->timer_fd, TFD_TIMER_ABSTIME, &Timer, NULL);
+}
+
+static int chooseLoadMove(LoadWorker* worker, const LoadGame* game) {
+  const Position* position = &game->position;
+  if (position->move_counter < worker->script_length) {
+    int col = worker->options->script[position->move_counter] - '1';
+    if (col >= 0 && col < BOARD_WIDTH && canPlay(position, col)) {
+      return col;
+    }
+  }
+
+  unsigned moves = findLegalMoves(position);
+  int skip = nextRandom(&worker->random_state) % __builtin_popcount(moves);
+  while (skip-- > 0) {
+    moves &= moves - 1;
+  }
+  return popLegalMove(&moves);
+}
+
+static int connectLoadGame(LoadWorker* worker, LoadGame* game, int port) {
+  struct sockaddr_in Address;
+  memset(&Address, 0, sizeof(Address));
+  Address.sin_family = AF_INET;
+  Address.sin_port = htons(port);
+  Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  int seat;
+  for (seat = RED; seat <= YELLOW; ++seat) {
+    LoadConnection* connection = &game->seats[seat];
+    connection->seat = seat;
+    connection->game = game;
+    connection->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connection->fd == -1) {
+      return -1;
+    }
+
+    int enabled = 1;
+    struct epoll_event Event;
+    Event.events = EPOLLIN;
+    Event.data.ptr = connection;
+    if (connect(connection->fd, (struct sockaddr*)&Address,
+                sizeof(Address)) == -1 ||
+        setsockopt(connection->fd, IPPROTO_TCP, TCP_NODELAY, &enabled,
+                   sizeof(enabled)) == -1 ||
+        fcntl(connection->fd, F_SETFL, O_NONBLOCK) == -1 ||
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, connection->fd, &Event) ==
+            -1) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void failLoadGame(LoadWorker* worker, LoadGame* game) {
+  worker->stats.errors++;
+  game->state = LOAD_FAILED;
+  game->waiting = FALSE;
+}
+
+static void handleLoadLine(LoadWorker* worker, LoadConnection* connection,
+                           const char* line) {
+  LoadGame* game = connection->game;
+  if (game->state == LOAD_FAILED) {
+    return;
+  }
+
+  unsigned long long id;
+  int col;
+  char state[16];
+  if (strncmp(line, "OK ", 3) == 0) {
+    int64_t now_ns = currentTimeNs();
+    if (!game->waiting ||
+        sscanf(line, "OK %llu %d %15s", &id, &col, state) != 3 ||
+        strcmp(state, game->expected) != 0) {
+      failLoadGame(worker, game);
+      return;
+    }
+    game->waiting = FALSE;
+    worker->stats.moves++;
+    recordHistogram(&worker->stats.latency, now_ns - game->due_ns);
+
+    if (strcmp(state, "PLAY") == 0) {
+      queueLoadMove(worker, game);
+      return;
+    }
+    worker->stats.games++;
+    game->state = LOAD_CREATING;
+    if (sendLoadLine(&game->seats[RED], "NEW\n") == -1) {
+      failLoadGame(worker, game);
+    }
+  } else if (strncmp(line, "GAME ", 5) == 0) {
+    char join[LOAD_LINE_SIZE];
+    if (game->state != LOAD_CREATING || connection->seat != RED ||
+        sscanf(line, "GAME %llu", &id) != 1) {
+      failLoadGame(worker, game);
+      return;
+    }
+    game->id = id;
+    game->state = LOAD_JOINING;
+    snprintf(join, sizeof(join), "JOIN %llu\n", id);
+    if (sendLoadLine(&game->seats[YELLOW], join) == -1) {
+      failLoadGame(worker, game);
+    }
+  } else if (strncmp(line, "JOINED ", 7) == 0) {
+    // The creator is told about the join as well, the joiner's reply is the
+    // one that starts the game.
+    if (connection->seat == YELLOW) {
+      if (game->state != LOAD_JOINING) {
+        failLoadGame(worker, game);
+        return;
+      }
+      game->state = LOAD_PLAYING;
+      game->position = createPosition();
+      queueLoadMove(worker, game);
+    }
+  } else if (strncmp(line, "MOVE ", 5) != 0) {
+    // MOVE tells the other seat about a move it already knows, anything else
+    // (ERR, LEFT) ends the game for the load test.
+    failLoadGame(worker, game);
+  }
+}
+
+static void* loadTestThread(void* load_worker) {
+  LoadWorker* worker = load_worker;
+  struct epoll_event events[LOAD_EVENTS];
+  int i;
+  for (i = 0; i < worker->game_count; ++i) {
+    if (sendLoadLine(&worker->games[i].seats[RED], "NEW\n") == -1) {
+      failLoadGame(worker, &worker->games[i]);
+    }
+  }
+  armLoadTimer(worker);
+
+  while (TRUE) {
+    int count = epoll_wait(worker->epoll_fd, events, LOAD_EVENTS, -1);
+    for (i = 0; i < count; ++i) {
+      if (events[i].data.ptr != worker) {
+        readLoadConnection(worker, events[i].data.ptr);
+      }
+    }
+
+    int64_t now_ns = currentTimeNs();
+    if (now_ns >= worker->end_ns) {
+      break;
+    }
+    boolean sent = FALSE;
+    while (worker->ready_count > 0 && worker->next_due_ns <= now_ns) {
+      LoadGame* game = worker->ready[worker->ready_head];
+      worker->ready_head = (worker->ready_head + 1) % worker->game_count;
+      worker->ready_count--;
+      sendLoadMove(worker, game, worker->next_due_ns);
+      worker->next_due_ns += worker->interval_ns;
+      sent = TRUE;
+    }
+    // The timer is read only to rearm it, a wake up without a due move
+    // leaves it as it is.
+    uint64_t expirations;
+    if (read(worker->timer_fd, &expirations, sizeof(expirations)) > 0 ||
+        sent) {
+      armLoadTimer(worker);
+    }
+  }
+  return NULL;
+}
+
+void printLoadTestStats(const LoadTestOptions* options,
+                        const LoadTestStats* stats) {
+  double seconds = stats->elapsed_ns / 1e9;
+  printf("connections %d threads %d rate %d\n", options->connections,
+         options->threads, options->rate);
+  printf("moves %llu games %llu errors %llu time_s %.3f moves_per_s %.1f\n",
+         (unsigned long long)stats->moves, (unsigned long long)stats->games,
+         (unsigned long long)stats->errors, seconds,
+         seconds > 0 ? stats->moves / seconds : 0);
+  printf("p50_us %.3f p99_us %.3f p999_us %.3f max_us %.3f\n",
+         findHistogramPercentile(&stats->latency, 50) / 1e3,
+         findHistogramPercentile(&stats->latency, 99) / 1e3,
+         findHistogramPercentile(&stats->latency, 99.9) / 1e3,
+         stats->latency.max / 1e3);
+  printHistogram(&stats->latency, 1e3);
+}
+
+static void queueLoadMove(LoadWorker* worker, LoadGame* game) {
+  int64_t now_ns = currentTimeNs();
+  if (worker->interval_ns == 0) {
+    sendLoadMove(worker, game, now_ns);
+    return;
+  }
+
+  // A move that finds no other move waiting is due now at the earliest, the
+  // rate does not save up the turns nobody was ready for.
+  if (worker->ready_count == 0 && worker->next_due_ns < now_ns) {
+    worker->next_due_ns = now_ns;
+  }
+  int tail = (worker->ready_head + worker->ready_count) % worker->game_count;
+  worker->ready[tail] = game;
+  worker->ready_count++;
+  if (worker->ready_count == 1) {
+    armLoadTimer(worker);
+  }
+}
+
+static void readLoadConnection(LoadWorker* worker,
+                               LoadConnection* connection) {
+  ssize_t bytes =
+      recv(connection->fd, connection->input + connection->input_length,
+           LOAD_LINE_SIZE - connection->input_length, 0);
+  if (bytes <= 0) {
+    if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+      if (connection->game->state != LOAD_FAILED) {
+        failLoadGame(worker, connection->game);
+      }
+    }
+    return;
+  }
+  connection->input_length += bytes;
+
+  int start = 0;
+  int i;
+  for (i = 0; i < connection->input_length; ++i) {
+    if (connection->input[i] == '\n') {
+      connection->input[i] = '\0';
+      handleLoadLine(worker, connection, connection->input + start);
+      start = i + 1;
+    }
+  }
+  memmove(connection->input, connection->input + start,
+          connection->input_length - start);
+  connection->input_length -= start;
+  if (connection->input_length == LOAD_LINE_SIZE) {
+    connection->input_length = 0;
+    failLoadGame(worker, connection->game);
+  }
+}
+
+int runLoadTest(const LoadTestOptions* options, LoadTestStats* out_stats) {
+  memset(out_stats, 0, sizeof(*out_stats));
+  clearHistogram(&out_stats->latency);
+  raiseDescriptorLimit();
+
+  int game_count = options->connections / 2;
+  int threads = options->threads < game_count ? options->threads : game_count;
+  LoadWorker* workers = calloc(threads, sizeof(LoadWorker));
+  LoadGame* games = calloc(game_count, sizeof(LoadGame));
+  LoadGame** ready = malloc(game_count * sizeof(LoadGame*));
+  boolean failed = workers == NULL || games == NULL || ready == NULL;
+
+  int i, seat;
+  for (i = 0; i < game_count && !failed; ++i) {
+    games[i].seats[RED].fd = -1;
+    games[i].seats[YELLOW].fd = -1;
+  }
+
+  // Every worker gets a run of consecutive games and a share of the rate.
+  int first_game = 0;
+  for (i = 0; i < threads && !failed; ++i) {
+    LoadWorker* worker = &workers[i];
+    worker->options = options;
+    worker->games = games + first_game;
+    worker->game_count = game_count / threads + (i < game_count % threads);
+    worker->ready = ready + first_game;
+    worker->interval_ns =
+        options->rate > 0 ? 1000000000LL * threads / options->rate : 0;
+    worker->random_state = options->seed + i + 1;
+    worker->script_length =
+        options->script != NULL ? (int)strlen(options->script) : 0;
+    clearHistogram(&worker->stats.latency);
+    first_game += worker->game_count;
+
+    worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    worker->timer_fd =
+        timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct epoll_event Timer;
+    Timer.events = EPOLLIN;
+    Timer.data.ptr = worker;
+    failed = worker->epoll_fd == -1 || worker->timer_fd == -1 ||
+             epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->timer_fd,
+                       &Timer) == -1;
+    int game;
+    for (game = 0; game < worker->game_count && !failed; ++game) {
+      failed = connectLoadGame(worker, &worker->games[game], options->port) ==
+               -1;
+    }
+  }
+
+  int started = 0;
+  int64_t start_ns = currentTimeNs();
+  for (i = 0; i < threads && !failed; ++i) {
+    workers[i].end_ns = start_ns + options->seconds * 1000000000LL;
+    if (pthread_create(&workers[i].thread, NULL, loadTestThread,
+                       &workers[i]) != 0) {
+      failed = TRUE;
+      break;
+    }
+    started++;
+  }
+  for (i = 0; i < started; ++i) {
+    pthread_join(workers[i].thread, NULL);
+    out_stats->moves += workers[i].stats.moves;
+    out_stats->games += workers[i].stats.games;
+    out_stats->errors += workers[i].stats.errors;
+    mergeHistogram(&out_stats->latency, &workers[i].stats.latency);
+  }
+  out_stats->elapsed_ns = currentTimeNs() - start_ns;
+
+  for (i = 0; i < game_count && games != NULL; ++i) {
+    for (seat = RED; seat <= YELLOW; ++seat) {
+      if (games[i].seats[seat].fd != -1) {
+        close(games[i].seats[seat].fd);
+      }
+    }
+  }
+  for (i = 0; i < threads && workers != NULL; ++i) {
+    if (workers[i].epoll_fd > 0) {
+      close(workers[i].epoll_fd);
+    }
+    if (workers[i].timer_fd > 0) {
+      close(workers[i].timer_fd);
+    }
+  }
+  free(workers);
+  free(games);
+  free(ready);
+  return failed ? -1 : 0;
+}
+
+static int sendLoadLine(LoadConnection* connection, const char* text) {
+  size_t length = strlen(text);
+  // A game has at most one command in flight, so the socket buffer never
+  // fills up.
+  if (send(connection->fd, text, length, MSG_NOSIGNAL) != (ssize_t)length) {
+    return -1;
+  }
+  return 0;
+}
+
+static void sendLoadMove(LoadWorker* worker, LoadGame* game, int64_t due_ns) {
+  if (game->state != LOAD_PLAYING) {
+    return;
+  }
+  Position* position = &game->position;
+  int mover = currentPlayer(position);
+  int col = chooseLoadMove(worker, game);
+  boolean won = isWinningMove(position, col);
+  playMove(position, col);
+  game->expected =
+      won ? "WIN" : position->move_counter == BOARD_CELLS ? "DRAW" : "PLAY";
+  game->waiting = TRUE;
+  game->due_ns = due_ns;
+
+  char move[LOAD_LINE_SIZE];
+  snprintf(move, sizeof(move), "MOVE %llu %d\n", (unsigned long long)game->id,
+           col + 1);
+  if (sendLoadLine(&game->seats[mover], move) == -1) {
+    failLoadGame(worker, game);
+  }
+}
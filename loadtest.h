@@ -0,0 +1,56 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef LOADTEST_H
+#define LOADTEST_H
+
+#include <stdint.h>
+
+#include "histogram.h"
+
+/*** Structures ***/
+
+typedef struct LoadTestOptions {
+  // port is the port of the server on 127.0.0.1, 0 when no load test is
+  // requested.
+  int port;
+  // connections is split into pairs, the two seats of one game at a time.
+  int connections;
+  int threads;
+  // rate is the number of moves per second sent over all connections, 0 to
+  // send every move as soon as the one before it is answered.
+  int rate;
+  int seconds;
+  // script is a string of columns from 1 that opens every game, NULL for none.
+  // The moves after it are random.
+  const char* script;
+  uint64_t seed;
+} LoadTestOptions;
+
+typedef struct LoadTestStats {
+  uint64_t moves;
+  uint64_t games;
+  // errors counts ERR replies and replies that disagree with the result the
+  // client worked out for the move.
+  uint64_t errors;
+  int64_t elapsed_ns;
+  // latency holds the round trip of every move in nanoseconds. With a rate it
+  // is measured from the time the move was due, not the time it was sent, so
+  // a server that falls behind is not hidden by the client waiting for it.
+  Histogram latency;
+} LoadTestStats;
+
+/*** Declorations ***/
+
+// printLoadTestStats prints the throughput, the p50, p99 and p999 move round
+// trip and the full latency distribution in microseconds.
+void printLoadTestStats(const LoadTestOptions* options,
+                        const LoadTestStats* stats);
+
+// runLoadTest plays games on the server at 127.0.0.1:options->port with
+// options->connections connections on options->threads threads for
+// options->seconds seconds. Returns -1 if a connection cannot be opened, 0
+// otherwise.
+int runLoadTest(const LoadTestOptions* options, LoadTestStats* out_stats);
+
+#endif
@@ -1,1088 +1,666 @@
 // Connect Four
 // Author: Scott Helms
 
-#include <ctype.h>
-#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
-#include <termios.h>
-#include <unistd.h>
+
+#include "book.h"
+#include "game.h"
+#include "label.h"
+#include "loadtest.h"
+#include "record.h"
+#include "search.h"
+#include "selfplay.h"
+#include "server.h"
+#include "solver.h"
+#include "tablebase.h"
+#include "transposition.h"
 
 /*** Define ***/
 
-#define BLANK_LINE "                                           "
-#define BLINKING_OFF "\x1b[m"
-#define BLINKING_ON "\x1b[1;5;7m"
-#define BLUE_COLOR "\x1b[34m"
-#define BOARDTOP "+---+---+---+---+---+---+---+"
-#define CLEAR "\x1b[2J"
-#define CORNER "H"
-#define CTRL_KEY(k) ((k)&0x1f)
-#define DEFAULT_COLOR "\x1b[39m"
-#define DIRECTION_ARROW "PRESS ARROW KEY TO MOVE THE TOKEN"
-#define DIRECTIONS_ENTER "PRESS ENTER KEY TO DROP THE TOKEN"
-#define DOWN "B"
-#define ENDGAME_DIRECTIONS "GAME OVER, DO YOU WANT TO PLAY AGAIN? (Y/N)"
-#define ESC "\x1b["
-#define HIDE "\x1b[?25l"
-#define LEFT "D"
-#define NO_ERRORS ""
-#define PLAYER1 "X"
-#define PLAYER2 "O"
-#define P1TURN "PLAYER 1's TURN"
-#define P1WIN "PLAYER 1 IS THE WINNER"
-#define P2TURN "PLAYER 2's TURN"
-#define P2WIN "PLAYER 2 IS THE WINNER"
-#define RED_COLOR "\x1b[31m"
-#define RIGHT "C"
-#define TITLE "CONNECT FOUR"
-#define UNHIDE "\x1b[?25h"
-#define UP "A"
-#define YELLOW_COLOR "\x1b[33m"
-
-/*** Enum ***/
-
-enum arrow_enter { ENTER = 13, RIGHT_ARROW = 67, LEFT_ARROW = 68 };
-typedef enum boolean { FALSE, TRUE } boolean;
-enum bounds { LEFT_BOUNDARY = 0, RIGHT_BOUNDARY = 6 };
-enum token { EMPTY = -1, RED, YELLOW };
-enum vectors { HORIZONTAL, LEFTDIAG, VERTICAL, RIGHTDIAG };
+// NUMBER_TEXT turns a number defined for the build into a string literal, so
+// the usage shows the board the program was built for.
+#define NUMBER_TEXT(number) TEXT(number)
+#define TEXT(text) #text
+#define CONNECT_TEXT NUMBER_TEXT(CONNECT_LENGTH)
+#define HEIGHT_TEXT NUMBER_TEXT(BOARD_HEIGHT)
+#define WIDTH_TEXT NUMBER_TEXT(BOARD_WIDTH)
+
+#define USAGE                                                                  \
+  "usage: main [--ai] [--depth N] [--time MS] [--eval] [--hash MB]\n"          \
+  "            [--threads N] [--ponder] [--book FILE] [--tablebase FILE]\n"    \
+  "            [--log FILE]\n"                                                 \
+  "       main --search MOVES [--scaling] [--depth N] [--time MS] [--eval]\n"  \
+  "            [--hash MB] [--threads N] [--tablebase FILE]\n"                 \
+  "       main --solve MOVES [--hash MB]\n"                                    \
+  "       main --make-book FILE [--plies N] [--depth N] [--time MS]\n"         \
+  "            [--hash MB] [--threads N]\n"                                    \
+  "       main --make-tablebase FILE --root MOVES [--min-tokens K]\n"          \
+  "            [--hash MB] [--threads N]\n"                                    \
+  "       main --selfplay N [--red AGENT] [--yellow AGENT]\n"                  \
+  "            [--random-plies K] [--seed S] [--hash MB] [--threads N]\n"      \
+  "            [--log FILE]\n"                                                 \
+  "       main --analyze FILE\n"                                               \
+  "       main --label FILE [--depth N] [--hash MB] [--threads N]\n"           \
+  "            [--tablebase FILE]\n"                                           \
+  "       main --serve PORT [--max-games N] [--threads N]\n"                   \
+  "       main --load PORT [--connections N] [--rate R] [--seconds S]\n"       \
+  "            [--script MOVES] [--seed S] [--threads N]\n"
+
+// USAGE_OPTIONS is printed after USAGE, one string would be longer than C99
+// compilers have to support.
+#define USAGE_OPTIONS                                                          \
+  "  --ai             the computer plays PLAYER 2\n"                           \
+  "  --depth N        maximum search depth of the computer in plies, with\n"   \
+  "                   no time budget unless --time is given as well\n"        \
+  "  --time MS        time budget of the computer per move, 0 for none\n"      \
+  "  --eval           score the positions at the depth limit with the\n"       \
+  "                   static evaluation instead of as draws\n"                 \
+  "  --hash MB        memory cap of the computer's transposition table\n"      \
+  "  --threads N      number of threads the computer searches with\n"          \
+  "  --ponder         the computer searches its reply to the expected move\n"  \
+  "                   during the player's turn\n"                              \
+  "  --book FILE      opening book the computer plays its first moves from\n"  \
+  "  --make-book FILE write an opening book with the best move of every\n"     \
+  "                   position of the first N moves, searched to depth 14\n"   \
+  "                   unless --depth or --time is given\n"                     \
+  "  --plies N        number of moves covered by --make-book, 4 by default\n"  \
+  "  --tablebase FILE endgame tablebase of won, drawn and lost positions\n"    \
+  "                   the computer stops searching at\n"                       \
+  "  --make-tablebase FILE\n"                                                  \
+  "                   solve every position reachable from --root with at\n"    \
+  "                   least K tokens and write them as an endgame tablebase\n" \
+  "  --root MOVES     position a tablebase is built from\n"                    \
+  "  --min-tokens K   fewest tokens of a position kept by --make-tablebase\n"  \
+  "  --search MOVES   search the position after MOVES without\n"               \
+  "                   the game board and print the result\n"                   \
+  "  --scaling        repeat --search with 1, 2, 4 ... N threads and print\n"  \
+  "                   the speedup over one thread\n"                           \
+  "  --solve MOVES    solve the position after MOVES and\n"                    \
+  "                   print its value, best move and principal variation\n"    \
+  "  --selfplay N     play N games between two computer agents without the\n"  \
+  "                   game board and print the statistics\n"                   \
+  "  --red AGENT      PLAYER 1 agent: random, greedy, search:D or eval:D\n"    \
+  "  --yellow AGENT   PLAYER 2 agent: random, greedy, search:D or eval:D\n"    \
+  "  --random-plies K number of random moves that open every game\n"           \
+  "  --seed S         seed of the random moves\n"                              \
+  "  --serve PORT     host games for network players on 127.0.0.1:PORT, one\n" \
+  "                   event loop per --threads, until interrupted\n"           \
+  "  --max-games N    number of games hosted at once, 65536 by default\n"      \
+  "  --load PORT      play games against the server on 127.0.0.1:PORT and\n"   \
+  "                   print the move round trip latency distribution\n"        \
+  "  --connections N  number of connections of --load, two per game, 100 by\n" \
+  "                   default\n"                                               \
+  "  --rate R         moves per second sent by --load, 0 (the default) to\n"   \
+  "                   send every move as soon as the last one is answered\n"   \
+  "  --seconds S      duration of --load, 10 by default\n"                     \
+  "  --script MOVES   moves that open every game of --load,\n"                 \
+  "                   the moves after them are random\n"                       \
+  "  --log FILE       append every game of the board or of --selfplay to\n"    \
+  "                   the game log FILE, one byte per move\n"                  \
+  "  --analyze FILE   replay the game log FILE and print the moves per\n"      \
+  "                   column, the results per opening and the game lengths\n"  \
+  "  --label FILE     label every position of FILE (move strings, one per\n"   \
+  "                   line, - for stdin) with its value and best move on\n"    \
+  "                   --threads threads, solved or searched to --depth N\n"    \
+  "  MOVES            columns 1-" WIDTH_TEXT " of the " WIDTH_TEXT             \
+  "x" HEIGHT_TEXT " board, " CONNECT_TEXT " in a row wins\n"
 
 /*** Structures ***/
 
-typedef struct CursorLocation {
-  int row;
-  int col;
-} CursorLocation;
-
-typedef struct GameData {
-  int array[7][7];
-  int move_counter;
-  CursorLocation connect_four_title_location;
-  CursorLocation game_board_location;
-  CursorLocation first_token_location;
-  CursorLocation players_initial_location;
-  CursorLocation turn_status_bar_location;
-  CursorLocation directions_status_bar_location;
-  CursorLocation winner_status_bar_location;
-  CursorLocation end_game_status_bar_location;
-  CursorLocation blank_line_column_location;
-} GameData;
-
-typedef struct TerminalSettings {
-  int successful_initialization;
-  int screen_rows;
-  int screen_cols;
-  struct termios orig_termios;
-} TerminalSettings;
+// CommandOptions holds every option of the command line. The game on the
+// board only sees game, the headless commands read the rest.
+typedef struct CommandOptions {
+  GameOptions game;
+  int hash_megabytes;
+  char* book_path;
+  // make_book_path is the book to write when the game is run headless with
+  // --make-book, NULL otherwise.
+  char* make_book_path;
+  int book_plies;
+  char* tablebase_path;
+  // make_tablebase_path is the tablebase to write when the game is run
+  // headless with --make-tablebase, NULL otherwise. It holds the positions
+  // after tablebase_root with at least tablebase_min_tokens tokens.
+  char* make_tablebase_path;
+  char* tablebase_root;
+  int tablebase_min_tokens;
+  // search_moves is the position to search when the game is run headless with
+  // --search, NULL otherwise.
+  char* search_moves;
+  boolean search_scaling;
+  // solve_moves is the position to solve when the game is run headless with
+  // --solve, NULL otherwise.
+  char* solve_moves;
+  // self_play.games is 0 unless the game is run headless with --selfplay.
+  SelfPlayOptions self_play;
+  // server.port is 0 unless the game is run headless with --serve.
+  ServerOptions server;
+  // load_test.port is 0 unless the game is run headless with --load.
+  LoadTestOptions load_test;
+  char* log_path;
+  // analyze_path is the game log to analyze when the game is run headless
+  // with --analyze, NULL otherwise.
+  char* analyze_path;
+  // label.input_path is NULL unless the game is run headless with --label.
+  LabelOptions label;
+} CommandOptions;
 
 /*** Declorations ***/
 
-// applyNewTerSettings returns the new terminal settings that
-// initializeTerminalSettings() function establishes. error_message is used
-// incase of failures.
-int applyNewterminal_settings(struct termios new_settings, char* error_message);
-
-// centerText returns the offset of half the text length, which is used to
-// center the text in the terminal.
-int centerText(char* text);
-
-// clearScreen clears the screen.
-void clearScreen();
-
-// clearTerm clears the terminal by clearing the screen, hiding the cursor, and
-// placing the cursor to the top right corner.
-void clearTerm();
-
-// connectFourPresent searches for the presence of a four tokens in a line
-// hoizontally, left diagonally, vertically, and right diagonally. Returns 1 if
-// found, 0 otherwise.
-boolean connectFourPresent(GameData* game_data);
-
-// connectFourHorizontal returns 1 if a connect four is found in the horizontal
-// vector in the array at the row and column index, 0 otherwise.
-boolean connectFourHorizontal(int array[7][7], int row, int col);
-
-// connectFourLeftDiagonal returns 1 if a connect four is found in the left
-// diagonal vector in the array at the row and column index, 0 otherwise.
-boolean connectFourLeftDiagonal(int array[7][7], int row, int col);
-
-// connectFourRightDiagonal returns 1 if a connect four is found in the right
-// diagonal vector in the array at the row and column index, 0 otherwise.
-boolean connectFourRightDiagonal(int array[7][7], int row, int col);
-
-// connectFourVertical returns 1 if a connect four is found in the vertical
-// vector in the array at the row and column index, 0 otherwise.
-boolean connectFourVertical(int array[7][7], int row, int col);
-
-// createGameData initializes the elements of the game_data struct.
-GameData createGameData(TerminalSettings* terminal_settings);
-
-// disableBlinkinText applies the default esc sequence to return the text to
-// default.
-void disableBlinkingText();
-
-// disableRawInputMode returns the terminal to the previous settings.
-// error_message is used in case of failures.
-int disableRawInputMode(TerminalSettings* terminal_settings,
-                        char* error_message);
-
-// displayBlueColorText changes the text color to blue.
-void displayBlueColorText();
-
-// displayCurrentPlayersToken displays the current token that the player
-// interacts with prior to the token getting dropped.
-void displayCurrentPlayersToken(char* current_players_token);
-
-// displayDefaultColorText returns colored text to the default color.
-void displayDefaultColorText();
-
-// displayDirectionsStatusBar displays the status bar that contains the
-// directions for playing the game.
-void displayDirectionsStatusBar(GameData* game_data);
-
-// displayEndGameStatusBar displays the end game status bar upon a connect four
-// being found.
-void displayEndGameStatusBar(GameData* game_data);
-
-// displayGameBoard displays the title and game board.
-void displayGameBoard(GameData* game_data);
-
-// displayBlueColorText changes the text color to red.
-void displayRedColorText();
-
-// Displays strings to terminal by executing write().
-void displayStrings(char* item);
-
-// displayTitle displays the "CONNECT FOUR" title.
-void displayTitle(CursorLocation connect_four_title_location);
-
-// displayTokenAt displays the token in the game board in the array at the
-// column and row.
-void displayTokenAt(int array[7][7], int col, int row);
-
-// displayTokens displays all the tokens that are present in the game data
-// array.
-void displayTokens(GameData* game_data);
-
-// displayTurnStatusBar displays which players turn it is by number and color.
-void displayTurnStatusBar(GameData* game_data);
-
-// displayWinStatusBar displays which player won when a connect four is
-// discovered.
-void displayWinStatusBar(GameData* game_data);
-
-// displayBlueColorText changes the text color to yellow.
-void displayYellowColorText();
-
-// drawGameBoard displays the outline of the game board.
-void drawGameBoard(CursorLocation game_board_location);
-
-// dropToken place the token in the game data array in the current column
-// position and stacks the token on top of the highest unused row index.
-boolean dropToken(GameData* game_data, int current_col_position);
-
-// enableBlinkingText bolds, inverts, and blinks the text. Used for the player
-// status bar and highlights the connect four tokens.
-void enableBlinkingText();
-
-// enableRawInputMode is user to prepare the terminal for the game.
-int enableRawInputMode(struct termios OriginalTerm, char* error_message);
-
-// enableTimeOutForRead enables a timeout for the read function().
-void enableTimeOutForRead(struct termios* new_settings);
-
-// endGame is used after the game is won to allow the player to determine if
-// they want to replay the game or quit.
-boolean endGame(GameData* game_data, char* error_message);
-
-// exitProgram exits the game for both error and non error game states.
-void exitProgram(TerminalSettings* terminal_settings, char* error_message);
-
-// findBlankLineLocation returns the location to place the BLANK_LINE string,
-// based of the center of the terminal. Only finds the col, row is not used.
-CursorLocation findBlankLineLocation(TerminalSettings* terminal_settings);
-
-// findConnectFourLocation returns the location to place the TITLE string, based
-// of the center of the terminal.
-CursorLocation
-findConnectFourTitleLocation(TerminalSettings* terminal_settings);
+// createOpenPosition plays the moves like createPositionFromMoves for the
+// commands that search a position. Returns -1 if the moves are invalid or the
+// game is already over, 0 otherwise.
+int createOpenPosition(const char* moves, Position* out_position);
 
-char* findCurrentPlayersToken(int move_counter);
+// runAnalyzeCommand replays the game log given by --analyze and prints its
+// statistics. Returns the exit status.
+int runAnalyzeCommand(CommandOptions* options);
 
-// findDirectionStatusBarLocation finds the location to place the
-// DIRECTION_ARROW and DIRECTION_ENTER strings, based of the center of the
-// terminal.
-CursorLocation
-findDirectionsStatusBarLocation(TerminalSettings* terminal_settings);
+// parseCommandLine fills options from the program arguments. Returns -1 if an
+// argument is not recognized, 0 otherwise.
+int parseCommandLine(int argc, char* argv[], CommandOptions* options);
 
-// findEndGameStatusBarLocation returns the location to place the P1WIN and
-// P2WIN strings, based of the center of the terminal.
-CursorLocation
-findEndGameStatusBarLocation(TerminalSettings* terminal_settings);
+// runLabelCommand labels the positions given by --label and prints the
+// pipeline statistics. Returns the exit status.
+int runLabelCommand(CommandOptions* options);
 
-// findFirstTokenLocation returns the location to place the token at the [0][0]
-// index of the game data array, based of the center of the terminal.
-CursorLocation findFirstTokenLocation(TerminalSettings* terminal_settings);
+// runLoadTestCommand plays the games requested by --load against a server and
+// prints the throughput and latency. Returns the exit status.
+int runLoadTestCommand(CommandOptions* options);
 
-// findGameBoardLocation returns the location to place the game board, based of
-// the center of the terminal.
-CursorLocation findGameBoardLocation(TerminalSettings* terminal_settings);
+// runMakeBookCommand writes the opening book requested by --make-book and
+// prints its size. Returns the exit status.
+int runMakeBookCommand(CommandOptions* options);
 
-// findPlayersInitialLocation returns the location to place the token being
-// moved and dropped, based of the center of the terminal.
-CursorLocation findPlayersInitialLocation(TerminalSettings* terminal_settings);
+// runMakeTablebaseCommand writes the tablebase requested by --make-tablebase
+// and prints its statistics. Returns the exit status.
+int runMakeTablebaseCommand(CommandOptions* options);
 
-// findTurnStatusBarLocation returns the location to place the P1TURN and P2TURN
-// strings, based of the center of the terminal.
-CursorLocation findTurnStatusBarLocation(TerminalSettings* terminal_settings);
+// runSelfPlayCommand plays the games requested by --selfplay and prints the
+// statistics. Returns the exit status.
+int runSelfPlayCommand(CommandOptions* options);
 
-// findWinnerStatusBarLocation returns the location to place a the
-// ENDGAME_DIRECTIONS string, based of the center of the terminal.
-CursorLocation findWinnerStatusBarLocation(TerminalSettings* terminal_settings);
+// runServeCommand serves games over the network as requested by --serve and
+// prints the statistics once it is stopped. Returns the exit status.
+int runServeCommand(CommandOptions* options);
 
-// gamePlayLoop contains the while loop that takes user input to move the
-// players token and drop the token. error_message is used in case of failures.
-boolean gamePlayLoop(GameData* game_data, char* error_message);
+// runSearchCommand searches the position given by --search once for every
+// thread count and prints the results. Returns the exit status.
+int runSearchCommand(CommandOptions* options);
 
-// getWindowSize gets the terminal size, which is used to center display.
-int getWindowSize(int* out_rows, int* out_cols);
-
-// hideCursor hides the cursor.
-void hideCursor();
-
-// initSettingsData initializes the elements of the termSettingData struct.
-TerminalSettings initializeTerminalSettings(char* error_message);
-
-// moveCursor moves the cursor by an amount in the direction by executing
-// write().
-void moveCursor(int amount, char* direction);
-
-// moveTokenLeft moves the current token in play left.
-void moveTokenLeft(char* current_players_token, int* current_position);
-
-// moveTokenRight moves the current token in play right.
-void moveTokenRight(char* current_players_token, int* current_position);
-
-// placeTokenAtLeftBoundary moves the current token to the left boundary if the
-// token is at the right boundary and the player uses the right arrow key.
-void placeTokenAtLeftBoundary(char* current_players_token,
-                              int* current_position);
-
-// placeTokenAtRightBoundary moves the current token to the right boundary if
-// the token is at the left boundary and the player uses the left arrow key.
-void placeTokenAtRightBoundary(char* current_players_token,
-                               int* current_position);
-
-// playerInputReader returns the char that the player inputs from the keyboard.
-int playerInputReader(char* player_input, char* error_message);
-
-// putCursorAt puts the cursor at the row and col on the terminal.
-void putCursorAt(int row, int col);
-
-// recreateGame resets the gameDataElements to restart the game.
-void recreateGame(TerminalSettings* terminal_settings, GameData* game_data);
-
-// showConnectFour highlights the connect four tokens found by
-// connectFourPresent functions.
-void showConnectFour(GameData* game_data, int row, int col, int vector);
-
-// turnOffCflags turns off CS8 flag. Used by enableRawInputMode.
-void turnOffCflags(tcflag_t* c_cflag);
-
-// turnOffIflags turns off BRKINT, ICRNL, INPCK, ISTRIP, IXON flags. Used by
-// enableRawInputMode.
-void turnOffIflags(tcflag_t* c_iflag);
-
-// turnOffLflags turns off ECHO, ICANNON, IEXTEN, ISIG flags. Used by
-// enableRawInputMode.
-void turnOffLflags(tcflag_t* c_lflag);
-
-// turnOffOflags turns off OPOST flag. Used by enableRawInputMode.
-void turnOffOflags(tcflag_t* c_oflag);
-
-// unhideCursor unhides the cursor.
-void unhideCursor();
+// runSolveCommand solves the position given by --solve and prints its value
+// and principal variation. Returns the exit status.
+int runSolveCommand(CommandOptions* options);
 
 /*** Functions ***/
 
-int applyNewterminal_settings(struct termios new_settings,
-                              char* error_message) {
-  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &new_settings) == -1) {
-    strcat(error_message,
-           "enableRawMode->applyNewterminal_settings->tcsetattr");
-    return -1;
-  }
-  return 0;
-}
-
-int centerText(char* text) { return strlen(text) / (2); }
-
-void clearScreen() { write(STDOUT_FILENO, CLEAR, 4); }
-
-void clearTerm() {
-  hideCursor();
-  clearScreen();
-  moveCursor(0, CORNER);
-}
-
-boolean connectFourPresent(GameData* game_data) {
-  int row, col;
-  // Search pattern starts at the bottom right hand corner and moves left. This
-  // way only four of the eight possible vectors have to be checked.
-  for (row = 6; row >= 0; --row) {
-    for (col = 6; col >= 0; --col) {
-      if (connectFourHorizontal(game_data->array, row, col)) {
-        showConnectFour(game_data, row, col, HORIZONTAL);
-        return TRUE;
-      }
-      if (connectFourLeftDiagonal(game_data->array, row, col)) {
-        showConnectFour(game_data, row, col, LEFTDIAG);
-        return TRUE;
-      }
-      if (connectFourVertical(game_data->array, row, col)) {
-        showConnectFour(game_data, row, col, VERTICAL);
-        return TRUE;
+int parseCommandLine(int argc, char* argv[], CommandOptions* options) {
+  options->game.computer_opponent = FALSE;
+  options->game.computer_limits = createSearchLimits(BOARD_CELLS, 1000);
+  options->game.evaluate = FALSE;
+  options->hash_megabytes = DEFAULT_HASH_MEGABYTES;
+  options->game.ponder = FALSE;
+  options->game.computer_table = NULL;
+  options->game.computer_book = NULL;
+  options->book_path = NULL;
+  options->make_book_path = NULL;
+  options->book_plies = DEFAULT_BOOK_PLIES;
+  options->game.computer_tablebase = NULL;
+  options->tablebase_path = NULL;
+  options->make_tablebase_path = NULL;
+  options->tablebase_root = NULL;
+  options->tablebase_min_tokens = 0;
+  options->search_moves = NULL;
+  options->search_scaling = FALSE;
+  options->solve_moves = NULL;
+  options->self_play.games = 0;
+  parseAgent("search:6", &options->self_play.agents[RED]);
+  parseAgent("greedy", &options->self_play.agents[YELLOW]);
+  options->self_play.random_plies = 2;
+  options->self_play.seed = 1;
+  options->server.port = 0;
+  options->server.max_games = 65536;
+  options->load_test.port = 0;
+  options->load_test.connections = 100;
+  options->load_test.rate = 0;
+  options->load_test.seconds = 10;
+  options->load_test.script = NULL;
+  options->game.game_log = NULL;
+  options->log_path = NULL;
+  options->analyze_path = NULL;
+  options->label.input_path = NULL;
+
+  // A depth without a time budget searches to that depth every move. Given
+  // both, the search stops at whichever limit comes first, in any order.
+  boolean depth_given = FALSE;
+  boolean time_given = FALSE;
+  int i;
+  for (i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--ai") == 0) {
+      options->game.computer_opponent = TRUE;
+    } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+      options->game.computer_limits.depth = atoi(argv[++i]);
+      depth_given = TRUE;
+    } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+      options->game.computer_limits.time_ms = atoi(argv[++i]);
+      time_given = TRUE;
+    } else if (strcmp(argv[i], "--eval") == 0) {
+      options->game.evaluate = TRUE;
+    } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+      options->hash_megabytes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      options->game.computer_limits.threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--ponder") == 0) {
+      options->game.ponder = TRUE;
+    } else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+      options->book_path = argv[++i];
+    } else if (strcmp(argv[i], "--make-book") == 0 && i + 1 < argc) {
+      options->make_book_path = argv[++i];
+    } else if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+      options->book_plies = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--tablebase") == 0 && i + 1 < argc) {
+      options->tablebase_path = argv[++i];
+    } else if (strcmp(argv[i], "--make-tablebase") == 0 && i + 1 < argc) {
+      options->make_tablebase_path = argv[++i];
+    } else if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) {
+      options->tablebase_root = argv[++i];
+    } else if (strcmp(argv[i], "--min-tokens") == 0 && i + 1 < argc) {
+      options->tablebase_min_tokens = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--search") == 0 && i + 1 < argc) {
+      options->search_moves = argv[++i];
+    } else if (strcmp(argv[i], "--solve") == 0 && i + 1 < argc) {
+      options->solve_moves = argv[++i];
+    } else if (strcmp(argv[i], "--scaling") == 0) {
+      options->search_scaling = TRUE;
+    } else if (strcmp(argv[i], "--selfplay") == 0 && i + 1 < argc) {
+      options->self_play.games = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--red") == 0 && i + 1 < argc) {
+      if (parseAgent(argv[++i], &options->self_play.agents[RED]) == -1) {
+        return -1;
       }
-      if (connectFourRightDiagonal(game_data->array, row, col)) {
-        showConnectFour(game_data, row, col, RIGHTDIAG);
-        return TRUE;
+    } else if (strcmp(argv[i], "--yellow") == 0 && i + 1 < argc) {
+      if (parseAgent(argv[++i], &options->self_play.agents[YELLOW]) == -1) {
+        return -1;
       }
+    } else if (strcmp(argv[i], "--random-plies") == 0 && i + 1 < argc) {
+      options->self_play.random_plies = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      options->self_play.seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+      options->server.port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max-games") == 0 && i + 1 < argc) {
+      options->server.max_games = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+      options->load_test.port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+      options->load_test.connections = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      options->load_test.rate = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      options->load_test.seconds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+      options->load_test.script = argv[++i];
+    } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+      options->log_path = argv[++i];
+    } else if (strcmp(argv[i], "--analyze") == 0 && i + 1 < argc) {
+      options->analyze_path = argv[++i];
+    } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+      options->label.input_path = argv[++i];
+    } else {
+      return -1;
     }
   }
-  return FALSE;
-}
-
-boolean connectFourHorizontal(int array[7][7], int row, int col) {
-  // Any index less than 4 cannot have a four or more tokens.
-  if (col < 3) {
-    return FALSE;
-  }
-
-  if (array[row][col] == EMPTY) {
-    return FALSE;
-  }
-  // Returns 0 (not found) if the next three tokens do not match the initial
-  // row/col token.
-  int i;
-  int temp_col = col;
-  for (i = 0; i < 3; ++i) {
-    if (array[row][col] != array[row][--temp_col]) {
-      return FALSE;
-    }
-  }
-  return TRUE;
-}
-
-boolean connectFourLeftDiagonal(int array[7][7], int row, int col) {
-  // Any index less than 4 cannot have a four or more tokens.
-  if (col < 3 || row < 3) {
-    return FALSE;
-  }
 
-  if (array[row][col] == EMPTY) {
-    return FALSE;
+  if (depth_given && !time_given) {
+    options->game.computer_limits.time_ms = 0;
+  }
+  // A book searches every position it covers, so the time budget of a move
+  // would add up to hours. Without limits it searches to a fixed depth.
+  if (options->make_book_path != NULL && !depth_given && !time_given) {
+    options->game.computer_limits.depth = DEFAULT_BOOK_DEPTH;
+    options->game.computer_limits.time_ms = 0;
+  }
+
+  if (options->game.computer_limits.depth < 1 ||
+      options->game.computer_limits.time_ms < 0 ||
+      options->hash_megabytes < 1 ||
+      options->game.computer_limits.threads < 1 ||
+      options->game.computer_limits.threads > MAX_SEARCH_THREADS ||
+      options->self_play.games < 0 || options->self_play.random_plies < 0 ||
+      options->book_plies < 1 || options->book_plies > BOARD_CELLS ||
+      options->tablebase_min_tokens < 0 ||
+      options->tablebase_min_tokens > BOARD_CELLS ||
+      options->server.port < 0 || options->server.port > 65535 ||
+      options->server.max_games < 1 || options->load_test.port < 0 ||
+      options->load_test.port > 65535 || options->load_test.connections < 2 ||
+      options->load_test.connections % 2 != 0 || options->load_test.rate < 0 ||
+      options->load_test.seconds < 1) {
+    return -1;
   }
-  // Returns 0 (not found) if the next three tokens do not match the initial
-  // row/col token.
-  int i;
-  int temp_col = col;
-  int temp_row = row;
-  for (i = 0; i < 3; ++i) {
-    if (array[row][col] != array[--temp_row][--temp_col]) {
-      return FALSE;
-    }
+  // Every position from the empty board on is far too many, so a tablebase is
+  // always built from a root.
+  if (options->make_tablebase_path != NULL &&
+      options->tablebase_root == NULL) {
+    return -1;
   }
-  return TRUE;
+  options->self_play.threads = options->game.computer_limits.threads;
+  options->self_play.hash_megabytes = options->hash_megabytes;
+  options->server.threads = options->game.computer_limits.threads;
+  options->load_test.threads = options->game.computer_limits.threads;
+  options->load_test.seed = options->self_play.seed;
+  options->label.threads = options->game.computer_limits.threads;
+  options->label.depth = options->game.computer_limits.depth;
+  options->label.hash_megabytes = options->hash_megabytes;
+  return 0;
 }
 
-boolean connectFourRightDiagonal(int array[7][7], int row, int col) {
-  // Any index less than 4 cannot have a four or more tokens.
-  if (col > 3 || row < 3) {
-    return FALSE;
-  }
-  if (array[row][col] == EMPTY) {
-    return FALSE;
-  }
-  // Returns 0 (not found) if the next three tokens do not match the initial
-  // row/col token.
-  int i;
-  int temp_col = col;
-  int temp_row = row;
-  for (i = 0; i < 3; ++i) {
-    if (array[row][col] != array[--temp_row][++temp_col]) {
-      return FALSE;
-    }
+int createOpenPosition(const char* moves, Position* out_position) {
+  if (createPositionFromMoves(moves, out_position) == -1 ||
+      isGameOver(out_position)) {
+    return -1;
   }
-  return TRUE;
+  return 0;
 }
 
-boolean connectFourVertical(int array[7][7], int row, int col) {
-  // Any index less than 4 cannot have a four or more tokens.
-  if (row < 3) {
-    return FALSE;
+int runAnalyzeCommand(CommandOptions* options) {
+  GameLogStats stats;
+  if (analyzeGameLog(options->analyze_path, &stats) == -1) {
+    fprintf(stderr, "runAnalyzeCommand: cannot read the game log \"%s\"\n",
+            options->analyze_path);
+    return 1;
   }
-  if (array[row][col] == EMPTY) {
-    return FALSE;
-  }
-  // Returns 0 (not found) if the next three tokens do not match the initial
-  // row/col token.
-  int i;
-  int temp_row = row;
-  for (i = 0; i < 3; ++i) {
-    if (array[row][col] != array[--temp_row][col]) {
-      return FALSE;
-    }
-  }
-  return TRUE;
+  printGameLogStats(&stats);
+  return 0;
 }
 
-GameData createGameData(TerminalSettings* terminal_settings) {
-  GameData NewGame;
-
-  NewGame.move_counter = 0;
-
-  // Populates array with 49 EMPTY tokes.
-  int i, j;
-  for (i = 0; i < 7; ++i) {
-    for (j = 0; j < 7; ++j) {
-      NewGame.array[i][j] = EMPTY;
-    }
+int runLabelCommand(CommandOptions* options) {
+  LabelStats stats;
+  options->label.tablebase = options->game.computer_tablebase;
+  if (runLabelPipeline(&options->label, &stats) == -1) {
+    perror("runLabelCommand->runLabelPipeline");
+    return 1;
   }
-
-  NewGame.connect_four_title_location =
-      findConnectFourTitleLocation(terminal_settings);
-  NewGame.game_board_location = findGameBoardLocation(terminal_settings);
-  NewGame.first_token_location = findFirstTokenLocation(terminal_settings);
-  NewGame.players_initial_location =
-      findPlayersInitialLocation(terminal_settings);
-  NewGame.directions_status_bar_location =
-      findDirectionsStatusBarLocation(terminal_settings);
-  NewGame.turn_status_bar_location =
-      findTurnStatusBarLocation(terminal_settings);
-  NewGame.winner_status_bar_location =
-      findWinnerStatusBarLocation(terminal_settings);
-  NewGame.blank_line_column_location = findBlankLineLocation(terminal_settings);
-  NewGame.end_game_status_bar_location =
-      findEndGameStatusBarLocation(terminal_settings);
-
-  return NewGame;
-}
-
-void disableBlinkingText() {
-  write(STDOUT_FILENO, BLINKING_OFF, strlen(BLINKING_OFF));
+  printLabelStats(&options->label, &stats);
+  return ferror(stdout) ? 1 : 0;
 }
 
-int disableRawInputMode(TerminalSettings* terminal_settings,
-                        char* error_message) {
-  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &terminal_settings->orig_termios) ==
-      -1) {
-    strcat(error_message, "die->disableRawInputMode->tcsetattr");
-    return -1;
+int runLoadTestCommand(CommandOptions* options) {
+  // The latency histogram is too large for the stack.
+  LoadTestStats* stats = malloc(sizeof(LoadTestStats));
+  if (stats == NULL || runLoadTest(&options->load_test, stats) == -1) {
+    perror("runLoadTestCommand->runLoadTest");
+    free(stats);
+    return 1;
   }
+  printLoadTestStats(&options->load_test, stats);
+  free(stats);
   return 0;
 }
 
-void displayBlueColorText() { write(STDOUT_FILENO, BLUE_COLOR, 5); }
-
-void displayCurrentPlayersToken(char* current_players_token) {
-  if (strcmp(current_players_token, PLAYER1) == 0) {
-    displayRedColorText();
-  } else {
-    displayYellowColorText();
+int runMakeBookCommand(CommandOptions* options) {
+  TranspositionTable table;
+  if (createTranspositionTable(&table, options->hash_megabytes) == -1) {
+    perror("runMakeBookCommand->createTranspositionTable");
+    return 1;
   }
-  displayStrings(current_players_token);
-  moveCursor(1, LEFT);
 
-  displayDefaultColorText();
-}
-
-void displayDefaultColorText() { write(STDOUT_FILENO, DEFAULT_COLOR, 5); }
-
-void displayDirectionsStatusBar(GameData* game_data) {
-  putCursorAt(game_data->directions_status_bar_location.row,
-              game_data->blank_line_column_location.col);
-  displayStrings(BLANK_LINE);
-  putCursorAt(game_data->directions_status_bar_location.row + 1,
-              game_data->blank_line_column_location.col);
-  displayStrings(BLANK_LINE);
-
-  putCursorAt(game_data->directions_status_bar_location.row,
-              game_data->directions_status_bar_location.col);
-  displayBlueColorText();
-  displayStrings(DIRECTION_ARROW);
-  putCursorAt(game_data->directions_status_bar_location.row + 1,
-              game_data->directions_status_bar_location.col);
-  displayStrings(DIRECTIONS_ENTER);
-  displayDefaultColorText();
-}
-
-void displayEndGameStatusBar(GameData* game_data) {
-  putCursorAt(game_data->end_game_status_bar_location.row,
-              game_data->blank_line_column_location.col);
-  displayStrings(BLANK_LINE);
-  putCursorAt(game_data->end_game_status_bar_location.row + 1,
-              game_data->blank_line_column_location.col);
-  displayStrings(BLANK_LINE);
-
-  putCursorAt(game_data->end_game_status_bar_location.row,
-              game_data->end_game_status_bar_location.col);
-  displayBlueColorText();
-  displayStrings(ENDGAME_DIRECTIONS);
-  displayDefaultColorText();
-}
-
-void displayGameBoard(GameData* game_data) {
-  clearTerm();
-  displayTitle(game_data->connect_four_title_location);
-  displayDirectionsStatusBar(game_data);
-  drawGameBoard(game_data->game_board_location);
-}
-
-void displayStrings(char* item) { write(STDOUT_FILENO, item, strlen(item)); }
-
-void displayRedColorText() { write(STDOUT_FILENO, RED_COLOR, 5); }
+  int64_t start_ns = currentTimeNs();
+  int64_t entries =
+      createOpeningBookFile(options->make_book_path, options->book_plies,
+                            options->game.computer_limits, &table);
+  destroyTranspositionTable(&table);
+  if (entries == -1) {
+    perror("runMakeBookCommand->createOpeningBookFile");
+    return 1;
+  }
 
-void displayTitle(CursorLocation connect_four_title_location) {
-  putCursorAt(connect_four_title_location.row, connect_four_title_location.col);
-  displayStrings(TITLE);
+  printf("plies %d entries %lld bytes %llu time_s %.3f\n",
+         options->book_plies, (long long)entries,
+         (unsigned long long)(sizeof(OpeningBookHeader) +
+                              entries * sizeof(uint64_t)),
+         (currentTimeNs() - start_ns) / 1e9);
+  return 0;
 }
 
-void displayTokenAt(int array[7][7], int col, int row) {
-  if (array[row][col] == 0) {
-    displayRedColorText();
-    write(STDOUT_FILENO, PLAYER1, strlen(PLAYER1));
-    displayDefaultColorText();
-  } else if (array[row][col] == 1) {
-    displayYellowColorText();
-    write(STDOUT_FILENO, PLAYER2, strlen(PLAYER2));
-    displayDefaultColorText();
-  } else {
-    write(STDOUT_FILENO, " ", 1);
+int runMakeTablebaseCommand(CommandOptions* options) {
+  TablebaseOptions Build;
+  if (createOpenPosition(options->tablebase_root, &Build.root) == -1) {
+    fprintf(stderr, "runMakeTablebaseCommand: invalid root \"%s\"\n",
+            options->tablebase_root);
+    return 1;
   }
-}
+  Build.min_tokens = options->tablebase_min_tokens;
+  Build.threads = options->game.computer_limits.threads;
+  Build.memory_megabytes = options->hash_megabytes;
 
-void displayTokens(GameData* game_data) {
-  int cursor_col = game_data->first_token_location.col;
-  int cursor_row = game_data->first_token_location.row;
-  int token_col, token_row;
-  for (token_col = 0; token_col < 7; ++token_col) {
-    for (token_row = 0; token_row < 7; ++token_row) {
-      putCursorAt(cursor_row, cursor_col);
-      displayTokenAt(game_data->array, token_col, token_row);
-      // Plus 2 is used because there are two spaces between the rows on the
-      // ASCII representation of the board.
-      cursor_row += 2;
-    }
-    cursor_row = game_data->first_token_location.row;
-    // Plus t4 is used because there are four spaces between the columns on the
-    // ASCII representation of the board.
-    cursor_col += 4;
+  TablebaseStats stats;
+  if (createTablebaseFile(options->make_tablebase_path, &Build, &stats) ==
+      -1) {
+    perror("runMakeTablebaseCommand->createTablebaseFile");
+    return 1;
   }
-}
 
-void displayTurnStatusBar(GameData* game_data) {
-  putCursorAt(game_data->turn_status_bar_location.row,
-              game_data->blank_line_column_location.col);
-  displayStrings(BLANK_LINE);
-
-  putCursorAt(game_data->turn_status_bar_location.row,
-              game_data->turn_status_bar_location.col);
-  if (game_data->move_counter % 2 == 0) {
-    displayRedColorText();
-    displayStrings(P1TURN);
-    displayDefaultColorText();
-  } else {
-    displayYellowColorText();
-    displayStrings(P2TURN);
-    displayDefaultColorText();
-  }
+  printf("positions %llu wins %llu draws %llu losses %llu bytes %llu "
+         "bits_per_position %.2f time_s %.3f\n",
+         (unsigned long long)stats.positions, (unsigned long long)stats.wins,
+         (unsigned long long)stats.draws, (unsigned long long)stats.losses,
+         (unsigned long long)stats.bytes,
+         stats.positions > 0 ? 8.0 * stats.bytes / stats.positions : 0,
+         stats.elapsed_ns / 1e9);
+  return 0;
 }
 
-void displayWinStatusBar(GameData* game_data) {
-  putCursorAt(game_data->winner_status_bar_location.row,
-              game_data->blank_line_column_location.col);
-  displayStrings(BLANK_LINE);
-
-  putCursorAt(game_data->winner_status_bar_location.row,
-              game_data->winner_status_bar_location.col);
-  enableBlinkingText();
-  if (game_data->move_counter % 2 == 0) {
-    displayYellowColorText();
-    displayStrings(P2WIN);
-  } else {
-    displayRedColorText();
-    displayStrings(P1WIN);
+int runSelfPlayCommand(CommandOptions* options) {
+  SelfPlayStats stats;
+  options->self_play.log = options->game.game_log;
+  if (runSelfPlay(&options->self_play, &stats) == -1) {
+    perror("runSelfPlayCommand->runSelfPlay");
+    return 1;
   }
-  displayDefaultColorText();
-  disableBlinkingText();
+  if (options->game.game_log != NULL &&
+      closeGameLog(options->game.game_log) == -1) {
+    perror("runSelfPlayCommand->closeGameLog");
+    return 1;
+  }
+  printSelfPlayStats(&options->self_play, &stats);
+  return 0;
 }
 
-void displayYellowColorText() { write(STDOUT_FILENO, YELLOW_COLOR, 5); }
-
-void drawGameBoard(CursorLocation game_board_location) {
-  putCursorAt(game_board_location.row, game_board_location.col);
-  displayBlueColorText();
-
-  int i, j;
-  for (i = 0; i < 15; ++i) {
-    moveCursor(1, DOWN);
-
-    if (i % 2 == 0) {
-      displayStrings(BOARDTOP);
-    } else {
-      for (j = 0; j < 29; ++j) {
-        if (j % 4 == 0) {
-          displayStrings("|");
-        } else
-          displayStrings(" ");
-      }
-    }
-    moveCursor(29, LEFT);
+int runServeCommand(CommandOptions* options) {
+  ServerStats stats;
+  if (runServer(&options->server, &stats) == -1) {
+    perror("runServeCommand->runServer");
+    return 1;
   }
 
-  displayDefaultColorText();
+  double seconds = stats.elapsed_ns / 1e9;
+  printf("connections %llu games %llu moves %llu time_s %.3f moves/s %.0f\n",
+         (unsigned long long)stats.connections,
+         (unsigned long long)stats.games, (unsigned long long)stats.moves,
+         seconds, seconds > 0 ? stats.moves / seconds : 0);
+  return 0;
 }
 
-boolean dropToken(GameData* game_data, int current_col_position) {
-  if (game_data->array[0][current_col_position] != EMPTY) {
-    return FALSE;
+int runSearchCommand(CommandOptions* options) {
+  Position position;
+  if (createOpenPosition(options->search_moves, &position) == -1) {
+    fprintf(stderr, "runSearchCommand: invalid moves \"%s\"\n",
+            options->search_moves);
+    return 1;
   }
 
-  int row;
-  for (row = 6; row >= 0; row--) {
-    if (game_data->array[row][current_col_position] == EMPTY) {
-      if ((game_data->move_counter % 2) == 0) {
-        game_data->array[row][current_col_position] = RED;
-      } else {
-        game_data->array[row][current_col_position] = YELLOW;
-      }
-      break;
-    }
+  TranspositionTable table;
+  if (createTranspositionTable(&table, options->hash_megabytes) == -1) {
+    perror("runSearchCommand->createTranspositionTable");
+    return 1;
   }
-  displayStrings(" ");
-  return TRUE;
-}
-
-void enableBlinkingText() {
-  write(STDOUT_FILENO, BLINKING_ON, strlen(BLINKING_ON));
-}
-
-int enableRawInputMode(struct termios OriginalTerm, char* error_message) {
-  struct termios new_settings = OriginalTerm;
-
-  // Documentation for termios.h flags:
-  // pubs.opengroup.org/onlinepubs/000095399/basedefs/termios.h.html
-  turnOffIflags(&new_settings.c_iflag);
-  turnOffOflags(&new_settings.c_oflag);
-  turnOffCflags(&new_settings.c_cflag);
-  turnOffLflags(&new_settings.c_lflag);
-  enableTimeOutForRead(&new_settings);
-  return applyNewterminal_settings(new_settings, error_message);
-}
-
-void enableTimeOutForRead(struct termios* new_settings) {
-  new_settings->c_cc[VMIN] = 0;
-  new_settings->c_cc[VTIME] = 1;
-}
 
-boolean endGame(GameData* game_data, char* error_message) {
-  displayEndGameStatusBar(game_data);
-
-  char player_input;
+  SearchLimits limits = options->game.computer_limits;
+  Evaluation evaluation = createEvaluation(&position);
+  if (options->game.evaluate) {
+    limits.evaluation = &evaluation;
+  }
+  int max_threads = limits.threads;
+  double base_nps = 0, base_seconds = 0;
+  // With --scaling the thread count doubles up to --threads, otherwise only
+  // --threads is searched.
+  limits.threads = options->search_scaling ? 1 : max_threads;
   while (TRUE) {
-    if (playerInputReader(&player_input, error_message) == -1) {
-      return 0;
+    clearTranspositionTable(&table);
+    SearchResult result = searchBestMove(&position, limits, &table,
+                                         options->game.computer_tablebase);
+    double seconds = result.elapsed_ns / 1e9;
+    double nps = seconds > 0 ? result.nodes / seconds : 0;
+    if (base_nps == 0) {
+      base_nps = nps;
+      base_seconds = seconds;
     }
 
-    switch (player_input) {
-    case 'y':
-    case 'Y':
-      return TRUE;
-      break;
-    case CTRL_KEY('q'):
-    case 'n':
-    case 'N':
-      return FALSE;
+    printf("threads %d depth %d move %d score %d nodes %llu time_ms %.1f "
+           "nps %.0f nps_speedup %.2f time_speedup %.2f\n",
+           limits.threads, result.depth, result.best_move + 1, result.score,
+           (unsigned long long)result.nodes, seconds * 1000, nps,
+           base_nps > 0 ? nps / base_nps : 0,
+           seconds > 0 ? base_seconds / seconds : 0);
+    fflush(stdout);
+
+    if (limits.threads == max_threads) {
       break;
     }
+    limits.threads *= 2;
+    if (limits.threads > max_threads) {
+      limits.threads = max_threads;
+    }
   }
-}
 
-void exitProgram(TerminalSettings* terminal_settings, char* error_message) {
-  clearScreen();
-  moveCursor(0, CORNER);
-  unhideCursor();
+  destroyTranspositionTable(&table);
+  return 0;
+}
 
-  if (disableRawInputMode(terminal_settings, error_message) == -1) {
-    strcat(error_message,
-           " Failed to disable Raw Input Mode. Restart terminal.");
+int runSolveCommand(CommandOptions* options) {
+  Position position;
+  if (createOpenPosition(options->solve_moves, &position) == -1) {
+    fprintf(stderr, "runSolveCommand: invalid moves \"%s\"\n",
+            options->solve_moves);
+    return 1;
   }
 
-  if (strcmp(error_message, NO_ERRORS) == 0) {
-    exit(0);
-  } else {
-    perror(error_message);
-    exit(1);
+  TranspositionTable table;
+  if (createTranspositionTable(&table, options->hash_megabytes) == -1) {
+    perror("runSolveCommand->createTranspositionTable");
+    return 1;
   }
-}
 
-CursorLocation findBlankLineLocation(TerminalSettings* terminal_settings) {
-  CursorLocation BlankLineCol;
-  BlankLineCol.col =
-      (terminal_settings->screen_cols / 2) - centerText(BLANK_LINE);
-  BlankLineCol.row = 0;
-  return BlankLineCol;
-}
-
-CursorLocation
-findConnectFourTitleLocation(TerminalSettings* terminal_settings) {
-  CursorLocation Title;
+  SolveResult result;
+  solvePosition(&position, &table, &result);
+  double seconds = result.elapsed_ns / 1e9;
 
-  Title.col = (terminal_settings->screen_cols / 2) - centerText(TITLE);
-  Title.row = (terminal_settings->screen_rows / 2) - 14;
-
-  return Title;
-}
-
-char* findCurrentPlayersToken(int move_counter) {
-  if (move_counter % 2 == 0) {
-    return PLAYER1;
-  } else {
-    return PLAYER2;
+  // The principal variation is printed as a move string like the input.
+  char principal_variation[BOARD_CELLS + 1];
+  int i;
+  for (i = 0; i < result.principal_variation_length; ++i) {
+    principal_variation[i] = '1' + result.principal_variation[i];
   }
-}
+  principal_variation[i] = '\0';
 
-CursorLocation
-findDirectionsStatusBarLocation(TerminalSettings* terminal_settings) {
-  CursorLocation Direct;
+  printf("result %s score %d distance %d move %d pv %s nodes %llu "
+         "time_ms %.1f nps %.0f\n",
+         result.score > 0 ? "win" : result.score < 0 ? "loss" : "draw",
+         result.score, findSolveDistance(&position, result.score),
+         result.best_move + 1,
+         result.principal_variation_length > 0 ? principal_variation : "-",
+         (unsigned long long)result.nodes, seconds * 1000,
+         seconds > 0 ? result.nodes / seconds : 0);
 
-  Direct.col =
-      (terminal_settings->screen_cols / 2) - centerText(DIRECTION_ARROW);
-  Direct.row = (terminal_settings->screen_rows / 2) + 12;
-
-  return Direct;
-}
-
-CursorLocation
-findEndGameStatusBarLocation(TerminalSettings* terminal_settings) {
-  CursorLocation End;
-
-  End.col =
-      (terminal_settings->screen_cols / 2) - centerText(ENDGAME_DIRECTIONS);
-  End.row = (terminal_settings->screen_rows / 2) + 12;
-
-  return End;
-}
-
-CursorLocation findFirstTokenLocation(TerminalSettings* terminal_settings) {
-  CursorLocation FirstToken;
-
-  FirstToken.col =
-      (terminal_settings->screen_cols / 2) - (centerText(BOARDTOP) - 2);
-  FirstToken.row = (terminal_settings->screen_rows / 2) - 4;
-
-  return FirstToken;
-}
-
-CursorLocation findGameBoardLocation(TerminalSettings* terminal_settings) {
-  CursorLocation GameBoard;
-
-  GameBoard.col = (terminal_settings->screen_cols / 2) - centerText(BOARDTOP);
-  GameBoard.row = (terminal_settings->screen_rows / 2) - 6;
-
-  return GameBoard;
-}
-
-CursorLocation findPlayersInitialLocation(TerminalSettings* terminal_settings) {
-  CursorLocation Players;
-
-  Players.col =
-      (terminal_settings->screen_cols / 2) - (centerText(BOARDTOP) - 2);
-  Players.row = (terminal_settings->screen_rows / 2) - 6;
-
-  return Players;
-}
-
-CursorLocation findTurnStatusBarLocation(TerminalSettings* terminal_settings) {
-  CursorLocation Turn;
-
-  Turn.col = (terminal_settings->screen_cols / 2) - centerText(P1TURN);
-  Turn.row = (terminal_settings->screen_rows / 2) - 8;
-
-  return Turn;
+  destroyTranspositionTable(&table);
+  return 0;
 }
 
-CursorLocation
-findWinnerStatusBarLocation(TerminalSettings* terminal_settings) {
-  CursorLocation WinStatusBar;
+/*** Main ***/
 
-  WinStatusBar.col = (terminal_settings->screen_cols / 2) - centerText(P1WIN);
-  WinStatusBar.row = (terminal_settings->screen_rows / 2) - 8;
+int main(int argc, char* argv[]) {
+  char error_message[50] = NO_ERRORS;
 
-  return WinStatusBar;
-}
+  CommandOptions options;
+  if (parseCommandLine(argc, argv, &options) == -1) {
+    fprintf(stderr, "%s%s", USAGE, USAGE_OPTIONS);
+    exit(1);
+  }
 
-boolean gamePlayLoop(GameData* game_data, char* error_message) {
-  char* current_players_token =
-      findCurrentPlayersToken(game_data->move_counter);
-  putCursorAt(game_data->players_initial_location.row,
-              game_data->players_initial_location.col);
-  displayCurrentPlayersToken(current_players_token);
-
-  char player_input;
-  int current_player_turn = TRUE;
-  int current_position = 0;
-  while (current_player_turn) {
-    if (playerInputReader(&player_input, error_message) == -1) {
-      return FALSE;
+  // The tablebase is mapped, not read, and serves both --ai and --search.
+  Tablebase computer_tablebase;
+  if (options.tablebase_path != NULL) {
+    if (openTablebase(options.tablebase_path, &computer_tablebase) == -1) {
+      fprintf(stderr, "main: cannot open the tablebase \"%s\"\n",
+              options.tablebase_path);
+      exit(1);
     }
+    options.game.computer_tablebase = &computer_tablebase;
+  }
 
-    switch (player_input) {
-    // Used for quitting the game manually.
-    case CTRL_KEY('q'):
-      return FALSE;
-      break;
-
-    case RIGHT_ARROW:
-      // Wrap token to the other side logic. If the token is at the right
-      // boundary and the player hits the right key, the token is placed at the
-      // left boundary.
-      if (current_position == RIGHT_BOUNDARY) {
-        placeTokenAtLeftBoundary(current_players_token, &current_position);
-      } else {
-        moveTokenRight(current_players_token, &current_position);
-      }
-      break;
-
-    case LEFT_ARROW:
-      // Wrap token to the other side logic. If the token is at the left
-      // boundary and the player hits the left key, the token is placed at the
-      // right boundary.
-      if (current_position == LEFT_BOUNDARY) {
-        placeTokenAtRightBoundary(current_players_token, &current_position);
-      } else {
-        moveTokenLeft(current_players_token, &current_position);
-      }
-      break;
-
-    case ENTER:
-      if (dropToken(game_data, current_position)) {
-        current_player_turn = FALSE;
-        game_data->move_counter++;
-      }
-      break;
+  // Games are appended to the log, which is created on first use.
+  GameLog game_log;
+  if (options.log_path != NULL) {
+    if (openGameLog(options.log_path, &game_log) == -1) {
+      fprintf(stderr, "main: cannot open the game log \"%s\"\n",
+              options.log_path);
+      exit(1);
     }
+    options.game.game_log = &game_log;
   }
-  return TRUE;
-}
-
-int getWindowSize(int* out_rows, int* out_cols) {
-  struct winsize Ws;
 
-  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &Ws) == -1 || Ws.ws_col == 0) {
-    return -1;
-  } else {
-    *out_cols = Ws.ws_col;
-    *out_rows = Ws.ws_row;
-    return 0;
+  // Headless modes never touch the terminal settings.
+  if (options.analyze_path != NULL) {
+    return runAnalyzeCommand(&options);
   }
-}
-
-void hideCursor() { write(STDOUT_FILENO, HIDE, 6); }
-
-TerminalSettings initializeTerminalSettings(char* error_message) {
-  TerminalSettings OldSettings;
-  OldSettings.successful_initialization = 0;
-
-  if (tcgetattr(STDIN_FILENO, &OldSettings.orig_termios) == -1) {
-    strcat(error_message, "initializeTerminalSettings->tcgetattr");
-    OldSettings.successful_initialization = -1;
+  if (options.label.input_path != NULL) {
+    return runLabelCommand(&options);
   }
-
-  // find terminal window size to center the game display.
-  if (getWindowSize(&OldSettings.screen_rows, &OldSettings.screen_cols) == -1) {
-    strcat(error_message, "initialize_terminal_settings->getWindowSize");
-    OldSettings.successful_initialization = -1;
+  if (options.search_moves != NULL) {
+    return runSearchCommand(&options);
   }
-
-  return OldSettings;
-}
-
-void moveCursor(int amount, char* direction) {
-  char esc[10] = ESC;
-  if (amount > 1) {
-    char buffer[10];
-
-    sprintf(buffer, "%d", amount);
-    strcat(esc, buffer);
+  if (options.solve_moves != NULL) {
+    return runSolveCommand(&options);
   }
-  strcat(esc, direction);
-
-  write(STDOUT_FILENO, esc, sizeof(esc));
-}
-
-void moveTokenLeft(char* current_players_token, int* current_position) {
-  displayStrings(" ");
-  moveCursor(5, LEFT);
-  displayCurrentPlayersToken(current_players_token);
-  *current_position = *current_position - 1;
-}
-
-void moveTokenRight(char* current_players_token, int* current_position) {
-  displayStrings(" ");
-  moveCursor(3, RIGHT);
-  displayCurrentPlayersToken(current_players_token);
-  *current_position = *current_position + 1;
-}
-
-void placeTokenAtLeftBoundary(char* current_players_token,
-                              int* current_position) {
-  displayStrings(" ");
-  moveCursor(25, LEFT);
-  displayCurrentPlayersToken(current_players_token);
-  *current_position = LEFT_BOUNDARY;
-}
-
-void placeTokenAtRightBoundary(char* current_players_token,
-                               int* current_position) {
-  displayStrings(" ");
-  moveCursor(23, RIGHT);
-  displayCurrentPlayersToken(current_players_token);
-  *current_position = RIGHT_BOUNDARY;
-}
-
-int playerInputReader(char* player_input, char* error_message) {
-  int readerOutput;
-  while ((readerOutput = read(STDIN_FILENO, player_input, 1)) != 1) {
-    if (readerOutput == -1 && errno != EAGAIN) {
-      strcat(error_message, "playerInput->read");
-      return 0;
-    }
+  if (options.self_play.games > 0) {
+    return runSelfPlayCommand(&options);
   }
-
-  // If arrow key was used, figures out which one (finding the third
-  // character).
-  if (*player_input == '\x1b') {
-    if (read(STDIN_FILENO, player_input, 1) == -1) {
-      strcat(error_message, "playerInput->playerInputReader->read");
-      return -1;
-    }
-
-    if (*player_input == '[') {
-      if (read(STDIN_FILENO, player_input, 1) == -1) {
-        strcat(error_message, "playerInput->playerInputReader->read");
-        return -1;
-      }
-    }
+  if (options.make_book_path != NULL) {
+    return runMakeBookCommand(&options);
+  }
+  if (options.make_tablebase_path != NULL) {
+    return runMakeTablebaseCommand(&options);
+  }
+  if (options.server.port != 0) {
+    return runServeCommand(&options);
+  }
+  if (options.load_test.port != 0) {
+    return runLoadTestCommand(&options);
   }
 
-  return 0;
-}
-
-void putCursorAt(int row, int col) {
-  char esc[20] = ESC;
-
-  char buffer[10];
-  sprintf(buffer, "%d", row);
-  strcat(esc, buffer);
-  strcat(esc, ";");
-
-  sprintf(buffer, "%d", col);
-  strcat(esc, buffer);
-
-  strcat(esc, "H");
-
-  write(STDOUT_FILENO, esc, sizeof(esc));
-}
-
-void showConnectFour(GameData* game_data, int row, int col, int vector) {
-  enableBlinkingText();
-  int i;
-  int temp_col = col;
-  int temp_row = row;
-  switch (vector) {
-  // Using the first token as a base, the rows and col have thier indexs
-  // multipled by the distance between tokens(2 and 4 respectively) to overwrite
-  // the token in that position with a blinking token.
-  case HORIZONTAL:
-    for (i = 0; i < 4; ++i) {
-      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
-                  game_data->first_token_location.col + (temp_col * 4));
-      displayTokenAt(game_data->array, temp_col--, temp_row);
-    }
-
-    break;
-
-  case LEFTDIAG:
-    for (i = 0; i < 4; ++i) {
-      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
-                  game_data->first_token_location.col + (temp_col * 4));
-      displayTokenAt(game_data->array, temp_col--, temp_row--);
-    }
-
-    break;
-
-  case VERTICAL:
-    for (i = 0; i < 4; ++i) {
-      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
-                  game_data->first_token_location.col + (temp_col * 4));
-      displayTokenAt(game_data->array, temp_col, temp_row--);
+  TranspositionTable computer_table;
+  OpeningBook computer_book;
+  if (options.game.computer_opponent) {
+    if (createTranspositionTable(&computer_table, options.hash_megabytes) ==
+        -1) {
+      perror("main->createTranspositionTable");
+      exit(1);
     }
-
-    break;
-
-  case RIGHTDIAG:
-    for (i = 0; i < 4; ++i) {
-      putCursorAt(game_data->first_token_location.row + (temp_row * 2),
-                  game_data->first_token_location.col + (temp_col * 4));
-      displayTokenAt(game_data->array, temp_col++, temp_row--);
+    options.game.computer_table = &computer_table;
+
+    // The book is mapped, not read, so a large book starts as fast as a small
+    // one.
+    if (options.book_path != NULL) {
+      if (openOpeningBook(options.book_path, &computer_book) == -1) {
+        fprintf(stderr, "main: cannot open the opening book \"%s\"\n",
+                options.book_path);
+        exit(1);
+      }
+      options.game.computer_book = &computer_book;
     }
-
-    break;
   }
-  disableBlinkingText();
-}
-
-void recreateGame(TerminalSettings* terminal_settings, GameData* game_data) {
-
-  *game_data = createGameData(terminal_settings);
-
-  displayDirectionsStatusBar(game_data);
-  displayTurnStatusBar(game_data);
-  displayTokens(game_data);
-}
-
-void turnOffCflags(tcflag_t* c_cflag) {
-  // CS8: misc flag
-  *c_cflag |= (CS8);
-}
-
-void turnOffIflags(tcflag_t* c_iflag) {
-  // BRKINT: misc flag, ICRNL: ctrl-m, INPCK: misc flag,
-  // ISTRIP: misc flag, IXON: ctrl_s and ctrl_q
-  *c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
-}
-
-void turnOffLflags(tcflag_t* c_lflag) {
-  // ECHO:Print text to screen, ICANON:Canonical Mode, IEXTEN & ISIG:ctrl=c
-  // and ctrl-v
-  *c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
-}
-
-void turnOffOflags(tcflag_t* c_oflag) {
-  // OPOST: output processing /r/n
-  *c_oflag &= ~(OPOST);
-}
-
-void unhideCursor() { write(STDOUT_FILENO, UNHIDE, 6); }
-
-/*** Main ***/
-
-int main() {
-  char error_message[50] = NO_ERRORS;
 
   // Cannot use exitProgram function for failure of initalizeterminal_settings
   // because the state of terminal_settings will be unknown. However, no
@@ -1098,6 +676,10 @@ int main() {
   if (enableRawInputMode(terminal_settings.orig_termios, error_message) == -1) {
     exitProgram(&terminal_settings, error_message);
   }
+  // A resize wakes the input loop like a key press and redraws the game.
+  if (initializeInputEvents(error_message) == -1) {
+    exitProgram(&terminal_settings, error_message);
+  }
 
   // initialized game data and draws the board / title.
   GameData game_data = createGameData(&terminal_settings);
@@ -1105,18 +687,21 @@ int main() {
 
   int game_not_quit = TRUE;
   while (game_not_quit) {
-    // The function displayTokens is prior to the function connectFourPresent so
-    // that upon a winning move the last token placement is displayed.
+    // The function displayTokens is prior to the function
+    // connectFourAtLastDrop so that upon a winning move the last token
+    // placement is displayed.
     displayTokens(&game_data);
 
-    // If connect four is present, show who won and give the option to restart
-    // game or quit.
-    if (connectFourPresent(&game_data)) {
+    // If connect four is present or the board is full, show who won or that
+    // the game is a draw and give the option to restart game or quit.
+    if (connectFourAtLastDrop(&game_data) ||
+        isBoardFull(&game_data.state.position)) {
       displayWinStatusBar(&game_data);
+      logGame(&game_data, &options.game);
       if (endGame(&game_data, error_message) == FALSE) {
         break;
       } else {
-        recreateGame(&terminal_settings, &game_data);
+        recreateGame(&game_data);
       }
     } else {
       displayTurnStatusBar(&game_data);
@@ -1124,7 +709,13 @@ int main() {
 
     // Contains the main gameplay loop and returns if the player decided to quit
     // manually.
-    game_not_quit = gamePlayLoop(&game_data, error_message);
+    game_not_quit = gamePlayLoop(&game_data, &options.game, error_message);
+  }
+
+  // A game quit before it ended is logged as far as it went.
+  logGame(&game_data, &options.game);
+  if (options.game.game_log != NULL) {
+    closeGameLog(options.game.game_log);
   }
 
   // Exits the program for both error and non error modes.
@@ -0,0 +1,231 @@
+// Connect Four
+// Author: Scott Helms
+
+// madvise is not part of POSIX.
+#define _DEFAULT_SOURCE
+
+#include "record.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "search.h"
+
+/*** Define ***/
+
+// GAME_LOG_WINDOW is how much of the log the analyzer replays before it drops
+// the pages behind it.
+#define GAME_LOG_WINDOW (64 << 20)
+#define LENGTH_BAR_WIDTH 40
+
+/*** Declorations ***/
+
+// replayGameRecord plays the moves of one record and adds the game to the
+// stats, or counts it as invalid.
+static void replayGameRecord(const uint8_t* moves, int length,
+                             GameLogStats* stats);
+
+/*** Functions ***/
+
+int analyzeGameLog(const char* path, GameLogStats* out_stats) {
+  memset(out_stats, 0, sizeof(*out_stats));
+  int64_t start_ns = currentTimeNs();
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+  struct stat status;
+  if (fstat(fd, &status) == -1 ||
+      (size_t)status.st_size < sizeof(GameLogHeader)) {
+    close(fd);
+    return -1;
+  }
+  size_t size = status.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return -1;
+  }
+
+  const GameLogHeader* header = mapping;
+  if (memcmp(header->magic, GAME_LOG_MAGIC, sizeof(GAME_LOG_MAGIC)) != 0 ||
+      header->board_width != BOARD_WIDTH ||
+      header->board_height != BOARD_HEIGHT ||
+      header->connect_length != CONNECT_LENGTH) {
+    munmap(mapping, size);
+    return -1;
+  }
+  // The kernel reads ahead of a sequential scan, and the pages already
+  // replayed are dropped so the file never has to fit in memory.
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  const uint8_t* data = mapping;
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t offset = sizeof(GameLogHeader);
+  size_t released = 0;
+  while (offset < size) {
+    int length = data[offset];
+    // Past a bad length or the end of the file the next record cannot be
+    // found.
+    if (length > BOARD_CELLS || offset + 1 + length > size) {
+      out_stats->invalid++;
+      break;
+    }
+    replayGameRecord(data + offset + 1, length, out_stats);
+    offset += 1 + length;
+
+    if (offset - released >= GAME_LOG_WINDOW) {
+      size_t end = offset / page_size * page_size;
+      madvise((char*)mapping + released, end - released, MADV_DONTNEED);
+      released = end;
+    }
+  }
+
+  munmap(mapping, size);
+  out_stats->bytes = size;
+  out_stats->elapsed_ns = currentTimeNs() - start_ns;
+  return 0;
+}
+
+int appendGameRecord(GameLog* log, const GameRecord* record) {
+  // The length byte and the moves after it are written in one piece, so the
+  // records of several threads never interleave.
+  pthread_mutex_lock(&log->lock);
+  size_t written = fwrite(record, 1, 1 + record->length, log->file);
+  pthread_mutex_unlock(&log->lock);
+  return written == 1 + (size_t)record->length ? 0 : -1;
+}
+
+int closeGameLog(GameLog* log) {
+  pthread_mutex_destroy(&log->lock);
+  boolean failed = ferror(log->file);
+  return fclose(log->file) == 0 && !failed ? 0 : -1;
+}
+
+int openGameLog(const char* path, GameLog* out_log) {
+  // Writes always go to the end of the file, reads start wherever the file
+  // is positioned.
+  FILE* file = fopen(path, "a+b");
+  if (file == NULL) {
+    return -1;
+  }
+
+  GameLogHeader Header;
+  boolean valid;
+  if (fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0) {
+    memset(&Header, 0, sizeof(Header));
+    memcpy(Header.magic, GAME_LOG_MAGIC, sizeof(GAME_LOG_MAGIC));
+    Header.board_width = BOARD_WIDTH;
+    Header.board_height = BOARD_HEIGHT;
+    Header.connect_length = CONNECT_LENGTH;
+    valid = fwrite(&Header, sizeof(Header), 1, file) == 1;
+  } else {
+    valid = fseek(file, 0, SEEK_SET) == 0 &&
+            fread(&Header, sizeof(Header), 1, file) == 1 &&
+            memcmp(Header.magic, GAME_LOG_MAGIC, sizeof(GAME_LOG_MAGIC)) ==
+                0 &&
+            Header.board_width == BOARD_WIDTH &&
+            Header.board_height == BOARD_HEIGHT &&
+            Header.connect_length == CONNECT_LENGTH;
+  }
+  if (!valid) {
+    fclose(file);
+    return -1;
+  }
+
+  out_log->file = file;
+  pthread_mutex_init(&out_log->lock, NULL);
+  return 0;
+}
+
+void printGameLogStats(const GameLogStats* stats) {
+  double seconds = stats->elapsed_ns / 1e9;
+  printf("games %llu moves %llu invalid %llu unfinished %llu bytes %llu "
+         "time_s %.3f games_per_s %.0f mb_per_s %.1f\n",
+         (unsigned long long)stats->games, (unsigned long long)stats->moves,
+         (unsigned long long)stats->invalid,
+         (unsigned long long)stats->unfinished,
+         (unsigned long long)stats->bytes, seconds,
+         seconds > 0 ? stats->games / seconds : 0,
+         seconds > 0 ? stats->bytes / seconds / 1e6 : 0);
+
+  double moves = stats->moves > 0 ? stats->moves : 1;
+  int col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    printf("column %d moves %llu (%.2f%%)\n", col + 1,
+           (unsigned long long)stats->column_moves[col],
+           100.0 * stats->column_moves[col] / moves);
+  }
+
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    double games =
+        stats->opening_games[col] > 0 ? stats->opening_games[col] : 1;
+    printf("opening %d games %llu red_wins %.2f%% yellow_wins %.2f%% "
+           "draws %.2f%%\n",
+           col + 1, (unsigned long long)stats->opening_games[col],
+           100.0 * stats->opening_wins[col][RED] / games,
+           100.0 * stats->opening_wins[col][YELLOW] / games,
+           100.0 * stats->opening_draws[col] / games);
+  }
+
+  uint64_t most = 1;
+  int length;
+  for (length = 0; length <= BOARD_CELLS; ++length) {
+    if (stats->lengths[length] > most) {
+      most = stats->lengths[length];
+    }
+  }
+  for (length = 0; length <= BOARD_CELLS; ++length) {
+    if (stats->lengths[length] == 0) {
+      continue;
+    }
+    char bar[LENGTH_BAR_WIDTH + 1];
+    int width = stats->lengths[length] * LENGTH_BAR_WIDTH / most;
+    memset(bar, '#', width);
+    bar[width] = '\0';
+    printf("length %2d games %10llu%s%s\n", length,
+           (unsigned long long)stats->lengths[length], width > 0 ? " " : "",
+           bar);
+  }
+}
+
+static void replayGameRecord(const uint8_t* moves, int length,
+                             GameLogStats* stats) {
+  Position position = createPosition();
+  int winner = EMPTY;
+  int i;
+  for (i = 0; i < length; ++i) {
+    int col = moves[i];
+    if (winner != EMPTY || col >= BOARD_WIDTH || !canPlay(&position, col)) {
+      stats->invalid++;
+      return;
+    }
+    if (isWinningMove(&position, col)) {
+      winner = currentPlayer(&position);
+    }
+    playMove(&position, col);
+  }
+
+  stats->games++;
+  stats->moves += length;
+  stats->lengths[length]++;
+  for (i = 0; i < length; ++i) {
+    stats->column_moves[moves[i]]++;
+  }
+  if (winner == EMPTY && !isBoardFull(&position)) {
+    stats->unfinished++;
+  }
+  if (length == 0) {
+    return;
+  }
+  stats->opening_games[moves[0]]++;
+  if (winner != EMPTY) {
+    stats->opening_wins[moves[0]][winner]++;
+  } else if (isBoardFull(&position)) {
+    stats->opening_draws[moves[0]]++;
+  }
+}
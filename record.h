@@ -0,0 +1,96 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bitboard.h"
+
+/*** Define ***/
+
+#define GAME_LOG_MAGIC "C4GL2"
+
+/*** Structures ***/
+
+// GameLogHeader starts the game log file. The records follow it back to back:
+// a byte with the number of moves, then one byte per move with its column.
+typedef struct GameLogHeader {
+  char magic[8];
+  uint32_t board_width;
+  uint32_t board_height;
+  uint32_t connect_length;
+} GameLogHeader;
+
+// GameRecord is the moves of one game in the order they were played. A game
+// that was quit before it ended is recorded as far as it went.
+typedef struct GameRecord {
+  uint8_t length;
+  uint8_t moves[BOARD_CELLS];
+} GameRecord;
+
+// GameLog is a game log file open for appending. The games of several threads
+// can be appended to it at once.
+typedef struct GameLog {
+  FILE* file;
+  pthread_mutex_t lock;
+} GameLog;
+
+// GameLogStats is what analyzeGameLog finds in a game log.
+typedef struct GameLogStats {
+  uint64_t games;
+  uint64_t moves;
+  uint64_t bytes;
+  // invalid counts the records with a move that cannot be played or that
+  // follows a win, and a record cut off by the end of the file.
+  uint64_t invalid;
+  // unfinished counts the games that were quit before they ended.
+  uint64_t unfinished;
+  uint64_t column_moves[BOARD_WIDTH];
+  // The opening of a game is its first column, the games without a move have
+  // none.
+  uint64_t opening_games[BOARD_WIDTH];
+  // opening_wins is indexed by the opening and the token of the winner.
+  uint64_t opening_wins[BOARD_WIDTH][2];
+  uint64_t opening_draws[BOARD_WIDTH];
+  // lengths counts the games by their number of moves.
+  uint64_t lengths[BOARD_CELLS + 1];
+  int64_t elapsed_ns;
+} GameLogStats;
+
+/*** Declorations ***/
+
+// analyzeGameLog replays every game of the game log file at path through the
+// move and win logic and counts the moves per column, the results per opening
+// and the game lengths. The file is mapped and read once front to back, the
+// pages behind the replay are dropped as it goes, so a log of any size never
+// takes more than a window of memory. Returns -1 if the file cannot be mapped
+// or is not a game log for this board, 0 otherwise.
+int analyzeGameLog(const char* path, GameLogStats* out_stats);
+
+// appendGameRecord adds the game to the end of the log. Returns -1 if it
+// cannot be written, 0 otherwise.
+int appendGameRecord(GameLog* log, const GameRecord* record);
+
+// closeGameLog writes out what is left of the log and closes it. Returns -1 if
+// any of the log could not be written, 0 otherwise.
+int closeGameLog(GameLog* log);
+
+// openGameLog opens the game log file at path for appending, creating it with
+// its header if it does not exist. Returns -1 if it cannot be opened or is not
+// a game log for this board, 0 otherwise.
+int openGameLog(const char* path, GameLog* out_log);
+
+// printGameLogStats prints the moves per column, the win rates per opening and
+// the game length histogram.
+void printGameLogStats(const GameLogStats* stats);
+
+// addRecordMove appends the column to the record.
+static inline void addRecordMove(GameRecord* record, int col) {
+  record->moves[record->length++] = col;
+}
+
+#endif
@@ -0,0 +1,400 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "search.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*** Define ***/
+
+// The clock is only read once every TIME_CHECK_NODES nodes.
+#define TIME_CHECK_NODES 1024
+
+/*** Structures ***/
+
+typedef struct SearchContext {
+  TranspositionTable* table;
+  const Tablebase* tablebase;
+  uint64_t nodes;
+  int64_t deadline_ns;
+  // shared_stop is set by the main thread to stop every helper thread.
+  int* shared_stop;
+  // external_stop is SearchLimits.stop, NULL if the caller cannot stop it.
+  int* external_stop;
+  boolean stopped;
+  int64_t start_ns;
+  // report is NULL for the helper threads.
+  void (*report)(const SearchResult* result, void* report_data);
+  void* report_data;
+  // evaluations holds the evaluation of every position on the current line,
+  // indexed by its number of tokens, when evaluate is TRUE.
+  boolean evaluate;
+  Evaluation evaluations[BOARD_CELLS + 1];
+} SearchContext;
+
+typedef struct SearchThread {
+  pthread_t thread;
+  SearchContext context;
+  const Position* position;
+  int first_depth;
+  int max_depth;
+  SearchResult result;
+} SearchThread;
+
+/*** Declorations ***/
+
+// addSearchToken evaluates the position one token in col after position from
+// the evaluation of position, if the search evaluates its leaves.
+static inline void addSearchToken(SearchContext* context,
+                                  const Position* position, int col);
+
+// helperThread runs the iterative deepening of a lazy SMP helper thread.
+static void* helperThread(void* search_thread);
+
+// iterativeDeepening searches the position one depth deeper at a time, from
+// first_depth up to max_depth, and keeps the result of the last complete depth.
+// result->best_move must hold a legal move to fall back on.
+static void iterativeDeepening(SearchContext* context, const Position* position,
+                               int first_depth, int max_depth,
+                               SearchResult* result);
+
+// negamax returns the score of the position for the player to move, searched
+// to depth plies within the alpha beta window.
+static int negamax(SearchContext* context, const Position* position, int depth,
+                   int alpha, int beta);
+
+// searchRoot searches every move of the position to depth plies and returns the
+// best score. first_move is tried before the center first order.
+static int searchRoot(SearchContext* context, const Position* position,
+                      int depth, int first_move, int* out_best_move);
+
+// timeIsUp checks the clock and the stop flags every TIME_CHECK_NODES nodes
+// and marks the search as stopped once any of them says so.
+static boolean timeIsUp(SearchContext* context);
+
+/*** Functions ***/
+
+static inline void addSearchToken(SearchContext* context,
+                                  const Position* position, int col) {
+  if (context->evaluate) {
+    Evaluation* evaluation = &context->evaluations[position->move_counter];
+    evaluation[1] = evaluation[0];
+    addEvaluationToken(&evaluation[1], position, col);
+  }
+}
+
+SearchLimits createSearchLimits(int depth, int time_ms) {
+  SearchLimits Limits;
+  Limits.depth = depth;
+  Limits.time_ms = time_ms;
+  Limits.threads = 1;
+  Limits.stop = NULL;
+  Limits.report = NULL;
+  Limits.report_data = NULL;
+  Limits.evaluation = NULL;
+  return Limits;
+}
+
+int64_t currentTimeNs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void* helperThread(void* search_thread) {
+  SearchThread* helper = search_thread;
+  iterativeDeepening(&helper->context, helper->position, helper->first_depth,
+                     helper->max_depth, &helper->result);
+  return NULL;
+}
+
+static void iterativeDeepening(SearchContext* context, const Position* position,
+                               int first_depth, int max_depth,
+                               SearchResult* result) {
+  int depth;
+  for (depth = first_depth; depth <= max_depth; ++depth) {
+    int best_move;
+    int score =
+        searchRoot(context, position, depth, result->best_move, &best_move);
+    // An unfinished iteration is thrown away, the last complete one stands.
+    if (context->stopped) {
+      break;
+    }
+
+    result->best_move = best_move;
+    result->score = score;
+    result->depth = depth;
+    if (context->report != NULL) {
+      result->nodes = context->nodes;
+      result->elapsed_ns = currentTimeNs() - context->start_ns;
+      context->report(result, context->report_data);
+    }
+    if (score >= WIN_SCORE - BOARD_CELLS || score <= BOARD_CELLS - WIN_SCORE) {
+      break;
+    }
+  }
+}
+
+static int negamax(SearchContext* context, const Position* position, int depth,
+                   int alpha, int beta) {
+  context->nodes++;
+  if (timeIsUp(context)) {
+    return 0;
+  }
+
+  if (isBoardFull(position)) {
+    return 0;
+  }
+  if (hasWinningMove(position)) {
+    return WIN_SCORE - (position->move_counter + 1);
+  }
+
+  // The tablebase knows who wins but not how soon, so a win or a loss only
+  // bounds the score by the slowest possible one.
+  if (context->tablebase != NULL) {
+    int value = probeTablebase(context->tablebase, position);
+    if (value == TABLEBASE_DRAW) {
+      return 0;
+    }
+    if (value == TABLEBASE_WIN) {
+      if (depth == 0 || WIN_SCORE - BOARD_CELLS >= beta) {
+        return WIN_SCORE - BOARD_CELLS;
+      }
+      if (alpha < WIN_SCORE - BOARD_CELLS) {
+        alpha = WIN_SCORE - BOARD_CELLS;
+      }
+    } else if (value == TABLEBASE_LOSS) {
+      if (depth == 0 || -(WIN_SCORE - BOARD_CELLS) <= alpha) {
+        return -(WIN_SCORE - BOARD_CELLS);
+      }
+      if (beta > -(WIN_SCORE - BOARD_CELLS)) {
+        beta = -(WIN_SCORE - BOARD_CELLS);
+      }
+    }
+  }
+
+  if (depth == 0) {
+    return context->evaluate
+               ? evaluatePosition(
+                     &context->evaluations[position->move_counter], position)
+               : 0;
+  }
+
+  bitboard key = findPositionKey(position);
+  int hash_move = NO_MOVE;
+  TranspositionEntry entry;
+  if (context->table != NULL &&
+      probeTranspositionTable(context->table, key, &entry)) {
+    hash_move = entry.best_move;
+    if (entry.depth >= depth) {
+      if (entry.bound == EXACT_BOUND) {
+        return entry.score;
+      }
+      if (entry.bound == LOWER_BOUND && entry.score > alpha) {
+        alpha = entry.score;
+      } else if (entry.bound == UPPER_BOUND && entry.score < beta) {
+        beta = entry.score;
+      }
+      if (alpha >= beta) {
+        return entry.score;
+      }
+    }
+  }
+
+  // The player to move cannot win before their next token, which is two
+  // tokens away, so the window can be capped.
+  int max = WIN_SCORE - (position->move_counter + 3);
+  if (beta > max) {
+    beta = max;
+    if (alpha >= beta) {
+      return beta;
+    }
+  }
+
+  int original_alpha = alpha;
+  int best = -INFINITE_SCORE;
+  int best_move = NO_MOVE;
+  // The move from the table is tried first, then the center first order
+  // without it. A move from another position sharing the slot is not in the
+  // mask and is skipped.
+  unsigned moves = findLegalMoves(position);
+  unsigned hash_bit =
+      hash_move == NO_MOVE ? 0 : 1u << findColumnOrderIndex(hash_move);
+  while (moves != 0) {
+    int col;
+    if ((moves & hash_bit) != 0) {
+      col = hash_move;
+      moves &= ~hash_bit;
+    } else {
+      col = popLegalMove(&moves);
+    }
+
+    Position child = *position;
+    addSearchToken(context, position, col);
+    playMove(&child, col);
+    int score = -negamax(context, &child, depth - 1, -beta, -alpha);
+    if (score > best) {
+      best = score;
+      best_move = col;
+    }
+    if (score > alpha) {
+      alpha = score;
+    }
+    if (alpha >= beta) {
+      break;
+    }
+  }
+
+  // Scores of a stopped search are meaningless and must not be stored.
+  if (context->table != NULL && !context->stopped) {
+    entry.score = best;
+    entry.depth = depth;
+    entry.best_move = best_move;
+    if (best <= original_alpha) {
+      entry.bound = UPPER_BOUND;
+    } else if (best >= beta) {
+      entry.bound = LOWER_BOUND;
+    } else {
+      entry.bound = EXACT_BOUND;
+    }
+    storeTranspositionEntry(context->table, key, entry);
+  }
+  return best;
+}
+
+SearchResult searchBestMove(const Position* position, SearchLimits limits,
+                            TranspositionTable* table,
+                            const Tablebase* tablebase) {
+  SearchResult Result;
+  Result.best_move = -1;
+  Result.score = 0;
+  Result.depth = 0;
+  Result.nodes = 0;
+
+  int shared_stop = 0;
+  SearchContext Context;
+  Context.table = table;
+  Context.tablebase = tablebase;
+  Context.nodes = 0;
+  Context.shared_stop = &shared_stop;
+  Context.external_stop = limits.stop;
+  Context.stopped = FALSE;
+  Context.report = limits.report;
+  Context.report_data = limits.report_data;
+  Context.evaluate = limits.evaluation != NULL;
+  if (Context.evaluate) {
+    Context.evaluations[position->move_counter] = *limits.evaluation;
+  }
+  int64_t start_ns = currentTimeNs();
+  Context.start_ns = start_ns;
+  Context.deadline_ns =
+      limits.time_ms > 0 ? start_ns + (int64_t)limits.time_ms * 1000000 : 0;
+
+  if (table != NULL) {
+    ageTranspositionTable(table);
+  }
+
+  unsigned moves = findLegalMoves(position);
+  if (moves != 0) {
+    Result.best_move = popLegalMove(&moves);
+  }
+  int i;
+
+  // Every depth past the number of empty cells would search the same tree.
+  int max_depth = BOARD_CELLS - position->move_counter;
+  if (limits.depth < max_depth) {
+    max_depth = limits.depth;
+  }
+
+  // Helpers only pay off when they can share what they find.
+  int helper_count = 0;
+  SearchThread* helpers = NULL;
+  if (limits.threads > 1 && table != NULL && Result.best_move != -1) {
+    if (limits.threads > MAX_SEARCH_THREADS) {
+      limits.threads = MAX_SEARCH_THREADS;
+    }
+    helpers = malloc((limits.threads - 1) * sizeof(SearchThread));
+  }
+  for (i = 0; helpers != NULL && i < limits.threads - 1; ++i) {
+    SearchThread* helper = &helpers[helper_count];
+    helper->context = Context;
+    helper->context.report = NULL;
+    helper->position = position;
+    // Every other helper starts one depth ahead so the threads spread over
+    // different depths instead of all racing through the same tree.
+    helper->first_depth = 1 + (i + 1) % 2;
+    helper->max_depth = max_depth;
+    helper->result = Result;
+    if (pthread_create(&helper->thread, NULL, helperThread, helper) != 0) {
+      break;
+    }
+    helper_count++;
+  }
+
+  if (Result.best_move != -1) {
+    iterativeDeepening(&Context, position, 1, max_depth, &Result);
+  }
+
+  __atomic_store_n(&shared_stop, 1, __ATOMIC_RELAXED);
+  Result.nodes = Context.nodes;
+  for (i = 0; i < helper_count; ++i) {
+    pthread_join(helpers[i].thread, NULL);
+    Result.nodes += helpers[i].context.nodes;
+  }
+  free(helpers);
+
+  Result.elapsed_ns = currentTimeNs() - start_ns;
+  return Result;
+}
+
+static int searchRoot(SearchContext* context, const Position* position,
+                      int depth, int first_move, int* out_best_move) {
+  int alpha = -INFINITE_SCORE;
+  *out_best_move = first_move;
+  unsigned moves = findLegalMoves(position);
+  unsigned first_bit = 1u << findColumnOrderIndex(first_move);
+  while (moves != 0) {
+    int col;
+    if ((moves & first_bit) != 0) {
+      col = first_move;
+      moves &= ~first_bit;
+    } else {
+      col = popLegalMove(&moves);
+    }
+
+    int score;
+    if (isWinningMove(position, col)) {
+      score = WIN_SCORE - (position->move_counter + 1);
+    } else {
+      Position child = *position;
+      addSearchToken(context, position, col);
+      playMove(&child, col);
+      score = -negamax(context, &child, depth - 1, -INFINITE_SCORE, -alpha);
+    }
+    if (context->stopped) {
+      break;
+    }
+    if (score > alpha) {
+      alpha = score;
+      *out_best_move = col;
+    }
+  }
+  return alpha;
+}
+
+static boolean timeIsUp(SearchContext* context) {
+  if (context->stopped) {
+    return TRUE;
+  }
+  if (context->nodes % TIME_CHECK_NODES == 0 &&
+      (__atomic_load_n(context->shared_stop, __ATOMIC_RELAXED) ||
+       (context->external_stop != NULL &&
+        __atomic_load_n(context->external_stop, __ATOMIC_RELAXED)) ||
+       (context->deadline_ns != 0 &&
+        currentTimeNs() >= context->deadline_ns))) {
+    context->stopped = TRUE;
+  }
+  return context->stopped;
+}
@@ -0,0 +1,76 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "eval.h"
+#include "tablebase.h"
+#include "transposition.h"
+
+/*** Define ***/
+
+// A win is scored as WIN_SCORE minus the number of tokens on the board once the
+// winning token is dropped, so quicker wins score higher. Draws score 0.
+#define INFINITE_SCORE 32000
+#define MAX_SEARCH_THREADS 256
+#define WIN_SCORE 10000
+
+/*** Structures ***/
+
+typedef struct SearchResult {
+  // best_move is the column to drop the token in, -1 if the board is full.
+  int best_move;
+  int score;
+  // depth is the last depth the iterative deepening completed.
+  int depth;
+  // nodes is the total over all search threads.
+  uint64_t nodes;
+  int64_t elapsed_ns;
+} SearchResult;
+
+typedef struct SearchLimits {
+  // depth is the maximum number of plies searched.
+  int depth;
+  // time_ms is the budget for the whole search, 0 for no budget.
+  int time_ms;
+  // threads is the number of threads searching the position together.
+  int threads;
+  // stop, if not NULL, is set to 1 by another thread to end the search early.
+  // The last complete depth is returned as if the time budget ran out.
+  int* stop;
+  // report, if not NULL, is called on the searching thread with the result of
+  // every completed depth. Its nodes and elapsed_ns are the main thread's so
+  // far.
+  void (*report)(const SearchResult* result, void* report_data);
+  void* report_data;
+  // evaluation, if not NULL, is the evaluation of the position searched. The
+  // positions at the depth limit are then scored with evaluatePosition instead
+  // of as draws.
+  const Evaluation* evaluation;
+} SearchLimits;
+
+/*** Declorations ***/
+
+// createSearchLimits returns limits of depth plies and time_ms milliseconds
+// on one thread, with no stop flag, no report and no evaluation.
+SearchLimits createSearchLimits(int depth, int time_ms);
+
+// currentTimeNs returns a monotonic time stamp in nanoseconds.
+int64_t currentTimeNs();
+
+// searchBestMove runs an iterative deepening negamax alpha-beta search from
+// the position for the player to move and returns the best column found within
+// the limits. table may be NULL to search without a transposition table. With
+// more than one thread the helpers run their own iterative deepening on the
+// shared table (lazy SMP), which fills it with results the main thread then
+// finds, and the main thread's result is returned. tablebase may be NULL,
+// otherwise the positions it holds are not searched past their result.
+SearchResult searchBestMove(const Position* position, SearchLimits limits,
+                            TranspositionTable* table,
+                            const Tablebase* tablebase);
+
+#endif
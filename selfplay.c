@@ -0,0 +1,239 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "selfplay.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eval.h"
+#include "search.h"
+#include "transposition.h"
+
+/*** Structures ***/
+
+typedef struct SelfPlayWorker {
+  pthread_t thread;
+  const SelfPlayOptions* options;
+  // next_game is shared by all workers, each takes the next unplayed game.
+  int* next_game;
+  TranspositionTable table;
+  uint64_t random_state;
+  SelfPlayStats stats;
+} SelfPlayWorker;
+
+/*** Declorations ***/
+
+// chooseAgentMove returns the column the agent plays in the position, whose
+// static evaluation is evaluation.
+static int chooseAgentMove(SelfPlayWorker* worker, const Agent* agent,
+                           const Position* position,
+                           const Evaluation* evaluation);
+
+// chooseRandomMove returns a random open column of the position.
+static int chooseRandomMove(SelfPlayWorker* worker, const Position* position);
+
+// playSelfPlayGame plays one game between the agents and adds its result to
+// the worker's stats.
+static void playSelfPlayGame(SelfPlayWorker* worker);
+
+// selfPlayThread plays games until all of them have been taken.
+static void* selfPlayThread(void* self_play_worker);
+
+/*** Functions ***/
+
+static int chooseAgentMove(SelfPlayWorker* worker, const Agent* agent,
+                           const Position* position,
+                           const Evaluation* evaluation) {
+  int col;
+  switch (agent->kind) {
+  case GREEDY_AGENT:
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      if (canPlay(position, col) && isWinningMove(position, col)) {
+        return col;
+      }
+    }
+    // Counting one more move hands the turn to the opponent, which shows the
+    // columns the opponent would win in.
+    Position opponent = *position;
+    opponent.move_counter++;
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      if (canPlay(position, col) && isWinningMove(&opponent, col)) {
+        return col;
+      }
+    }
+    return chooseRandomMove(worker, position);
+
+  case SEARCH_AGENT: {
+    SearchLimits limits = createSearchLimits(agent->depth, 0);
+    return searchBestMove(position, limits, &worker->table, NULL).best_move;
+  }
+
+  case EVAL_AGENT: {
+    SearchLimits limits = createSearchLimits(agent->depth, 0);
+    limits.evaluation = evaluation;
+    return searchBestMove(position, limits, &worker->table, NULL).best_move;
+  }
+
+  default:
+    return chooseRandomMove(worker, position);
+  }
+}
+
+static int chooseRandomMove(SelfPlayWorker* worker, const Position* position) {
+  unsigned moves = findLegalMoves(position);
+  int skip = nextRandom(&worker->random_state) % __builtin_popcount(moves);
+  while (skip-- > 0) {
+    moves &= moves - 1;
+  }
+  return popLegalMove(&moves);
+}
+
+uint64_t nextRandom(uint64_t* state) {
+  // xorshift64*
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545f4914f6cdd1dULL;
+}
+
+int parseAgent(const char* text, Agent* out_agent) {
+  out_agent->depth = 0;
+  if (strcmp(text, "random") == 0) {
+    out_agent->kind = RANDOM_AGENT;
+    return 0;
+  }
+  if (strcmp(text, "greedy") == 0) {
+    out_agent->kind = GREEDY_AGENT;
+    return 0;
+  }
+  if (strncmp(text, "search:", 7) == 0) {
+    out_agent->kind = SEARCH_AGENT;
+    out_agent->depth = atoi(text + 7);
+    return out_agent->depth > 0 ? 0 : -1;
+  }
+  if (strncmp(text, "eval:", 5) == 0) {
+    out_agent->kind = EVAL_AGENT;
+    out_agent->depth = atoi(text + 5);
+    return out_agent->depth > 0 ? 0 : -1;
+  }
+  return -1;
+}
+
+static void playSelfPlayGame(SelfPlayWorker* worker) {
+  Position position = createPosition();
+  Evaluation evaluation = createEvaluation(&position);
+  GameRecord record;
+  record.length = 0;
+  int winner = EMPTY;
+  while (position.move_counter < BOARD_CELLS) {
+    int col;
+    if (position.move_counter < worker->options->random_plies) {
+      col = chooseRandomMove(worker, &position);
+    } else {
+      col = chooseAgentMove(
+          worker, &worker->options->agents[currentPlayer(&position)],
+          &position, &evaluation);
+    }
+
+    if (isWinningMove(&position, col)) {
+      winner = currentPlayer(&position);
+    }
+    addEvaluationToken(&evaluation, &position, col);
+    playMove(&position, col);
+    addRecordMove(&record, col);
+    if (winner != EMPTY) {
+      break;
+    }
+  }
+  // A failed write shows when the log is closed.
+  if (worker->options->log != NULL) {
+    appendGameRecord(worker->options->log, &record);
+  }
+
+  worker->stats.games++;
+  worker->stats.total_moves += position.move_counter;
+  if (winner == EMPTY) {
+    worker->stats.draws++;
+  } else {
+    worker->stats.wins[winner]++;
+  }
+}
+
+void printSelfPlayStats(const SelfPlayOptions* options,
+                        const SelfPlayStats* stats) {
+  double games = stats->games > 0 ? stats->games : 1;
+  double seconds = stats->elapsed_ns / 1e9;
+  printf("games %llu threads %d\n", (unsigned long long)stats->games,
+         options->threads);
+  printf("red_wins %llu (%.2f%%)\n", (unsigned long long)stats->wins[RED],
+         100.0 * stats->wins[RED] / games);
+  printf("yellow_wins %llu (%.2f%%)\n",
+         (unsigned long long)stats->wins[YELLOW],
+         100.0 * stats->wins[YELLOW] / games);
+  printf("draws %llu (%.2f%%)\n", (unsigned long long)stats->draws,
+         100.0 * stats->draws / games);
+  printf("average_length %.2f\n", stats->total_moves / games);
+  printf("time_s %.3f games_per_s %.1f\n", seconds,
+         seconds > 0 ? stats->games / seconds : 0);
+}
+
+int runSelfPlay(const SelfPlayOptions* options, SelfPlayStats* out_stats) {
+  memset(out_stats, 0, sizeof(*out_stats));
+  SelfPlayWorker* workers = calloc(options->threads, sizeof(SelfPlayWorker));
+  if (workers == NULL) {
+    return -1;
+  }
+
+  int table_megabytes = options->hash_megabytes / options->threads;
+  if (table_megabytes < 1) {
+    table_megabytes = 1;
+  }
+
+  int next_game = 0;
+  int64_t start_ns = currentTimeNs();
+  int started = 0;
+  int i;
+  for (i = 0; i < options->threads; ++i) {
+    SelfPlayWorker* worker = &workers[i];
+    worker->options = options;
+    worker->next_game = &next_game;
+    // The seed is mixed per thread, xorshift must never start from 0.
+    worker->random_state =
+        (options->seed + (uint64_t)(i + 1) * 0x9e3779b97f4a7c15ULL) | 1;
+    if (createTranspositionTable(&worker->table, table_megabytes) == -1) {
+      break;
+    }
+    if (pthread_create(&worker->thread, NULL, selfPlayThread, worker) != 0) {
+      destroyTranspositionTable(&worker->table);
+      break;
+    }
+    started++;
+  }
+
+  for (i = 0; i < started; ++i) {
+    pthread_join(workers[i].thread, NULL);
+    destroyTranspositionTable(&workers[i].table);
+    out_stats->games += workers[i].stats.games;
+    out_stats->wins[RED] += workers[i].stats.wins[RED];
+    out_stats->wins[YELLOW] += workers[i].stats.wins[YELLOW];
+    out_stats->draws += workers[i].stats.draws;
+    out_stats->total_moves += workers[i].stats.total_moves;
+  }
+  out_stats->elapsed_ns = currentTimeNs() - start_ns;
+  free(workers);
+
+  // The remaining threads still play every game if some fail to start.
+  return started > 0 ? 0 : -1;
+}
+
+static void* selfPlayThread(void* self_play_worker) {
+  SelfPlayWorker* worker = self_play_worker;
+  while (__atomic_fetch_add(worker->next_game, 1, __ATOMIC_RELAXED) <
+         worker->options->games) {
+    playSelfPlayGame(worker);
+  }
+  return NULL;
+}
@@ -0,0 +1,72 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "record.h"
+
+/*** Enum ***/
+
+enum agent_kind { RANDOM_AGENT, GREEDY_AGENT, SEARCH_AGENT, EVAL_AGENT };
+
+/*** Structures ***/
+
+// Agent is a computer player. A random agent drops in any open column, a greedy
+// agent takes an immediate win or blocks one and is random otherwise, a
+// search agent runs searchBestMove to depth and an eval agent does the same
+// with the positions at depth scored by the static evaluation.
+typedef struct Agent {
+  int kind;
+  int depth;
+} Agent;
+
+typedef struct SelfPlayOptions {
+  // games is the number of games to play, 0 when self play is not requested.
+  int games;
+  int threads;
+  // agents holds the RED and YELLOW players.
+  Agent agents[2];
+  // random_plies is the number of random moves that open every game, so that
+  // two deterministic agents do not play the same game over and over.
+  int random_plies;
+  // hash_megabytes is shared by the search agents of all threads.
+  int hash_megabytes;
+  uint64_t seed;
+  // log is the game log every game is appended to, NULL for none.
+  GameLog* log;
+} SelfPlayOptions;
+
+typedef struct SelfPlayStats {
+  uint64_t games;
+  // wins is indexed by the token of the winner.
+  uint64_t wins[2];
+  uint64_t draws;
+  uint64_t total_moves;
+  int64_t elapsed_ns;
+} SelfPlayStats;
+
+/*** Declorations ***/
+
+// nextRandom advances the xorshift generator state and returns the next
+// random number.
+uint64_t nextRandom(uint64_t* state);
+
+// parseAgent reads "random", "greedy", "search:D" or "eval:D" into out_agent.
+// Returns -1 if the text is not an agent, 0 otherwise.
+int parseAgent(const char* text, Agent* out_agent);
+
+// printSelfPlayStats prints the win and draw rates, the average game length
+// and the games per second.
+void printSelfPlayStats(const SelfPlayOptions* options,
+                        const SelfPlayStats* stats);
+
+// runSelfPlay plays options->games games between the agents on
+// options->threads threads without any terminal output. Returns -1 if no
+// thread could be started, 0 otherwise.
+int runSelfPlay(const SelfPlayOptions* options, SelfPlayStats* out_stats);
+
+#endif
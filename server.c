@@ -0,0 +1,740 @@
+// Connect Four
+// Author: Scott Helms
+
+// SO_REUSEPORT is not part of POSIX.
+#define _DEFAULT_SOURCE
+
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "search.h"
+#include "slab.h"
+
+/*** Define ***/
+
+#define MAX_SERVER_THREADS 64
+#define SERVER_BACKLOG 4096
+#define SERVER_EVENTS 256
+// A command longer than SERVER_LINE_SIZE closes the connection.
+#define SERVER_LINE_SIZE 256
+// A client that lets more than SERVER_OUTPUT_LIMIT bytes of replies pile up
+// unread is disconnected.
+#define SERVER_OUTPUT_LIMIT (1 << 20)
+#define SERVER_REPLY_SIZE 64
+// A connection starts with room for CONNECTION_GAMES game ids.
+#define CONNECTION_GAMES 4
+// The games share SERVER_GAME_LOCKS locks, game index modulo the count.
+#define SERVER_GAME_LOCKS 1024
+
+/*** Structures ***/
+
+struct ServerThread;
+
+// ServerConnection belongs to the event loop that accepted it, which does all
+// its reads and closes it. Other loops only queue replies on it, under
+// output_lock while they hold the lock of a game it is seated in.
+typedef struct ServerConnection {
+  int fd;
+  struct ServerThread* thread;
+  char input[SERVER_LINE_SIZE];
+  int input_length;
+  pthread_mutex_t output_lock;
+  char* output;
+  size_t output_length;
+  size_t output_capacity;
+  // writing is TRUE while EPOLLOUT is armed for the queued output.
+  boolean writing;
+  boolean overflowed;
+  // game_ids holds the games the connection took a seat in. The ids of games
+  // that ended since are skipped.
+  uint64_t* game_ids;
+  int game_count;
+  int game_capacity;
+  struct ServerConnection* previous;
+  struct ServerConnection* next;
+} ServerConnection;
+
+// ServerGame is a slot of the game pool, one cache line. Its generation
+// changes every time the slot is handed out, so the id of an ended game no
+// longer finds it. The pool links a free slot through the start of its state,
+// generation and in_use keep their values.
+typedef struct ServerGame {
+  GameState state;
+  // seats is indexed by token. Both hold the creator until someone joins.
+  ServerConnection* seats[2];
+  uint32_t generation;
+  boolean in_use;
+} ServerGame;
+
+// GamePool hands out the games from a slab allocated up front, so a new game
+// never calls malloc. A game is guarded by one of game_locks, the slab by
+// lock.
+typedef struct GamePool {
+  SlabPool slab;
+  pthread_mutex_t lock;
+  pthread_mutex_t game_locks[SERVER_GAME_LOCKS];
+} GamePool;
+
+// ServerThread is one event loop. The kernel spreads new connections over the
+// listening sockets of all loops (SO_REUSEPORT).
+typedef struct ServerThread {
+  pthread_t thread;
+  int listen_fd;
+  int epoll_fd;
+  int stop_fd;
+  GamePool* pool;
+  ServerConnection* connections;
+  // stats is only written by the loop and read once it is joined.
+  ServerStats stats;
+} ServerThread;
+
+/*** Declorations ***/
+
+// acceptConnections accepts every pending connection of the loop.
+static void acceptConnections(ServerThread* thread);
+
+// addGameId remembers that the connection took a seat in the game.
+static int addGameId(ServerThread* thread, ServerConnection* connection,
+                     uint64_t id);
+
+// allocateGame takes a free slot of the pool for a new game, seats the
+// connection in both seats and returns its id, 0 if the pool is empty.
+static uint64_t allocateGame(GamePool* pool, ServerConnection* connection);
+
+// closeConnection ends every game the connection is seated in, telling the
+// other seat, and frees the connection.
+static void closeConnection(ServerThread* thread,
+                            ServerConnection* connection);
+
+// createListenSocket returns a non-blocking socket listening on
+// 127.0.0.1:port, -1 on failure.
+static int createListenSocket(int port);
+
+// flushOutput sends as much of the queued output as the socket takes and
+// arms EPOLLOUT for the rest.
+static void flushOutput(ServerConnection* connection);
+
+// findGameLock returns the lock that guards the game.
+static pthread_mutex_t* findGameLock(GamePool* pool, const ServerGame* game);
+
+// freeGame returns the locked game's slot to the pool and unlocks it.
+static void freeGame(GamePool* pool, ServerGame* game);
+
+// handleCommand runs one command line of the connection and queues the
+// reply.
+static void handleCommand(ServerThread* thread, ServerConnection* connection,
+                          const char* line);
+
+// lockGame returns the game with the id, locked, or NULL if it ended.
+static ServerGame* lockGame(GamePool* pool, uint64_t id);
+
+// queueOutput appends the text to the connection's output. Past
+// SERVER_OUTPUT_LIMIT the connection is marked overflowed instead.
+static void queueOutput(ServerConnection* connection, const char* text);
+
+// readConnection reads and runs the connection's commands. Returns -1 if the
+// connection is to be closed, 0 otherwise.
+static int readConnection(ServerThread* thread, ServerConnection* connection);
+
+// sendToSeat queues the text on the connection of another seat and sends it
+// right away.
+static void sendToSeat(ServerConnection* connection, const char* text);
+
+// serverThread runs the event loop of a ServerThread until the stop pipe
+// becomes readable.
+static void* serverThread(void* server_thread);
+
+// unlockGame unlocks a game locked by lockGame.
+static void unlockGame(GamePool* pool, ServerGame* game);
+
+// updateEvents switches EPOLLOUT of the connection on or off.
+static void updateEvents(ServerConnection* connection, boolean writing);
+
+/*** Functions ***/
+
+static void acceptConnections(ServerThread* thread) {
+  while (TRUE) {
+    int fd = accept(thread->listen_fd, NULL, NULL);
+    if (fd == -1) {
+      // EAGAIN once the backlog is empty, anything else is the client's
+      // problem and is retried on the next event.
+      return;
+    }
+
+    int enabled = 1;
+    ServerConnection* connection = calloc(1, sizeof(ServerConnection));
+    uint64_t* game_ids = malloc(CONNECTION_GAMES * sizeof(uint64_t));
+    if (connection == NULL || game_ids == NULL ||
+        fcntl(fd, F_SETFL, O_NONBLOCK) == -1 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled)) ==
+            -1) {
+      free(connection);
+      free(game_ids);
+      close(fd);
+      continue;
+    }
+    connection->fd = fd;
+    connection->thread = thread;
+    connection->game_ids = game_ids;
+    connection->game_capacity = CONNECTION_GAMES;
+    pthread_mutex_init(&connection->output_lock, NULL);
+
+    struct epoll_event Event;
+    Event.events = EPOLLIN;
+    Event.data.ptr = connection;
+    if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, fd, &Event) == -1) {
+      pthread_mutex_destroy(&connection->output_lock);
+      free(game_ids);
+      free(connection);
+      close(fd);
+      continue;
+    }
+
+    connection->next = thread->connections;
+    if (thread->connections != NULL) {
+      thread->connections->previous = connection;
+    }
+    thread->connections = connection;
+    thread->stats.connections++;
+  }
+}
+
+static int addGameId(ServerThread* thread, ServerConnection* connection,
+                     uint64_t id) {
+  if (connection->game_count == connection->game_capacity) {
+    // The ids of ended games are dropped before the list grows.
+    int kept = 0;
+    int i;
+    for (i = 0; i < connection->game_count; ++i) {
+      uint64_t game_id = connection->game_ids[i];
+      ServerGame* game = findSlot(&thread->pool->slab, (uint32_t)game_id);
+      if (__atomic_load_n(&game->in_use, __ATOMIC_RELAXED) &&
+          __atomic_load_n(&game->generation, __ATOMIC_RELAXED) ==
+              game_id >> 32) {
+        connection->game_ids[kept++] = game_id;
+      }
+    }
+    connection->game_count = kept;
+  }
+  if (connection->game_count == connection->game_capacity) {
+    uint64_t* grown = realloc(connection->game_ids,
+                              2 * connection->game_capacity * sizeof(uint64_t));
+    if (grown == NULL) {
+      return -1;
+    }
+    connection->game_ids = grown;
+    connection->game_capacity *= 2;
+  }
+  connection->game_ids[connection->game_count++] = id;
+  return 0;
+}
+
+static uint64_t allocateGame(GamePool* pool, ServerConnection* connection) {
+  pthread_mutex_lock(&pool->lock);
+  ServerGame* game = allocateSlot(&pool->slab);
+  pthread_mutex_unlock(&pool->lock);
+  if (game == NULL) {
+    return 0;
+  }
+
+  pthread_mutex_lock(findGameLock(pool, game));
+  // The slots start zeroed and generation 0 is skipped, so no id is 0.
+  uint32_t generation = game->generation + 1 != 0 ? game->generation + 1 : 1;
+  __atomic_store_n(&game->generation, generation, __ATOMIC_RELAXED);
+  __atomic_store_n(&game->in_use, TRUE, __ATOMIC_RELAXED);
+  game->state = createGameState();
+  game->seats[RED] = connection;
+  game->seats[YELLOW] = connection;
+  uint64_t id = (uint64_t)generation << 32 | findSlotIndex(&pool->slab, game);
+  unlockGame(pool, game);
+  return id;
+}
+
+static void closeConnection(ServerThread* thread,
+                            ServerConnection* connection) {
+  char reply[SERVER_REPLY_SIZE];
+  int i, seat;
+  for (i = 0; i < connection->game_count; ++i) {
+    ServerGame* game = lockGame(thread->pool, connection->game_ids[i]);
+    if (game == NULL) {
+      continue;
+    }
+    ServerConnection* other = NULL;
+    for (seat = RED; seat <= YELLOW; ++seat) {
+      if (game->seats[seat] != connection) {
+        other = game->seats[seat];
+      }
+    }
+    if (other != NULL) {
+      snprintf(reply, sizeof(reply), "LEFT %llu\n",
+               (unsigned long long)connection->game_ids[i]);
+      sendToSeat(other, reply);
+    }
+    freeGame(thread->pool, game);
+  }
+
+  // No game refers to the connection any more, so no other loop can queue
+  // output on it.
+  epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+  close(connection->fd);
+  if (connection->previous != NULL) {
+    connection->previous->next = connection->next;
+  } else {
+    thread->connections = connection->next;
+  }
+  if (connection->next != NULL) {
+    connection->next->previous = connection->previous;
+  }
+  pthread_mutex_destroy(&connection->output_lock);
+  free(connection->output);
+  free(connection->game_ids);
+  free(connection);
+}
+
+static int createListenSocket(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+
+  int enabled = 1;
+  struct sockaddr_in Address;
+  memset(&Address, 0, sizeof(Address));
+  Address.sin_family = AF_INET;
+  Address.sin_port = htons(port);
+  Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled)) ==
+          -1 ||
+      setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) ==
+          -1 ||
+      bind(fd, (struct sockaddr*)&Address, sizeof(Address)) == -1 ||
+      listen(fd, SERVER_BACKLOG) == -1 ||
+      fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void flushOutput(ServerConnection* connection) {
+  pthread_mutex_lock(&connection->output_lock);
+  size_t sent = 0;
+  while (sent < connection->output_length) {
+    ssize_t bytes = send(connection->fd, connection->output + sent,
+                         connection->output_length - sent, MSG_NOSIGNAL);
+    if (bytes <= 0) {
+      // A socket that is gone is noticed by the read side, a full one gets
+      // the rest once EPOLLOUT fires.
+      if (bytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        connection->overflowed = TRUE;
+      }
+      break;
+    }
+    sent += bytes;
+  }
+  memmove(connection->output, connection->output + sent,
+          connection->output_length - sent);
+  connection->output_length -= sent;
+
+  // An overflowed connection wakes its own loop, which closes it.
+  boolean writing = connection->output_length > 0 || connection->overflowed;
+  if (writing != connection->writing) {
+    updateEvents(connection, writing);
+  }
+  pthread_mutex_unlock(&connection->output_lock);
+}
+
+static pthread_mutex_t* findGameLock(GamePool* pool, const ServerGame* game) {
+  return &pool->game_locks[findSlotIndex(&pool->slab, game) %
+                           SERVER_GAME_LOCKS];
+}
+
+static void freeGame(GamePool* pool, ServerGame* game) {
+  __atomic_store_n(&game->in_use, FALSE, __ATOMIC_RELAXED);
+  game->seats[RED] = NULL;
+  game->seats[YELLOW] = NULL;
+  unlockGame(pool, game);
+
+  // Nothing reads the state of a game that is not in use, so the slab may
+  // write its link there without the game lock.
+  pthread_mutex_lock(&pool->lock);
+  freeSlot(&pool->slab, game);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static void handleCommand(ServerThread* thread, ServerConnection* connection,
+                          const char* line) {
+  char reply[SERVER_REPLY_SIZE];
+  char command[8];
+  unsigned long long id = 0;
+  int col = 0;
+  int fields = sscanf(line, "%7s %llu %d", command, &id, &col);
+  if (fields < 1) {
+    queueOutput(connection, "ERR syntax\n");
+    return;
+  }
+
+  if (strcmp(command, "PING") == 0) {
+    queueOutput(connection, "PONG\n");
+    return;
+  }
+
+  if (strcmp(command, "NEW") == 0) {
+    uint64_t new_id = allocateGame(thread->pool, connection);
+    if (new_id == 0) {
+      queueOutput(connection, "ERR full\n");
+      return;
+    }
+    if (addGameId(thread, connection, new_id) == -1) {
+      ServerGame* game = lockGame(thread->pool, new_id);
+      if (game != NULL) {
+        freeGame(thread->pool, game);
+      }
+      queueOutput(connection, "ERR full\n");
+      return;
+    }
+    thread->stats.games++;
+    snprintf(reply, sizeof(reply), "GAME %llu\n", (unsigned long long)new_id);
+    queueOutput(connection, reply);
+    return;
+  }
+
+  boolean is_join = strcmp(command, "JOIN") == 0;
+  boolean is_move = strcmp(command, "MOVE") == 0;
+  boolean is_quit = strcmp(command, "QUIT") == 0;
+  if ((!is_join && !is_move && !is_quit) || fields < (is_move ? 3 : 2)) {
+    queueOutput(connection, "ERR syntax\n");
+    return;
+  }
+  ServerGame* game = lockGame(thread->pool, id);
+  if (game == NULL) {
+    queueOutput(connection, "ERR unknown game\n");
+    return;
+  }
+
+  if (is_join) {
+    if (game->seats[RED] != game->seats[YELLOW] ||
+        game->seats[RED] == connection ||
+        addGameId(thread, connection, id) == -1) {
+      unlockGame(thread->pool, game);
+      queueOutput(connection, "ERR seats taken\n");
+      return;
+    }
+    game->seats[YELLOW] = connection;
+    snprintf(reply, sizeof(reply), "JOINED %llu\n", id);
+    sendToSeat(game->seats[RED], reply);
+    unlockGame(thread->pool, game);
+    queueOutput(connection, reply);
+    return;
+  }
+
+  if (game->seats[RED] != connection && game->seats[YELLOW] != connection) {
+    unlockGame(thread->pool, game);
+    queueOutput(connection, "ERR not seated\n");
+    return;
+  }
+  ServerConnection* other = game->seats[RED] == connection
+                                ? game->seats[YELLOW]
+                                : game->seats[RED];
+  if (other == connection) {
+    other = NULL;
+  }
+
+  if (is_quit) {
+    if (other != NULL) {
+      snprintf(reply, sizeof(reply), "LEFT %llu\n", id);
+      sendToSeat(other, reply);
+    }
+    freeGame(thread->pool, game);
+    snprintf(reply, sizeof(reply), "BYE %llu\n", id);
+    queueOutput(connection, reply);
+    return;
+  }
+
+  // The move logic is the bitboard the terminal game's dropToken runs on.
+  Position* position = &game->state.position;
+  if (game->seats[currentPlayer(position)] != connection) {
+    unlockGame(thread->pool, game);
+    queueOutput(connection, "ERR not your turn\n");
+    return;
+  }
+  if (col < 1 || col > BOARD_WIDTH || !canPlay(position, col - 1)) {
+    unlockGame(thread->pool, game);
+    queueOutput(connection, "ERR illegal move\n");
+    return;
+  }
+  boolean won = isWinningMove(position, col - 1);
+  playGameMove(&game->state, col - 1);
+  thread->stats.moves++;
+  const char* state =
+      won ? "WIN" : position->move_counter == BOARD_CELLS ? "DRAW" : "PLAY";
+
+  if (other != NULL) {
+    snprintf(reply, sizeof(reply), "MOVE %llu %d %s\n", id, col, state);
+    sendToSeat(other, reply);
+  }
+  if (strcmp(state, "PLAY") != 0) {
+    freeGame(thread->pool, game);
+  } else {
+    unlockGame(thread->pool, game);
+  }
+  snprintf(reply, sizeof(reply), "OK %llu %d %s\n", id, col, state);
+  queueOutput(connection, reply);
+}
+
+static ServerGame* lockGame(GamePool* pool, uint64_t id) {
+  uint32_t index = (uint32_t)id;
+  if (index >= pool->slab.capacity) {
+    return NULL;
+  }
+  ServerGame* game = findSlot(&pool->slab, index);
+  pthread_mutex_lock(findGameLock(pool, game));
+  if (!game->in_use || game->generation != id >> 32) {
+    unlockGame(pool, game);
+    return NULL;
+  }
+  return game;
+}
+
+static void queueOutput(ServerConnection* connection, const char* text) {
+  size_t length = strlen(text);
+  pthread_mutex_lock(&connection->output_lock);
+  size_t needed = connection->output_length + length;
+  if (needed > SERVER_OUTPUT_LIMIT) {
+    connection->overflowed = TRUE;
+  } else {
+    if (needed > connection->output_capacity) {
+      size_t capacity = connection->output_capacity > 0
+                            ? 2 * connection->output_capacity
+                            : SERVER_LINE_SIZE;
+      while (capacity < needed) {
+        capacity *= 2;
+      }
+      char* grown = realloc(connection->output, capacity);
+      if (grown == NULL) {
+        connection->overflowed = TRUE;
+        pthread_mutex_unlock(&connection->output_lock);
+        return;
+      }
+      connection->output = grown;
+      connection->output_capacity = capacity;
+    }
+    memcpy(connection->output + connection->output_length, text, length);
+    connection->output_length = needed;
+  }
+  pthread_mutex_unlock(&connection->output_lock);
+}
+
+static int readConnection(ServerThread* thread, ServerConnection* connection) {
+  ssize_t bytes = recv(connection->fd, connection->input +
+                                           connection->input_length,
+                       SERVER_LINE_SIZE - connection->input_length, 0);
+  if (bytes == 0 ||
+      (bytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    return -1;
+  }
+  if (bytes == -1) {
+    return 0;
+  }
+  connection->input_length += bytes;
+
+  // Every complete line is a command. The replies to all of them go out with
+  // one send.
+  int start = 0;
+  int i;
+  for (i = 0; i < connection->input_length; ++i) {
+    if (connection->input[i] == '\n') {
+      connection->input[i] = '\0';
+      handleCommand(thread, connection, connection->input + start);
+      start = i + 1;
+    }
+  }
+  memmove(connection->input, connection->input + start,
+          connection->input_length - start);
+  connection->input_length -= start;
+  flushOutput(connection);
+
+  if (connection->input_length == SERVER_LINE_SIZE) {
+    return -1;
+  }
+  return 0;
+}
+
+void raiseDescriptorLimit() {
+  struct rlimit Limit;
+  if (getrlimit(RLIMIT_NOFILE, &Limit) == 0 &&
+      Limit.rlim_cur < Limit.rlim_max) {
+    Limit.rlim_cur = Limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &Limit);
+  }
+}
+
+int runServer(const ServerOptions* options, ServerStats* out_stats) {
+  memset(out_stats, 0, sizeof(*out_stats));
+  int threads = options->threads < MAX_SERVER_THREADS ? options->threads
+                                                      : MAX_SERVER_THREADS;
+
+  // Every connection is a descriptor.
+  raiseDescriptorLimit();
+
+  static GamePool Pool;
+  if (createSlabPool(&Pool.slab, sizeof(ServerGame), options->max_games) ==
+      -1) {
+    return -1;
+  }
+  int i;
+  for (i = 0; i < SERVER_GAME_LOCKS; ++i) {
+    pthread_mutex_init(&Pool.game_locks[i], NULL);
+  }
+  pthread_mutex_init(&Pool.lock, NULL);
+
+  // The loops inherit the blocked signals, so only sigwait sees them.
+  sigset_t signals, old_signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+
+  // Writing to stop_pipe stops every loop. It is never read, so it stays
+  // readable for all of them.
+  int stop_pipe[2] = {-1, -1};
+  ServerThread* loops = calloc(threads, sizeof(ServerThread));
+  int started = 0;
+  boolean failed = loops == NULL || pipe(stop_pipe) == -1;
+  for (i = 0; i < threads && !failed; ++i) {
+    ServerThread* thread = &loops[i];
+    thread->pool = &Pool;
+    thread->stop_fd = stop_pipe[0];
+    thread->listen_fd = createListenSocket(options->port);
+    thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    struct epoll_event Listen, Stop;
+    Listen.events = EPOLLIN;
+    Listen.data.ptr = NULL;
+    Stop.events = EPOLLIN;
+    Stop.data.ptr = thread;
+    failed = thread->listen_fd == -1 || thread->epoll_fd == -1 ||
+             epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, thread->listen_fd,
+                       &Listen) == -1 ||
+             epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, stop_pipe[0], &Stop) ==
+                 -1 ||
+             pthread_create(&thread->thread, NULL, serverThread, thread) != 0;
+    if (failed) {
+      if (thread->listen_fd != -1) {
+        close(thread->listen_fd);
+      }
+      if (thread->epoll_fd != -1) {
+        close(thread->epoll_fd);
+      }
+      break;
+    }
+    started++;
+  }
+
+  int64_t start_ns = currentTimeNs();
+  if (!failed) {
+    printf("listening 127.0.0.1:%d threads %d max_games %d\n", options->port,
+           threads, options->max_games);
+    fflush(stdout);
+    int signal_number;
+    sigwait(&signals, &signal_number);
+  }
+
+  if (stop_pipe[1] != -1 && write(stop_pipe[1], "", 1) != 1) {
+    failed = TRUE;
+  }
+  for (i = 0; i < started; ++i) {
+    pthread_join(loops[i].thread, NULL);
+    close(loops[i].listen_fd);
+    close(loops[i].epoll_fd);
+    out_stats->connections += loops[i].stats.connections;
+    out_stats->games += loops[i].stats.games;
+    out_stats->moves += loops[i].stats.moves;
+  }
+  out_stats->elapsed_ns = currentTimeNs() - start_ns;
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+  if (stop_pipe[0] != -1) {
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+  }
+  free(loops);
+  for (i = 0; i < SERVER_GAME_LOCKS; ++i) {
+    pthread_mutex_destroy(&Pool.game_locks[i]);
+  }
+  pthread_mutex_destroy(&Pool.lock);
+  destroySlabPool(&Pool.slab);
+  return failed ? -1 : 0;
+}
+
+static void sendToSeat(ServerConnection* connection, const char* text) {
+  queueOutput(connection, text);
+  flushOutput(connection);
+}
+
+static void* serverThread(void* server_thread) {
+  ServerThread* thread = server_thread;
+  struct epoll_event events[SERVER_EVENTS];
+  boolean running = TRUE;
+  while (running) {
+    int count = epoll_wait(thread->epoll_fd, events, SERVER_EVENTS, -1);
+    int i;
+    for (i = 0; i < count; ++i) {
+      if (events[i].data.ptr == NULL) {
+        acceptConnections(thread);
+        continue;
+      }
+      if (events[i].data.ptr == thread) {
+        running = FALSE;
+        continue;
+      }
+
+      ServerConnection* connection = events[i].data.ptr;
+      boolean closing = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+      if (!closing && (events[i].events & EPOLLIN)) {
+        closing = readConnection(thread, connection) == -1;
+      }
+      if (!closing && (events[i].events & EPOLLOUT)) {
+        flushOutput(connection);
+      }
+      pthread_mutex_lock(&connection->output_lock);
+      closing = closing || connection->overflowed;
+      pthread_mutex_unlock(&connection->output_lock);
+      if (closing) {
+        closeConnection(thread, connection);
+      }
+    }
+  }
+
+  while (thread->connections != NULL) {
+    closeConnection(thread, thread->connections);
+  }
+  return NULL;
+}
+
+static void unlockGame(GamePool* pool, ServerGame* game) {
+  pthread_mutex_unlock(findGameLock(pool, game));
+}
+
+static void updateEvents(ServerConnection* connection, boolean writing) {
+  struct epoll_event Event;
+  Event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  Event.data.ptr = connection;
+  epoll_ctl(connection->thread->epoll_fd, EPOLL_CTL_MOD, connection->fd,
+            &Event);
+  connection->writing = writing;
+}
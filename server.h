@@ -0,0 +1,55 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+
+#include "bitboard.h"
+
+// The server speaks a line based text protocol. Every command is one line and
+// gets one reply line, columns count from 1 like --search MOVES:
+//
+//   NEW               -> GAME <id>          the connection holds both seats
+//   JOIN <id>         -> JOINED <id>        takes the YELLOW seat, the creator
+//                                           is sent JOINED <id> as well
+//   MOVE <id> <col>   -> OK <id> <col> <state>
+//                                           state is PLAY, WIN or DRAW, the
+//                                           other seat is sent
+//                                           MOVE <id> <col> <state>
+//   QUIT <id>         -> BYE <id>           the other seat is sent LEFT <id>
+//   PING              -> PONG
+//
+// A failed command is answered with ERR <reason>. A game ends with a WIN, a
+// DRAW, a QUIT or when either seat disconnects, and its id is invalid after.
+
+/*** Structures ***/
+
+typedef struct ServerOptions {
+  int port;
+  // threads is the number of event loops, each with its own epoll instance
+  // and listening socket.
+  int threads;
+  // max_games is the size of the game pool, allocated up front.
+  int max_games;
+} ServerOptions;
+
+typedef struct ServerStats {
+  uint64_t connections;
+  uint64_t games;
+  uint64_t moves;
+  int64_t elapsed_ns;
+} ServerStats;
+
+/*** Declorations ***/
+
+// raiseDescriptorLimit raises the soft limit on open descriptors to the hard
+// limit, every connection being one.
+void raiseDescriptorLimit();
+
+// runServer serves games on 127.0.0.1:options->port until SIGINT or SIGTERM.
+// Returns -1 if the server cannot start, 0 otherwise.
+int runServer(const ServerOptions* options, ServerStats* out_stats);
+
+#endif
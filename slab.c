@@ -0,0 +1,67 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*** Functions ***/
+
+void* allocateSlot(SlabPool* pool) {
+  void* slot = pool->free_list;
+  if (slot != NULL) {
+    memcpy(&pool->free_list, slot, sizeof(void*));
+  } else if (pool->fresh_count < pool->capacity) {
+    // Taking the untouched slots in order is what lets a reset skip
+    // rebuilding the free list.
+    slot = findSlot(pool, pool->fresh_count++);
+  } else {
+    return NULL;
+  }
+  pool->used_count++;
+  return slot;
+}
+
+int createSlabPool(SlabPool* pool, size_t slot_size, uint32_t capacity) {
+  size_t size = sizeof(void*);
+  while (size < slot_size && size < CACHE_LINE_SIZE) {
+    size *= 2;
+  }
+  if (slot_size > CACHE_LINE_SIZE) {
+    size = (slot_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE *
+           CACHE_LINE_SIZE;
+  }
+
+  void* memory;
+  if (capacity == 0 ||
+      posix_memalign(&memory, CACHE_LINE_SIZE, size * capacity) != 0) {
+    return -1;
+  }
+  memset(memory, 0, size * capacity);
+  pool->memory = memory;
+  pool->slot_size = size;
+  pool->capacity = capacity;
+  pool->fresh_count = 0;
+  pool->used_count = 0;
+  pool->free_list = NULL;
+  return 0;
+}
+
+void destroySlabPool(SlabPool* pool) {
+  free(pool->memory);
+  pool->memory = NULL;
+  pool->capacity = 0;
+}
+
+void freeSlot(SlabPool* pool, void* slot) {
+  memcpy(slot, &pool->free_list, sizeof(void*));
+  pool->free_list = slot;
+  pool->used_count--;
+}
+
+void resetSlabPool(SlabPool* pool) {
+  pool->fresh_count = 0;
+  pool->used_count = 0;
+  pool->free_list = NULL;
+}
@@ -0,0 +1,62 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*** Define ***/
+
+#define CACHE_LINE_SIZE 64
+
+/*** Structures ***/
+
+// SlabPool hands out slots of one size from a single block allocated up
+// front. The block starts on a cache line and a slot is a power of two up to
+// CACHE_LINE_SIZE bytes or a whole number of cache lines, so no slot shares a
+// cache line with part of another. Allocating, freeing and resetting take
+// constant time and never call malloc. A pool is not thread safe.
+typedef struct SlabPool {
+  char* memory;
+  size_t slot_size;
+  uint32_t capacity;
+  // fresh_count is the number of slots handed out since the last reset, the
+  // slots after them have not been touched.
+  uint32_t fresh_count;
+  uint32_t used_count;
+  // free_list links the freed slots through their first pointer sized bytes.
+  // The rest of a freed slot keeps what it held.
+  void* free_list;
+} SlabPool;
+
+/*** Declorations ***/
+
+// allocateSlot returns a slot of the pool, NULL if all of them are in use.
+void* allocateSlot(SlabPool* pool);
+
+// createSlabPool allocates capacity zeroed slots of at least slot_size bytes.
+// Returns -1 if the memory cannot be allocated, 0 otherwise.
+int createSlabPool(SlabPool* pool, size_t slot_size, uint32_t capacity);
+
+// destroySlabPool frees the memory of the pool.
+void destroySlabPool(SlabPool* pool);
+
+// freeSlot returns a slot of the pool.
+void freeSlot(SlabPool* pool, void* slot);
+
+// resetSlabPool frees every slot at once.
+void resetSlabPool(SlabPool* pool);
+
+// findSlot returns the slot with the index, allocated or not.
+static inline void* findSlot(const SlabPool* pool, uint32_t index) {
+  return pool->memory + (size_t)index * pool->slot_size;
+}
+
+// findSlotIndex returns the index of a slot of the pool.
+static inline uint32_t findSlotIndex(const SlabPool* pool, const void* slot) {
+  return ((const char*)slot - pool->memory) / pool->slot_size;
+}
+
+#endif
@@ -0,0 +1,284 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "solver.h"
+
+#include "search.h"
+
+/*** Structures ***/
+
+typedef struct SolverContext {
+  TranspositionTable* table;
+  uint64_t nodes;
+} SolverContext;
+
+/*** Declorations ***/
+
+// findColumnMask returns a mask with every cell of the column set.
+static bitboard findColumnMask(int col);
+
+// findNonLosingMoves returns a mask of the playable cells that do not let the
+// opponent connect four with their next token. The player to move must not be
+// able to win with this token.
+static bitboard findNonLosingMoves(const Position* position);
+
+// findSolvedMove returns a column that keeps the exact score of the position,
+// -1 if the game is over.
+static int findSolvedMove(SolverContext* context, const Position* position,
+                          int score);
+
+// orderMoves fills columns with the columns of the moves in the mask, the ones
+// that leave the most cells to win in first, and the center first among
+// equals. hash_move goes before all of them. Returns the number of columns.
+static int orderMoves(const Position* position, bitboard moves, int hash_move,
+                      int columns[BOARD_WIDTH]);
+
+// solveNegamax returns the exact score of the position if it is within the
+// alpha beta window, otherwise a bound on the far side of the window.
+static int solveNegamax(SolverContext* context, const Position* position,
+                        int alpha, int beta);
+
+/*** Functions ***/
+
+static bitboard findColumnMask(int col) {
+  return (((bitboard)1 << BOARD_HEIGHT) - 1) << (col * COLUMN_BITS);
+}
+
+static bitboard findNonLosingMoves(const Position* position) {
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  bitboard playable = findPlayableCells(position);
+  bitboard opponent_wins = findWinningCells(
+      position->player_masks[currentPlayer(position) ^ 1], mask);
+
+  // A cell the opponent would win in has to be taken. With two of them one is
+  // left for the opponent whatever is played.
+  bitboard forced = playable & opponent_wins;
+  if (forced != 0) {
+    if (forced & (forced - 1)) {
+      return 0;
+    }
+    playable = forced;
+  }
+  // Playing right under a cell the opponent would win in hands it over.
+  return playable & ~(opponent_wins >> 1);
+}
+
+int findSolveDistance(const Position* position, int score) {
+  if (score > 0) {
+    return WIN_SCORE - score - position->move_counter;
+  }
+  if (score < 0) {
+    return WIN_SCORE + score - position->move_counter;
+  }
+  return BOARD_CELLS - position->move_counter;
+}
+
+static int findSolvedMove(SolverContext* context, const Position* position,
+                          int score) {
+  int i, col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    if (canPlay(position, col) && isWinningMove(position, col)) {
+      return col;
+    }
+  }
+
+  int columns[BOARD_WIDTH];
+  int count = orderMoves(position, findNonLosingMoves(position), NO_MOVE,
+                         columns);
+  for (i = 0; i < count; ++i) {
+    Position child = *position;
+    playMove(&child, columns[i]);
+    // The move keeps the score when the child is worth no more than -score to
+    // the opponent.
+    if (solveNegamax(context, &child, -score, -score + 1) <= -score) {
+      return columns[i];
+    }
+  }
+
+  // Every move loses at once, any of them is as good as the others.
+  unsigned moves = findLegalMoves(position);
+  return moves != 0 ? popLegalMove(&moves) : -1;
+}
+
+static int orderMoves(const Position* position, bitboard moves, int hash_move,
+                      int columns[BOARD_WIDTH]) {
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  bitboard player_mask = position->player_masks[currentPlayer(position)];
+  int threats[BOARD_WIDTH];
+  int count = 0;
+  int i, j;
+  for (i = 0; i < BOARD_WIDTH; ++i) {
+    int col = columnOrder(i);
+    bitboard move = moves & findColumnMask(col);
+    if (move == 0) {
+      continue;
+    }
+
+    int threat_count =
+        col == hash_move
+            ? BOARD_CELLS
+            : __builtin_popcountll(
+                  findWinningCells(player_mask | move, mask | move));
+    // Insertion sort, the few columns are already in center first order.
+    for (j = count; j > 0 && threats[j - 1] < threat_count; --j) {
+      threats[j] = threats[j - 1];
+      columns[j] = columns[j - 1];
+    }
+    threats[j] = threat_count;
+    columns[j] = col;
+    count++;
+  }
+  return count;
+}
+
+void solvePosition(const Position* position, TranspositionTable* table,
+                   SolveResult* out_result) {
+  SolverContext Context;
+  Context.table = table;
+  Context.nodes = 0;
+  int64_t start_ns = currentTimeNs();
+  ageTranspositionTable(table);
+
+  // Scores outside min and max are out of reach, the player to move loses no
+  // sooner than the opponent's next token and wins no later than the last.
+  int min = -(WIN_SCORE - (position->move_counter + 2));
+  int max = WIN_SCORE - (position->move_counter + 1);
+  while (min < max) {
+    int med;
+    if (min < 0 && max > 0) {
+      // Does the player to move win?
+      med = 0;
+    } else if (min < -1 && max == 0) {
+      // Draw or loss?
+      med = -1;
+    } else {
+      med = min + (max - min) / 2;
+    }
+
+    int score = solveNegamax(&Context, position, med, med + 1);
+    if (score <= med) {
+      max = score;
+    } else {
+      min = score;
+    }
+  }
+  out_result->score = min;
+
+  // Every move of the principal variation keeps the score, seen from the side
+  // that plays it.
+  Position line = *position;
+  int score = min;
+  out_result->principal_variation_length = 0;
+  while (line.move_counter < BOARD_CELLS) {
+    int col = findSolvedMove(&Context, &line, score);
+    out_result->principal_variation[out_result->principal_variation_length++] =
+        col;
+    boolean won = isWinningMove(&line, col);
+    playMove(&line, col);
+    if (won) {
+      break;
+    }
+    score = -score;
+  }
+  out_result->best_move = out_result->principal_variation_length > 0
+                              ? out_result->principal_variation[0]
+                              : -1;
+
+  out_result->nodes = Context.nodes;
+  out_result->elapsed_ns = currentTimeNs() - start_ns;
+}
+
+static int solveNegamax(SolverContext* context, const Position* position,
+                        int alpha, int beta) {
+  context->nodes++;
+  bitboard mask = position->player_masks[RED] | position->player_masks[YELLOW];
+  int moves = position->move_counter;
+  if (findWinningCells(position->player_masks[currentPlayer(position)], mask) &
+      findPlayableCells(position)) {
+    return WIN_SCORE - (moves + 1);
+  }
+
+  bitboard next = findNonLosingMoves(position);
+  if (next == 0) {
+    return -(WIN_SCORE - (moves + 2));
+  }
+  // With two cells left and no immediate win either way, the board fills up.
+  if (moves >= BOARD_CELLS - 2) {
+    return 0;
+  }
+
+  // The opponent cannot win with their next token any more, nor the player to
+  // move with this one.
+  int min = -(WIN_SCORE - (moves + 4));
+  if (alpha < min) {
+    alpha = min;
+    if (alpha >= beta) {
+      return alpha;
+    }
+  }
+  int max = WIN_SCORE - (moves + 3);
+  if (beta > max) {
+    beta = max;
+    if (alpha >= beta) {
+      return beta;
+    }
+  }
+
+  // Entries searched to the end of the game are exact whichever search stored
+  // them.
+  int depth = BOARD_CELLS - moves;
+  bitboard key = findPositionKey(position);
+  int hash_move = NO_MOVE;
+  TranspositionEntry entry;
+  if (probeTranspositionTable(context->table, key, &entry)) {
+    hash_move = entry.best_move;
+    if (entry.depth >= depth) {
+      if (entry.bound == EXACT_BOUND) {
+        return entry.score;
+      }
+      if (entry.bound == LOWER_BOUND && entry.score > alpha) {
+        alpha = entry.score;
+      } else if (entry.bound == UPPER_BOUND && entry.score < beta) {
+        beta = entry.score;
+      }
+      if (alpha >= beta) {
+        return entry.score;
+      }
+    }
+  }
+
+  int columns[BOARD_WIDTH];
+  int count = orderMoves(position, next, hash_move, columns);
+  int original_alpha = alpha;
+  int best = -INFINITE_SCORE;
+  int best_move = NO_MOVE;
+  int i;
+  for (i = 0; i < count; ++i) {
+    Position child = *position;
+    playMove(&child, columns[i]);
+    int score = -solveNegamax(context, &child, -beta, -alpha);
+    if (score > best) {
+      best = score;
+      best_move = columns[i];
+    }
+    if (score > alpha) {
+      alpha = score;
+    }
+    if (alpha >= beta) {
+      break;
+    }
+  }
+
+  entry.score = best;
+  entry.depth = depth;
+  entry.best_move = best_move;
+  if (best <= original_alpha) {
+    entry.bound = UPPER_BOUND;
+  } else if (best >= beta) {
+    entry.bound = LOWER_BOUND;
+  } else {
+    entry.bound = EXACT_BOUND;
+  }
+  storeTranspositionEntry(context->table, key, entry);
+  return best;
+}
@@ -0,0 +1,43 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdint.h>
+
+#include "bitboard.h"
+#include "transposition.h"
+
+/*** Structures ***/
+
+typedef struct SolveResult {
+  // score is the exact value for the player to move on the search.h scale:
+  // WIN_SCORE minus the tokens on the board once the winning token is dropped,
+  // negative for a loss and 0 for a draw.
+  int score;
+  // best_move is the column to drop the token in, -1 if the game is over.
+  int best_move;
+  // principal_variation holds the columns of the game both players play
+  // perfectly from the position, best_move first.
+  int principal_variation[BOARD_CELLS];
+  int principal_variation_length;
+  uint64_t nodes;
+  int64_t elapsed_ns;
+} SolveResult;
+
+/*** Declorations ***/
+
+// findSolveDistance returns the number of tokens still to drop until the game
+// ends with the score, which for a draw fills the board.
+int findSolveDistance(const Position* position, int score);
+
+// solvePosition finds the exact value of the position with null window
+// searches to the end of the game. The first windows decide win, draw or loss
+// and the rest narrow down how soon (MTD(f)), each one cut short by the bounds
+// the earlier ones left in the table. The table must not be NULL and may be
+// kept between positions, its full depth entries stay exact.
+void solvePosition(const Position* position, TranspositionTable* table,
+                   SolveResult* out_result);
+
+#endif
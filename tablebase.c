@@ -0,0 +1,775 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "tablebase.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "search.h"
+
+/*** Define ***/
+
+#define MAX_TABLEBASE_THREADS 256
+// A varint takes at most 10 bytes for a 64 bit difference.
+#define MAX_VARINT_BYTES 10
+
+/*** Structures ***/
+
+// KeyRun is a sorted stream of keys being merged, with the key at its head.
+typedef struct KeyRun {
+  FILE* file;
+  uint64_t head;
+} KeyRun;
+
+// LevelBuffer is the level being written to the file. Only its index and the
+// block being filled are kept in memory, the blocks go straight to the file.
+typedef struct LevelBuffer {
+  // length is the number of bytes of blocks written so far.
+  size_t length;
+  uint64_t* first_keys;
+  uint64_t* block_offsets;
+  uint64_t block_count;
+  uint64_t position_count;
+  // The block being filled.
+  uint64_t block_keys[TABLEBASE_BLOCK_POSITIONS];
+  uint8_t block_values[TABLEBASE_BLOCK_POSITIONS];
+  int block_length;
+  // block_data holds the block while it is compressed.
+  uint8_t block_data[TABLEBASE_BLOCK_POSITIONS / 4 +
+                     TABLEBASE_BLOCK_POSITIONS * MAX_VARINT_BYTES];
+} LevelBuffer;
+
+// LevelMapping is a level already written to the file, mapped read-only so
+// the generator probes it with the same code as the search while its pages
+// stay in the page cache instead of the heap.
+typedef struct LevelMapping {
+  void* mapping;
+  size_t mapping_size;
+  TablebaseView view;
+} LevelMapping;
+
+// TablebaseWorker is one thread's slice of a chunk of keys. Expanding fills
+// children with the sorted keys one move later, solving fills values.
+typedef struct TablebaseWorker {
+  pthread_t thread;
+  const uint64_t* keys;
+  size_t key_count;
+  uint64_t* children;
+  size_t child_count;
+  uint8_t* values;
+  const TablebaseView* next_level;
+} TablebaseWorker;
+
+/*** Declorations ***/
+
+// appendToLevel adds the key and its value to the level, which must receive
+// its keys in order. Full blocks are written to file as well.
+static int appendToLevel(LevelBuffer* level, uint64_t key, int value,
+                         FILE* file);
+
+// compareKeys orders keys for qsort.
+static int compareKeys(const void* first, const void* second);
+
+// expandLevel returns a stream of the sorted keys of every position one move
+// after the positions in level that is not over yet. Stores the number of
+// keys in out_count. Returns NULL if a temporary file cannot be written.
+static FILE* expandLevel(FILE* level, const TablebaseOptions* options,
+                         uint64_t* out_count);
+
+// expandThread fills the worker's children with the sorted unique keys one
+// move after its keys.
+static void* expandThread(void* tablebase_worker);
+
+// finishLevel writes the last block of the level and the level's index to
+// file, and fills out_level with where they are.
+static int finishLevel(LevelBuffer* level, FILE* file,
+                       TablebaseLevel* out_level);
+
+// flushBlock compresses the block being filled onto the level's data and
+// writes it to file.
+static int flushBlock(LevelBuffer* level, FILE* file);
+
+// freeLevelBuffer frees the memory of the level.
+static void freeLevelBuffer(LevelBuffer* level);
+
+// mapLevel flushes file and maps the level written to it into out_mapping.
+// Returns -1 if it cannot be mapped, 0 otherwise.
+static int mapLevel(FILE* file, const TablebaseLevel* level,
+                    LevelMapping* out_mapping);
+
+// mergeRuns merges the sorted runs into one sorted stream without duplicates
+// and closes them. Stores the number of keys in out_count. Returns NULL if
+// the stream cannot be written.
+static FILE* mergeRuns(FILE** runs, int run_count, uint64_t* out_count);
+
+// probeTablebaseView returns the value stored for the key in the level,
+// TABLEBASE_UNKNOWN if it is not there.
+static int probeTablebaseView(const TablebaseView* view, bitboard key);
+
+// pushKeyRun moves the run added at index up the heap until its head is not
+// smaller than its parent's.
+static void pushKeyRun(KeyRun* heap, int index);
+
+// readVarint decodes the varint at *bytes and moves *bytes past it.
+static uint64_t readVarint(const uint8_t** bytes);
+
+// runWorkers runs the function on every worker on its own thread, or on this
+// thread for a worker whose thread cannot be started.
+static void runWorkers(TablebaseWorker* workers, int count,
+                       void* (*function)(void*));
+
+// solveTablebasePosition returns the value of the position given the values of
+// the positions one move later in next_level.
+static int solveTablebasePosition(const Position* position,
+                                  const TablebaseView* next_level);
+
+// solveThread fills the worker's values from the next level.
+static void* solveThread(void* tablebase_worker);
+
+// unmapLevel unmaps the level mapped by mapLevel, if there is one.
+static void unmapLevel(LevelMapping* mapping);
+
+// writeVarint encodes the value at bytes and returns the number of bytes
+// written.
+static int writeVarint(uint8_t* bytes, uint64_t value);
+
+/*** Functions ***/
+
+static int appendToLevel(LevelBuffer* level, uint64_t key, int value,
+                         FILE* file) {
+  level->block_keys[level->block_length] = key;
+  level->block_values[level->block_length] = value;
+  level->block_length++;
+  level->position_count++;
+  if (level->block_length == TABLEBASE_BLOCK_POSITIONS) {
+    return flushBlock(level, file);
+  }
+  return 0;
+}
+
+void closeTablebase(Tablebase* tablebase) {
+  munmap(tablebase->mapping, tablebase->mapping_size);
+  tablebase->mapping = NULL;
+}
+
+static int compareKeys(const void* first, const void* second) {
+  uint64_t first_key = *(const uint64_t*)first;
+  uint64_t second_key = *(const uint64_t*)second;
+  return (first_key > second_key) - (first_key < second_key);
+}
+
+int createTablebaseFile(const char* path, const TablebaseOptions* options,
+                        TablebaseStats* out_stats) {
+  memset(out_stats, 0, sizeof(*out_stats));
+  int64_t start_ns = currentTimeNs();
+  int root_tokens = options->root.move_counter;
+  int min_tokens =
+      options->min_tokens > root_tokens ? options->min_tokens : root_tokens;
+
+  // Forward: every level is built from the one before it. The levels under
+  // min_tokens are only needed to reach the first stored one.
+  FILE* levels[BOARD_CELLS + 1] = {NULL};
+  uint64_t level_counts[BOARD_CELLS + 1] = {0};
+  levels[root_tokens] = tmpfile();
+  if (levels[root_tokens] == NULL) {
+    return -1;
+  }
+  bitboard root_key = findPositionKey(&options->root);
+  fwrite(&root_key, sizeof(root_key), 1, levels[root_tokens]);
+  level_counts[root_tokens] = 1;
+
+  int max_tokens = root_tokens;
+  int tokens;
+  boolean failed = FALSE;
+  for (tokens = root_tokens; tokens < BOARD_CELLS - 1; ++tokens) {
+    levels[tokens + 1] =
+        expandLevel(levels[tokens], options, &level_counts[tokens + 1]);
+    if (tokens < min_tokens) {
+      fclose(levels[tokens]);
+      levels[tokens] = NULL;
+    }
+    if (levels[tokens + 1] == NULL) {
+      failed = TRUE;
+      break;
+    }
+    if (level_counts[tokens + 1] == 0) {
+      break;
+    }
+    max_tokens = tokens + 1;
+  }
+
+  // Backward: the fullest level is solved first, every level after that from
+  // the one solved just before it, which is read back from the file.
+  FILE* file = failed ? NULL : fopen(path, "w+b");
+  TablebaseHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  memcpy(Header.magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+  Header.board_width = BOARD_WIDTH;
+  Header.board_height = BOARD_HEIGHT;
+  Header.connect_length = CONNECT_LENGTH;
+  Header.min_tokens = min_tokens;
+  Header.max_tokens = max_tokens;
+  Header.block_positions = TABLEBASE_BLOCK_POSITIONS;
+  failed = file == NULL || fwrite(&Header, sizeof(Header), 1, file) != 1;
+
+  size_t chunk_keys =
+      (size_t)options->memory_megabytes * 1024 * 1024 / (sizeof(uint64_t) + 1);
+  uint64_t* keys = failed ? NULL : malloc(chunk_keys * sizeof(uint64_t));
+  uint8_t* values = failed ? NULL : malloc(chunk_keys);
+  failed = failed || keys == NULL || values == NULL;
+
+  int threads = options->threads < MAX_TABLEBASE_THREADS
+                    ? options->threads
+                    : MAX_TABLEBASE_THREADS;
+  TablebaseWorker workers[MAX_TABLEBASE_THREADS];
+  LevelMapping next_level;
+  memset(&next_level, 0, sizeof(next_level));
+  for (tokens = max_tokens; tokens >= min_tokens && !failed; --tokens) {
+    LevelBuffer* level = calloc(1, sizeof(LevelBuffer));
+    failed = level == NULL;
+
+    rewind(levels[tokens]);
+    size_t count;
+    while (!failed && (count = fread(keys, sizeof(uint64_t), chunk_keys,
+                                     levels[tokens])) > 0) {
+      int i;
+      for (i = 0; i < threads; ++i) {
+        workers[i].keys = keys + count * i / threads;
+        workers[i].key_count =
+            count * (i + 1) / threads - count * i / threads;
+        workers[i].values = values + count * i / threads;
+        workers[i].next_level = &next_level.view;
+      }
+      runWorkers(workers, threads, solveThread);
+
+      size_t j;
+      for (j = 0; j < count && !failed; ++j) {
+        failed = appendToLevel(level, keys[j], values[j], file) == -1;
+        out_stats->wins += values[j] == TABLEBASE_WIN;
+        out_stats->draws += values[j] == TABLEBASE_DRAW;
+        out_stats->losses += values[j] == TABLEBASE_LOSS;
+      }
+    }
+    failed = failed ||
+             finishLevel(level, file, &Header.levels[tokens]) == -1;
+    out_stats->positions += Header.levels[tokens].position_count;
+    if (level != NULL) {
+      freeLevelBuffer(level);
+    }
+
+    unmapLevel(&next_level);
+    if (!failed && tokens > min_tokens) {
+      failed = mapLevel(file, &Header.levels[tokens], &next_level) == -1;
+    }
+  }
+  unmapLevel(&next_level);
+  free(keys);
+  free(values);
+
+  for (tokens = 0; tokens <= BOARD_CELLS; ++tokens) {
+    if (levels[tokens] != NULL) {
+      fclose(levels[tokens]);
+    }
+  }
+
+  if (file != NULL) {
+    long bytes = ftell(file);
+    failed = failed || fseek(file, 0, SEEK_SET) != 0 ||
+             fwrite(&Header, sizeof(Header), 1, file) != 1;
+    failed = fclose(file) != 0 || failed;
+    out_stats->bytes = bytes;
+  }
+  out_stats->elapsed_ns = currentTimeNs() - start_ns;
+  return failed ? -1 : 0;
+}
+
+static FILE* expandLevel(FILE* level, const TablebaseOptions* options,
+                         uint64_t* out_count) {
+  size_t chunk_keys = (size_t)options->memory_megabytes * 1024 * 1024 /
+                      ((1 + BOARD_WIDTH) * sizeof(uint64_t));
+  uint64_t* keys = malloc(chunk_keys * sizeof(uint64_t));
+  uint64_t* children = malloc(chunk_keys * BOARD_WIDTH * sizeof(uint64_t));
+  int threads = options->threads < MAX_TABLEBASE_THREADS
+                    ? options->threads
+                    : MAX_TABLEBASE_THREADS;
+  TablebaseWorker workers[MAX_TABLEBASE_THREADS];
+  FILE** runs = NULL;
+  int run_count = 0;
+  boolean failed = keys == NULL || children == NULL;
+
+  // Every chunk leaves one sorted run per thread behind, and the runs are
+  // merged into the next level at the end.
+  rewind(level);
+  size_t count;
+  while (!failed &&
+         (count = fread(keys, sizeof(uint64_t), chunk_keys, level)) > 0) {
+    int i;
+    for (i = 0; i < threads; ++i) {
+      workers[i].keys = keys + count * i / threads;
+      workers[i].key_count = count * (i + 1) / threads - count * i / threads;
+      workers[i].children = children + count * i / threads * BOARD_WIDTH;
+    }
+    runWorkers(workers, threads, expandThread);
+
+    FILE** grown = realloc(runs, (run_count + threads) * sizeof(FILE*));
+    if (grown == NULL) {
+      failed = TRUE;
+      break;
+    }
+    runs = grown;
+    for (i = 0; i < threads && !failed; ++i) {
+      FILE* run = tmpfile();
+      if (run == NULL) {
+        failed = TRUE;
+        break;
+      }
+      runs[run_count++] = run;
+      failed = fwrite(workers[i].children, sizeof(uint64_t),
+                      workers[i].child_count,
+                      run) != workers[i].child_count;
+    }
+  }
+  free(keys);
+  free(children);
+
+  FILE* next = NULL;
+  if (failed) {
+    int i;
+    for (i = 0; i < run_count; ++i) {
+      fclose(runs[i]);
+    }
+  } else {
+    next = mergeRuns(runs, run_count, out_count);
+  }
+  free(runs);
+  return next;
+}
+
+static void* expandThread(void* tablebase_worker) {
+  TablebaseWorker* worker = tablebase_worker;
+  size_t count = 0;
+  size_t i;
+  int col;
+  for (i = 0; i < worker->key_count; ++i) {
+    Position position = createPositionFromKey(worker->keys[i]);
+    for (col = 0; col < BOARD_WIDTH; ++col) {
+      // A winning move or the last empty cell ends the game, so the position
+      // after it is never stored.
+      if (!canPlay(&position, col) || isWinningMove(&position, col) ||
+          position.move_counter + 1 == BOARD_CELLS) {
+        continue;
+      }
+      Position child = position;
+      playMove(&child, col);
+      worker->children[count++] = findPositionKey(&child);
+    }
+  }
+
+  qsort(worker->children, count, sizeof(uint64_t), compareKeys);
+  size_t unique = 0;
+  for (i = 0; i < count; ++i) {
+    if (unique == 0 || worker->children[i] != worker->children[unique - 1]) {
+      worker->children[unique++] = worker->children[i];
+    }
+  }
+  worker->child_count = unique;
+  return NULL;
+}
+
+static int finishLevel(LevelBuffer* level, FILE* file,
+                       TablebaseLevel* out_level) {
+  if (level->block_length > 0 && flushBlock(level, file) == -1) {
+    return -1;
+  }
+  out_level->position_count = level->position_count;
+  out_level->block_count = level->block_count;
+  out_level->data_offset = ftell(file) - level->length;
+
+  // The index is read in place from the mapped file, so it starts on an 8
+  // byte boundary.
+  static const uint8_t padding[sizeof(uint64_t)] = {0};
+  long pad = (sizeof(uint64_t) - ftell(file) % sizeof(uint64_t)) %
+             sizeof(uint64_t);
+  if (fwrite(padding, 1, pad, file) != (size_t)pad) {
+    return -1;
+  }
+  out_level->index_offset = ftell(file);
+  if (fwrite(level->first_keys, sizeof(uint64_t), level->block_count, file) !=
+          level->block_count ||
+      fwrite(level->block_offsets, sizeof(uint64_t), level->block_count + 1,
+             file) != level->block_count + 1) {
+    return -1;
+  }
+  return 0;
+}
+
+static int flushBlock(LevelBuffer* level, FILE* file) {
+  int count = level->block_length;
+  size_t value_bytes = (count + 3) / 4;
+  if (level->block_count % 64 == 0) {
+    uint64_t* first_keys = realloc(
+        level->first_keys, (level->block_count + 64) * sizeof(uint64_t));
+    uint64_t* block_offsets = realloc(
+        level->block_offsets, (level->block_count + 65) * sizeof(uint64_t));
+    if (first_keys != NULL) {
+      level->first_keys = first_keys;
+    }
+    if (block_offsets != NULL) {
+      level->block_offsets = block_offsets;
+    }
+    if (first_keys == NULL || block_offsets == NULL) {
+      return -1;
+    }
+  }
+
+  uint8_t* block = level->block_data;
+  memset(block, 0, value_bytes);
+  int i;
+  for (i = 0; i < count; ++i) {
+    block[i / 4] |= level->block_values[i] << (2 * (i % 4));
+  }
+  size_t length = value_bytes;
+  for (i = 1; i < count; ++i) {
+    length += writeVarint(block + length,
+                          level->block_keys[i] - level->block_keys[i - 1]);
+  }
+
+  level->first_keys[level->block_count] = level->block_keys[0];
+  level->block_offsets[level->block_count] = level->length;
+  level->block_count++;
+  level->length += length;
+  level->block_offsets[level->block_count] = level->length;
+  level->block_length = 0;
+  return fwrite(block, 1, length, file) == length ? 0 : -1;
+}
+
+static void freeLevelBuffer(LevelBuffer* level) {
+  free(level->first_keys);
+  free(level->block_offsets);
+  free(level);
+}
+
+static int mapLevel(FILE* file, const TablebaseLevel* level,
+                    LevelMapping* out_mapping) {
+  memset(out_mapping, 0, sizeof(*out_mapping));
+  if (level->block_count == 0) {
+    return 0;
+  }
+  if (fflush(file) != 0) {
+    return -1;
+  }
+  // The mapping starts on the page holding the level's first block and ends
+  // with its index.
+  uint64_t page_size = sysconf(_SC_PAGESIZE);
+  uint64_t start = level->data_offset - level->data_offset % page_size;
+  uint64_t end =
+      level->index_offset + (2 * level->block_count + 1) * sizeof(uint64_t);
+  void* mapping = mmap(NULL, end - start, PROT_READ, MAP_SHARED,
+                       fileno(file), start);
+  if (mapping == MAP_FAILED) {
+    return -1;
+  }
+  const uint8_t* bytes = (const uint8_t*)mapping - start;
+  out_mapping->mapping = mapping;
+  out_mapping->mapping_size = end - start;
+  out_mapping->view.data = bytes + level->data_offset;
+  out_mapping->view.first_keys =
+      (const uint64_t*)(bytes + level->index_offset);
+  out_mapping->view.block_offsets =
+      out_mapping->view.first_keys + level->block_count;
+  out_mapping->view.block_count = level->block_count;
+  out_mapping->view.position_count = level->position_count;
+  return 0;
+}
+
+static FILE* mergeRuns(FILE** runs, int run_count, uint64_t* out_count) {
+  *out_count = 0;
+  FILE* merged = tmpfile();
+  KeyRun* heap = malloc((run_count + 1) * sizeof(KeyRun));
+  boolean failed = merged == NULL || heap == NULL;
+
+  int count = 0;
+  int i;
+  for (i = 0; i < run_count; ++i) {
+    rewind(runs[i]);
+    if (!failed &&
+        fread(&heap[count].head, sizeof(uint64_t), 1, runs[i]) == 1) {
+      heap[count].file = runs[i];
+      pushKeyRun(heap, count);
+      count++;
+    } else {
+      fclose(runs[i]);
+    }
+  }
+
+  // The smallest head is always at the top of the heap.
+  uint64_t last = 0;
+  while (count > 0 && !failed) {
+    KeyRun* top = &heap[0];
+    if (*out_count == 0 || top->head != last) {
+      last = top->head;
+      failed = fwrite(&last, sizeof(uint64_t), 1, merged) != 1;
+      (*out_count)++;
+    }
+    if (fread(&top->head, sizeof(uint64_t), 1, top->file) != 1) {
+      fclose(top->file);
+      heap[0] = heap[--count];
+    }
+
+    // Sift the new top down.
+    int index = 0;
+    while (TRUE) {
+      int smallest = index;
+      int child;
+      for (child = 2 * index + 1; child <= 2 * index + 2 && child < count;
+           ++child) {
+        if (heap[child].head < heap[smallest].head) {
+          smallest = child;
+        }
+      }
+      if (smallest == index) {
+        break;
+      }
+      KeyRun swap = heap[index];
+      heap[index] = heap[smallest];
+      heap[smallest] = swap;
+      index = smallest;
+    }
+  }
+  for (i = 0; i < count; ++i) {
+    fclose(heap[i].file);
+  }
+  free(heap);
+
+  if (failed && merged != NULL) {
+    fclose(merged);
+    merged = NULL;
+  }
+  return merged;
+}
+
+int openTablebase(const char* path, Tablebase* out_tablebase) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+  struct stat status;
+  if (fstat(fd, &status) == -1 ||
+      (size_t)status.st_size < sizeof(TablebaseHeader)) {
+    close(fd);
+    return -1;
+  }
+  void* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return -1;
+  }
+
+  const TablebaseHeader* header = mapping;
+  boolean valid =
+      memcmp(header->magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) == 0 &&
+      header->board_width == BOARD_WIDTH &&
+      header->board_height == BOARD_HEIGHT &&
+      header->connect_length == CONNECT_LENGTH &&
+      header->block_positions == TABLEBASE_BLOCK_POSITIONS &&
+      header->min_tokens <= header->max_tokens &&
+      header->max_tokens <= BOARD_CELLS;
+  int tokens;
+  for (tokens = 0; tokens <= BOARD_CELLS && valid; ++tokens) {
+    const TablebaseLevel* level = &header->levels[tokens];
+    TablebaseView* view = &out_tablebase->levels[tokens];
+    if (level->block_count == 0) {
+      memset(view, 0, sizeof(*view));
+      valid = level->position_count == 0;
+      continue;
+    }
+    // The counts are checked before anything is computed from them, so a
+    // corrupt header cannot overflow the offsets. Every block but the last is
+    // full and the last holds at least one position.
+    valid = level->block_count <= (uint64_t)status.st_size &&
+            level->position_count >
+                (level->block_count - 1) * TABLEBASE_BLOCK_POSITIONS &&
+            level->position_count <=
+                level->block_count * TABLEBASE_BLOCK_POSITIONS &&
+            level->index_offset % sizeof(uint64_t) == 0 &&
+            level->index_offset <= (uint64_t)status.st_size &&
+            (2 * level->block_count + 1) * sizeof(uint64_t) <=
+                (uint64_t)status.st_size - level->index_offset &&
+            level->data_offset <= level->index_offset;
+    if (!valid) {
+      break;
+    }
+    view->data = (const uint8_t*)mapping + level->data_offset;
+    view->first_keys =
+        (const uint64_t*)((const uint8_t*)mapping + level->index_offset);
+    view->block_offsets = view->first_keys + level->block_count;
+    view->block_count = level->block_count;
+    view->position_count = level->position_count;
+    // The blocks follow each other and the last one ends before the index.
+    uint64_t block;
+    for (block = 0; block < level->block_count && valid; ++block) {
+      valid = view->block_offsets[block] <= view->block_offsets[block + 1];
+    }
+    valid = valid && view->block_offsets[level->block_count] <=
+                         level->index_offset - level->data_offset;
+  }
+  if (!valid) {
+    munmap(mapping, status.st_size);
+    return -1;
+  }
+
+  out_tablebase->min_tokens = header->min_tokens;
+  out_tablebase->max_tokens = header->max_tokens;
+  out_tablebase->mapping = mapping;
+  out_tablebase->mapping_size = status.st_size;
+  return 0;
+}
+
+int probeTablebase(const Tablebase* tablebase, const Position* position) {
+  if (position->move_counter < tablebase->min_tokens ||
+      position->move_counter > tablebase->max_tokens) {
+    return TABLEBASE_UNKNOWN;
+  }
+  return probeTablebaseView(&tablebase->levels[position->move_counter],
+                            findPositionKey(position));
+}
+
+static int probeTablebaseView(const TablebaseView* view, bitboard key) {
+  if (view->block_count == 0 || key < view->first_keys[0]) {
+    return TABLEBASE_UNKNOWN;
+  }
+
+  // The last block whose first key is not past the key.
+  uint64_t low = 0;
+  uint64_t high = view->block_count - 1;
+  while (low < high) {
+    uint64_t middle = low + (high - low + 1) / 2;
+    if (view->first_keys[middle] <= key) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+
+  uint64_t count = low + 1 < view->block_count
+                       ? TABLEBASE_BLOCK_POSITIONS
+                       : view->position_count - low * TABLEBASE_BLOCK_POSITIONS;
+  const uint8_t* values = view->data + view->block_offsets[low];
+  const uint8_t* bytes = values + (count + 3) / 4;
+  uint64_t block_key = view->first_keys[low];
+  uint64_t i = 0;
+  while (block_key < key && ++i < count) {
+    block_key += readVarint(&bytes);
+  }
+  if (block_key != key) {
+    return TABLEBASE_UNKNOWN;
+  }
+  return (values[i / 4] >> (2 * (i % 4))) & 3;
+}
+
+static void pushKeyRun(KeyRun* heap, int index) {
+  while (index > 0 && heap[(index - 1) / 2].head > heap[index].head) {
+    KeyRun swap = heap[index];
+    heap[index] = heap[(index - 1) / 2];
+    heap[(index - 1) / 2] = swap;
+    index = (index - 1) / 2;
+  }
+}
+
+static uint64_t readVarint(const uint8_t** bytes) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (**bytes & 0x80) {
+    value |= (uint64_t)(**bytes & 0x7f) << shift;
+    shift += 7;
+    (*bytes)++;
+  }
+  value |= (uint64_t)**bytes << shift;
+  (*bytes)++;
+  return value;
+}
+
+static void runWorkers(TablebaseWorker* workers, int count,
+                       void* (*function)(void*)) {
+  boolean started[MAX_TABLEBASE_THREADS];
+  int i;
+  for (i = 1; i < count; ++i) {
+    started[i] =
+        pthread_create(&workers[i].thread, NULL, function, &workers[i]) == 0;
+    if (!started[i]) {
+      function(&workers[i]);
+    }
+  }
+  function(&workers[0]);
+  for (i = 1; i < count; ++i) {
+    if (started[i]) {
+      pthread_join(workers[i].thread, NULL);
+    }
+  }
+}
+
+static int solveTablebasePosition(const Position* position,
+                                  const TablebaseView* next_level) {
+  int col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    if (canPlay(position, col) && isWinningMove(position, col)) {
+      return TABLEBASE_WIN;
+    }
+  }
+
+  int best = TABLEBASE_LOSS;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    if (!canPlay(position, col)) {
+      continue;
+    }
+    // Filling the last cell without a win is a draw.
+    if (position->move_counter + 1 == BOARD_CELLS) {
+      best = TABLEBASE_DRAW;
+      continue;
+    }
+    Position child = *position;
+    playMove(&child, col);
+    int child_value = probeTablebaseView(next_level, findPositionKey(&child));
+    if (child_value == TABLEBASE_LOSS) {
+      return TABLEBASE_WIN;
+    }
+    if (child_value == TABLEBASE_DRAW) {
+      best = TABLEBASE_DRAW;
+    }
+  }
+  return best;
+}
+
+static void* solveThread(void* tablebase_worker) {
+  TablebaseWorker* worker = tablebase_worker;
+  size_t i;
+  for (i = 0; i < worker->key_count; ++i) {
+    Position position = createPositionFromKey(worker->keys[i]);
+    worker->values[i] = solveTablebasePosition(&position, worker->next_level);
+  }
+  return NULL;
+}
+
+static void unmapLevel(LevelMapping* mapping) {
+  if (mapping->mapping != NULL) {
+    munmap(mapping->mapping, mapping->mapping_size);
+  }
+  memset(mapping, 0, sizeof(*mapping));
+}
+
+static int writeVarint(uint8_t* bytes, uint64_t value) {
+  int length = 0;
+  while (value >= 0x80) {
+    bytes[length++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  bytes[length++] = value;
+  return length;
+}
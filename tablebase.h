@@ -0,0 +1,121 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitboard.h"
+
+/*** Define ***/
+
+#define TABLEBASE_MAGIC "C4TB2"
+// Every block holds TABLEBASE_BLOCK_POSITIONS positions: their 2 bit values
+// followed by the keys, each stored as the varint difference to the key
+// before it.
+#define TABLEBASE_BLOCK_POSITIONS 1024
+
+/*** Enum ***/
+
+// tablebase_value is the result of the game for the player to move with
+// perfect play.
+enum tablebase_value {
+  TABLEBASE_UNKNOWN = -1,
+  TABLEBASE_LOSS,
+  TABLEBASE_DRAW,
+  TABLEBASE_WIN
+};
+
+/*** Structures ***/
+
+// TablebaseLevel holds the positions with one number of tokens. Its blocks
+// start at data_offset in the file, followed by block_count first keys and
+// block_count + 1 block offsets into the data.
+typedef struct TablebaseLevel {
+  uint64_t position_count;
+  uint64_t block_count;
+  uint64_t data_offset;
+  uint64_t index_offset;
+} TablebaseLevel;
+
+// TablebaseHeader starts the tablebase file. Levels from min_tokens to
+// max_tokens are filled in, the others are empty. The file is in the byte
+// order of the machine that wrote it.
+typedef struct TablebaseHeader {
+  char magic[8];
+  uint32_t board_width;
+  uint32_t board_height;
+  uint32_t min_tokens;
+  uint32_t max_tokens;
+  uint32_t block_positions;
+  uint32_t connect_length;
+  TablebaseLevel levels[BOARD_CELLS + 1];
+} TablebaseHeader;
+
+// TablebaseView is one level ready to be probed, either in a mapped file or
+// in the memory of the generator.
+typedef struct TablebaseView {
+  const uint8_t* data;
+  const uint64_t* first_keys;
+  const uint64_t* block_offsets;
+  uint64_t block_count;
+  uint64_t position_count;
+} TablebaseView;
+
+// Tablebase is a tablebase file mapped into memory.
+typedef struct Tablebase {
+  int min_tokens;
+  int max_tokens;
+  TablebaseView levels[BOARD_CELLS + 1];
+  void* mapping;
+  size_t mapping_size;
+} Tablebase;
+
+// TablebaseOptions controls createTablebaseFile.
+typedef struct TablebaseOptions {
+  // root is the position every stored position is reached from.
+  Position root;
+  // min_tokens is the fewest tokens of a stored position.
+  int min_tokens;
+  int threads;
+  // memory_megabytes bounds the buffers of a chunk of positions. The level
+  // looked up while the level before it is solved is mapped from the file.
+  int memory_megabytes;
+} TablebaseOptions;
+
+// TablebaseStats describes a finished tablebase.
+typedef struct TablebaseStats {
+  uint64_t positions;
+  uint64_t wins;
+  uint64_t draws;
+  uint64_t losses;
+  uint64_t bytes;
+  int64_t elapsed_ns;
+} TablebaseStats;
+
+/*** Declorations ***/
+
+// closeTablebase unmaps the tablebase.
+void closeTablebase(Tablebase* tablebase);
+
+// createTablebaseFile finds every position with at least min_tokens tokens
+// that can be reached from the root and is not over yet, solves them by
+// retrograde analysis from the fullest level back and writes them to the file
+// at path. Levels are built and written as streams of sorted chunks, and the
+// solved level after the current one is probed from a read-only mapping of
+// the file, so only one chunk and the block indexes are on the heap. Returns
+// -1 if the tablebase cannot be built or written, 0 otherwise.
+int createTablebaseFile(const char* path, const TablebaseOptions* options,
+                        TablebaseStats* out_stats);
+
+// openTablebase maps the tablebase file at path. Returns -1 if the file cannot
+// be mapped or is not a tablebase for this board, 0 otherwise.
+int openTablebase(const char* path, Tablebase* out_tablebase);
+
+// probeTablebase returns the tablebase_value of the position,
+// TABLEBASE_UNKNOWN if the position is not in the tablebase.
+int probeTablebase(const Tablebase* tablebase, const Position* position);
+
+#endif
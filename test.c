@@ -0,0 +1,610 @@
+// Connect Four
+// Author: Scott Helms
+
+// test checks the fast versions of the game primitives against plain ones on
+// random positions of the board the program is built for: the batch win
+// kernels against hasConnectFour, the solver against a full width negamax,
+// the tablebase against the solver and the incremental evaluation against
+// the one built from scratch, which has to score mirrored boards the same and
+// open in the centre of the 7 column boards. It also checks that a stopped
+// ponder search leaves no event for the end of game prompt. Every check
+// prints one line of "key value" pairs and the exit status is 1 if any check
+// failed.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "eval.h"
+#include "game.h"
+#include "search.h"
+#include "selfplay.h"
+#include "solver.h"
+#include "tablebase.h"
+#include "transposition.h"
+#include "winbatch.h"
+
+/*** Define ***/
+
+#define TEST_SEED 2024
+// TEST_BATCH_BOARDS is no multiple of WIN_BATCH_LANES, so the boards after
+// the last whole group of lanes are checked as well.
+#define TEST_BATCH_BOARDS 4099
+#define TEST_EVALUATION_GAMES 2000
+// The openings are checked on the 7 column boards with four in a row, whose
+// centre is the best first move. Every depth from TEST_OPENING_MIN_DEPTH to
+// TEST_OPENING_MAX_DEPTH has to open in the centre, and searched to
+// TEST_OPENING_RANK_DEPTH the centre has to score above every other column.
+#if BOARD_WIDTH == 7 && (BOARD_HEIGHT == 6 || BOARD_HEIGHT == 7) &&            \
+    CONNECT_LENGTH == 4
+#define TEST_OPENINGS
+#endif
+#define TEST_OPENING_MIN_DEPTH 6
+#define TEST_OPENING_MAX_DEPTH 14
+#define TEST_OPENING_RANK_DEPTH 11
+// Each ponder round searches a random middle game position to
+// TEST_PONDER_DEPTH, stops the search and answers the end of game prompt
+// within TEST_PONDER_WAIT_MS.
+#define TEST_PONDER_ROUNDS 20
+#define TEST_PONDER_DEPTH 8
+#define TEST_PONDER_WAIT_MS 20
+// The reference negamax has no table and searches every move, so the solver
+// is checked on positions with few empty cells.
+#define TEST_SOLVE_EMPTY_CELLS 9
+#define TEST_SOLVE_POSITIONS 200
+// The tablebase root leaves enough empty cells for its levels to span more
+// than one block, half the cells on boards too small for that.
+#if BOARD_CELLS / 2 < 18
+#define TEST_TABLEBASE_EMPTY_CELLS (BOARD_CELLS / 2)
+#else
+#define TEST_TABLEBASE_EMPTY_CELLS 18
+#endif
+
+/*** Structures ***/
+
+// TestResult counts the cases of a check and the ones that failed.
+typedef struct TestResult {
+  uint64_t checked;
+  uint64_t failed;
+} TestResult;
+
+/*** Declorations ***/
+
+// compareKeys orders bitboard keys for qsort.
+static int compareKeys(const void* a, const void* b);
+
+// createRandomPosition plays random moves from the empty board until
+// empty_cells cells are left, starting over whenever a game ends first. The
+// position returned is not over.
+static Position createRandomPosition(uint64_t* random_state, int empty_cells);
+
+// findReferenceScore returns the exact score of the position like
+// solvePosition, searched with alpha-beta and no other pruning.
+static int findReferenceScore(const Position* position, int alpha, int beta);
+
+// printTestResult prints the result of the check and returns 1 if a case
+// failed, 0 otherwise.
+static int printTestResult(const char* name, TestResult result);
+
+// testBatchWins checks findBatchWins, findBatchWinsBuild and
+// findBatchWinsScalar against hasConnectFour on the positions of random games
+// played to the end and on random masks.
+static TestResult testBatchWins(uint64_t* random_state);
+
+// testEvaluation checks that addEvaluationToken keeps the evaluation equal to
+// createEvaluation after every move of random games.
+static TestResult testEvaluation(uint64_t* random_state);
+
+// testEvaluationMirror checks that evaluatePosition scores the mirror image
+// of the positions of random games the same as the position.
+static TestResult testEvaluationMirror(uint64_t* random_state);
+
+#ifdef TEST_OPENINGS
+// testEvaluationOpenings checks that the search with evaluated leaves opens
+// in the centre at every depth and scores the centre above the other first
+// moves.
+static TestResult testEvaluationOpenings();
+#endif
+
+// testPonderStop starts and stops pondering on random positions, with the
+// keys read from a pipe and the frames written to /dev/null, and checks that
+// no search event is left for playerInputReaderUntil and that endGame takes
+// the next key.
+static TestResult testPonderStop(uint64_t* random_state);
+
+// testSolver checks the score and the best move of solvePosition against
+// findReferenceScore.
+static TestResult testSolver(uint64_t* random_state);
+
+// testTablebase builds a tablebase from a random root and checks every
+// position reachable from it against solvePosition, then checks that a
+// corrupt copy of the file is refused.
+static TestResult testTablebase(uint64_t* random_state);
+
+// testTablebaseLevels probes every position reachable from the root that is
+// not over against solvePosition, one level of tokens at a time so every
+// position is probed once however many move orders lead to it.
+static void testTablebaseLevels(const Tablebase* tablebase,
+                                const Position* root,
+                                TranspositionTable* table, TestResult* result);
+
+// writeTestFile writes length bytes to a new temporary file and stores its
+// path in path, which must hold a mkstemp template. Returns -1 if the file
+// cannot be written, 0 otherwise.
+static int writeTestFile(char* path, const void* bytes, size_t length);
+
+/*** Functions ***/
+
+static int compareKeys(const void* a, const void* b) {
+  bitboard first = *(const bitboard*)a;
+  bitboard second = *(const bitboard*)b;
+  return first < second ? -1 : first > second;
+}
+
+static Position createRandomPosition(uint64_t* random_state,
+                                     int empty_cells) {
+  Position position = createPosition();
+  while (position.move_counter < BOARD_CELLS - empty_cells) {
+    int col = nextRandom(random_state) % BOARD_WIDTH;
+    if (!canPlay(&position, col)) {
+      continue;
+    }
+    if (isWinningMove(&position, col)) {
+      position = createPosition();
+      continue;
+    }
+    playMove(&position, col);
+  }
+  return position;
+}
+
+static int findReferenceScore(const Position* position, int alpha, int beta) {
+  if (isBoardFull(position)) {
+    return 0;
+  }
+  int col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    if (canPlay(position, col) && isWinningMove(position, col)) {
+      return WIN_SCORE - (position->move_counter + 1);
+    }
+  }
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    if (!canPlay(position, col)) {
+      continue;
+    }
+    Position child = *position;
+    playMove(&child, col);
+    int score = -findReferenceScore(&child, -beta, -alpha);
+    if (score >= beta) {
+      return score;
+    }
+    if (score > alpha) {
+      alpha = score;
+    }
+  }
+  return alpha;
+}
+
+static int printTestResult(const char* name, TestResult result) {
+  printf("test %s board %dx%d connect %d checked %llu failed %llu\n", name,
+         BOARD_WIDTH, BOARD_HEIGHT, CONNECT_LENGTH,
+         (unsigned long long)result.checked,
+         (unsigned long long)result.failed);
+  fflush(stdout);
+  return result.failed > 0 || result.checked == 0;
+}
+
+static TestResult testBatchWins(uint64_t* random_state) {
+  static bitboard masks[2][TEST_BATCH_BOARDS];
+  static uint8_t wins[TEST_BATCH_BOARDS];
+  static uint8_t build_wins[TEST_BATCH_BOARDS];
+  static uint8_t scalar_wins[TEST_BATCH_BOARDS];
+  TestResult Result = {0, 0};
+
+  // The first half are positions of games played to the end, so they hold
+  // wins of both players, the second half random cells of random owners.
+  Position position = createPosition();
+  size_t board;
+  for (board = 0; board < TEST_BATCH_BOARDS / 2; ++board) {
+    if (hasConnectFour(position.player_masks[RED]) ||
+        hasConnectFour(position.player_masks[YELLOW]) ||
+        isBoardFull(&position)) {
+      position = createPosition();
+    }
+    int col;
+    do {
+      col = nextRandom(random_state) % BOARD_WIDTH;
+    } while (!canPlay(&position, col));
+    playMove(&position, col);
+    masks[RED][board] = position.player_masks[RED];
+    masks[YELLOW][board] = position.player_masks[YELLOW];
+  }
+  for (; board < TEST_BATCH_BOARDS; ++board) {
+    bitboard cells = nextRandom(random_state) & boardMask();
+    bitboard owners = nextRandom(random_state);
+    masks[RED][board] = cells & owners;
+    masks[YELLOW][board] = cells & ~owners;
+  }
+
+  WinBatch Batch;
+  Batch.player_masks[RED] = masks[RED];
+  Batch.player_masks[YELLOW] = masks[YELLOW];
+  Batch.count = TEST_BATCH_BOARDS;
+  findBatchWins(&Batch, wins);
+  findBatchWinsBuild(&Batch, build_wins);
+  findBatchWinsScalar(&Batch, scalar_wins);
+  for (board = 0; board < TEST_BATCH_BOARDS; ++board) {
+    uint8_t expected = (hasConnectFour(masks[RED][board]) << RED) |
+                       (hasConnectFour(masks[YELLOW][board]) << YELLOW);
+    Result.checked++;
+    if (wins[board] != expected || build_wins[board] != expected ||
+        scalar_wins[board] != expected) {
+      Result.failed++;
+    }
+  }
+  return Result;
+}
+
+static TestResult testEvaluation(uint64_t* random_state) {
+  TestResult Result = {0, 0};
+  int game;
+  for (game = 0; game < TEST_EVALUATION_GAMES; ++game) {
+    Position position = createPosition();
+    Evaluation evaluation = createEvaluation(&position);
+    boolean won = FALSE;
+    while (!won && !isBoardFull(&position)) {
+      int col = nextRandom(random_state) % BOARD_WIDTH;
+      if (!canPlay(&position, col)) {
+        continue;
+      }
+      won = isWinningMove(&position, col);
+      addEvaluationToken(&evaluation, &position, col);
+      playMove(&position, col);
+
+      Evaluation scratch = createEvaluation(&position);
+      Result.checked++;
+      if (memcmp(&evaluation, &scratch, sizeof(evaluation)) != 0 ||
+          evaluatePosition(&evaluation, &position) !=
+              evaluatePosition(&scratch, &position)) {
+        Result.failed++;
+      }
+    }
+  }
+  return Result;
+}
+
+static TestResult testEvaluationMirror(uint64_t* random_state) {
+  TestResult Result = {0, 0};
+  int game;
+  for (game = 0; game < TEST_EVALUATION_GAMES; ++game) {
+    Position position = createPosition();
+    Position mirror = createPosition();
+    while (!isBoardFull(&position)) {
+      int col = nextRandom(random_state) % BOARD_WIDTH;
+      if (!canPlay(&position, col)) {
+        continue;
+      }
+      if (isWinningMove(&position, col)) {
+        break;
+      }
+      playMove(&position, col);
+      playMove(&mirror, BOARD_WIDTH - 1 - col);
+
+      Evaluation evaluation = createEvaluation(&position);
+      Evaluation mirror_evaluation = createEvaluation(&mirror);
+      Result.checked++;
+      if (evaluatePosition(&evaluation, &position) !=
+          evaluatePosition(&mirror_evaluation, &mirror)) {
+        Result.failed++;
+      }
+    }
+  }
+  return Result;
+}
+
+#ifdef TEST_OPENINGS
+static TestResult testEvaluationOpenings() {
+  TestResult Result = {0, 0};
+  TranspositionTable table;
+  if (createTranspositionTable(&table, DEFAULT_HASH_MEGABYTES) == -1) {
+    perror("testEvaluationOpenings->createTranspositionTable");
+    Result.failed++;
+    return Result;
+  }
+
+  Position empty = createPosition();
+  Evaluation empty_evaluation = createEvaluation(&empty);
+  int depth;
+  for (depth = TEST_OPENING_MIN_DEPTH; depth <= TEST_OPENING_MAX_DEPTH;
+       ++depth) {
+    SearchLimits limits = createSearchLimits(depth, 0);
+    limits.evaluation = &empty_evaluation;
+    clearTranspositionTable(&table);
+    SearchResult Searched = searchBestMove(&empty, limits, &table, NULL);
+    Result.checked++;
+    if (Searched.best_move != BOARD_WIDTH / 2) {
+      Result.failed++;
+    }
+  }
+
+  // The score of a first move is the opponent's score negated.
+  int scores[BOARD_WIDTH];
+  int col;
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    Position position = empty;
+    playMove(&position, col);
+    Evaluation evaluation = createEvaluation(&position);
+    SearchLimits limits = createSearchLimits(TEST_OPENING_RANK_DEPTH - 1, 0);
+    limits.evaluation = &evaluation;
+    clearTranspositionTable(&table);
+    scores[col] = -searchBestMove(&position, limits, &table, NULL).score;
+  }
+  for (col = 0; col < BOARD_WIDTH; ++col) {
+    if (col == BOARD_WIDTH / 2) {
+      continue;
+    }
+    Result.checked++;
+    if (scores[col] >= scores[BOARD_WIDTH / 2]) {
+      Result.failed++;
+    }
+  }
+
+  destroyTranspositionTable(&table);
+  return Result;
+}
+#endif
+
+static TestResult testPonderStop(uint64_t* random_state) {
+  TestResult Result = {0, 0};
+  int keys[2];
+  int saved_input = dup(STDIN_FILENO);
+  int saved_output = dup(STDOUT_FILENO);
+  int null_output = open("/dev/null", O_WRONLY);
+  if (saved_input == -1 || saved_output == -1 || null_output == -1 ||
+      pipe(keys) == -1) {
+    fprintf(stderr, "testPonderStop: cannot redirect the terminal\n");
+    return Result;
+  }
+  dup2(keys[0], STDIN_FILENO);
+  dup2(null_output, STDOUT_FILENO);
+
+  char error_message[50] = NO_ERRORS;
+  TerminalSettings Terminal;
+  Terminal.screen_rows = 24;
+  Terminal.screen_cols = 80;
+  static GameData Game;
+  Game = createGameData(&Terminal);
+  GameOptions Options;
+  memset(&Options, 0, sizeof(Options));
+  Options.computer_opponent = TRUE;
+  Options.computer_limits = createSearchLimits(TEST_PONDER_DEPTH, 0);
+  Options.evaluate = TRUE;
+  Options.ponder = TRUE;
+
+  // A failed initialization leaves no rounds checked, which fails the check.
+  int rounds = initializeInputEvents(error_message) == 0 ? TEST_PONDER_ROUNDS
+                                                          : 0;
+  int round;
+  for (round = 0; round < rounds; ++round) {
+    Game.state.position = createRandomPosition(random_state, BOARD_CELLS / 2);
+    Game.evaluation = createEvaluation(&Game.state.position);
+    startPondering(&Game, &Options);
+    stopPondering();
+
+    char key;
+    int input = playerInputReaderUntil(
+        &key, currentTimeNs() + TEST_PONDER_WAIT_MS * 1000000LL,
+        error_message);
+    // The prompt is answered yes and no in turns.
+    boolean again = round % 2 == 0;
+    ssize_t written = write(keys[1], again ? "y" : "n", 1);
+    boolean answer = endGame(&Game, error_message);
+    ++Result.checked;
+    if (input != INPUT_TIMEOUT || written != 1 || answer != again) {
+      ++Result.failed;
+    }
+  }
+
+  dup2(saved_input, STDIN_FILENO);
+  dup2(saved_output, STDOUT_FILENO);
+  close(saved_input);
+  close(saved_output);
+  close(null_output);
+  close(keys[0]);
+  close(keys[1]);
+  return Result;
+}
+
+static TestResult testSolver(uint64_t* random_state) {
+  TestResult Result = {0, 0};
+  TranspositionTable table;
+  if (createTranspositionTable(&table, DEFAULT_HASH_MEGABYTES) == -1) {
+    perror("testSolver->createTranspositionTable");
+    Result.failed++;
+    return Result;
+  }
+
+  int i;
+  for (i = 0; i < TEST_SOLVE_POSITIONS; ++i) {
+    Position position =
+        createRandomPosition(random_state, TEST_SOLVE_EMPTY_CELLS);
+    SolveResult Solved;
+    solvePosition(&position, &table, &Solved);
+    int expected = findReferenceScore(&position, -WIN_SCORE, WIN_SCORE);
+
+    // The best move has to keep the score: a win on the spot or a position
+    // worth the score for the opponent.
+    boolean best_move_valid = Solved.best_move >= 0 &&
+                              Solved.best_move < BOARD_WIDTH &&
+                              canPlay(&position, Solved.best_move);
+    if (best_move_valid && !isWinningMove(&position, Solved.best_move)) {
+      Position child = position;
+      playMove(&child, Solved.best_move);
+      best_move_valid =
+          -findReferenceScore(&child, -WIN_SCORE, WIN_SCORE) == expected;
+    }
+    Result.checked++;
+    if (Solved.score != expected || !best_move_valid) {
+      Result.failed++;
+    }
+  }
+
+  destroyTranspositionTable(&table);
+  return Result;
+}
+
+static TestResult testTablebase(uint64_t* random_state) {
+  TestResult Result = {0, 0};
+  TablebaseOptions Build;
+  Build.root = createRandomPosition(random_state, TEST_TABLEBASE_EMPTY_CELLS);
+  Build.min_tokens = Build.root.move_counter;
+  Build.threads = 2;
+  Build.memory_megabytes = 16;
+
+  char path[] = "test_tablebase_XXXXXX";
+  TablebaseStats stats;
+  if (writeTestFile(path, "", 0) == -1 ||
+      createTablebaseFile(path, &Build, &stats) == -1) {
+    perror("testTablebase->createTablebaseFile");
+    unlink(path);
+    Result.failed++;
+    return Result;
+  }
+
+  Tablebase tablebase;
+  TranspositionTable table;
+  if (openTablebase(path, &tablebase) == -1 ||
+      createTranspositionTable(&table, DEFAULT_HASH_MEGABYTES) == -1) {
+    perror("testTablebase->openTablebase");
+    unlink(path);
+    Result.failed++;
+    return Result;
+  }
+  testTablebaseLevels(&tablebase, &Build.root, &table, &Result);
+  destroyTranspositionTable(&table);
+
+  // A position count past what the blocks of its level hold, and the file
+  // cut short, are both refused when the tablebase is opened.
+  size_t size = tablebase.mapping_size;
+  uint8_t* bytes = malloc(size);
+  memcpy(bytes, tablebase.mapping, size);
+  closeTablebase(&tablebase);
+  unlink(path);
+  TablebaseHeader* header = (TablebaseHeader*)bytes;
+  header->levels[Build.min_tokens].position_count +=
+      TABLEBASE_BLOCK_POSITIONS;
+  char corrupt_path[] = "test_tablebase_XXXXXX";
+  Result.checked++;
+  if (writeTestFile(corrupt_path, bytes, size) == -1 ||
+      openTablebase(corrupt_path, &tablebase) != -1) {
+    Result.failed++;
+  }
+  unlink(corrupt_path);
+  header->levels[Build.min_tokens].position_count -=
+      TABLEBASE_BLOCK_POSITIONS;
+  char truncated_path[] = "test_tablebase_XXXXXX";
+  Result.checked++;
+  if (writeTestFile(truncated_path, bytes, size - 1) == -1 ||
+      openTablebase(truncated_path, &tablebase) != -1) {
+    Result.failed++;
+  }
+  unlink(truncated_path);
+  free(bytes);
+  return Result;
+}
+
+static void testTablebaseLevels(const Tablebase* tablebase,
+                                const Position* root,
+                                TranspositionTable* table,
+                                TestResult* result) {
+  bitboard* level = malloc(sizeof(bitboard));
+  bitboard* next_level = NULL;
+  size_t level_size = 1;
+  level[0] = findPositionKey(root);
+
+  while (level_size > 0) {
+    // Every position has at most BOARD_WIDTH children.
+    bitboard* grown =
+        realloc(next_level, level_size * BOARD_WIDTH * sizeof(bitboard));
+    if (grown == NULL) {
+      result->failed++;
+      break;
+    }
+    next_level = grown;
+    size_t next_size = 0;
+    size_t index;
+    for (index = 0; index < level_size; ++index) {
+      Position position = createPositionFromKey(level[index]);
+      SolveResult Solved;
+      solvePosition(&position, table, &Solved);
+      int expected = Solved.score > 0   ? TABLEBASE_WIN
+                     : Solved.score < 0 ? TABLEBASE_LOSS
+                                        : TABLEBASE_DRAW;
+      result->checked++;
+      if (probeTablebase(tablebase, &position) != expected) {
+        result->failed++;
+      }
+
+      int col;
+      for (col = 0; col < BOARD_WIDTH; ++col) {
+        if (!canPlay(&position, col) || isWinningMove(&position, col)) {
+          continue;
+        }
+        Position child = position;
+        playMove(&child, col);
+        if (!isBoardFull(&child)) {
+          next_level[next_size++] = findPositionKey(&child);
+        }
+      }
+    }
+
+    // The next level is sorted so that every position is kept once.
+    qsort(next_level, next_size, sizeof(bitboard), compareKeys);
+    grown = realloc(level, (next_size + 1) * sizeof(bitboard));
+    if (grown == NULL) {
+      result->failed++;
+      break;
+    }
+    level = grown;
+    level_size = 0;
+    for (index = 0; index < next_size; ++index) {
+      if (index == 0 || next_level[index] != next_level[index - 1]) {
+        level[level_size++] = next_level[index];
+      }
+    }
+  }
+  free(level);
+  free(next_level);
+}
+
+static int writeTestFile(char* path, const void* bytes, size_t length) {
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    return -1;
+  }
+  ssize_t written = write(fd, bytes, length);
+  close(fd);
+  return written == (ssize_t)length ? 0 : -1;
+}
+
+/*** Main ***/
+
+int main() {
+  uint64_t random_state = TEST_SEED;
+  int failed = 0;
+  failed |= printTestResult("batchWins", testBatchWins(&random_state));
+  failed |= printTestResult("evaluation", testEvaluation(&random_state));
+  failed |= printTestResult("evaluationMirror",
+                            testEvaluationMirror(&random_state));
+#ifdef TEST_OPENINGS
+  failed |= printTestResult("evaluationOpenings", testEvaluationOpenings());
+#endif
+  failed |= printTestResult("ponderStop", testPonderStop(&random_state));
+  failed |= printTestResult("solve", testSolver(&random_state));
+  failed |= printTestResult("tablebase", testTablebase(&random_state));
+  printf("batch_wins_kernel %s\n", findBatchWinsKernel());
+  return failed;
+}
@@ -0,0 +1,144 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "transposition.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*** Define ***/
+
+#define BEST_MOVE_SHIFT 26
+#define BOUND_SHIFT 24
+#define DEPTH_SHIFT 16
+#define GENERATION_SHIFT 32
+#define SCORE_OFFSET 32768
+
+/*** Declorations ***/
+
+// findBucket returns the bucket the key hashes to. Position keys are very
+// regular, so they are scrambled with a multiplicative hash first.
+static TranspositionBucket* findBucket(const TranspositionTable* table,
+                                       bitboard key);
+
+// loadSlot reads the slot and returns the key it belongs to, 0 if the slot is
+// empty or torn.
+static bitboard loadSlot(const TranspositionSlot* slot, uint64_t* out_data);
+
+// packEntry packs the entry and the generation into the data word of a slot.
+static uint64_t packEntry(TranspositionEntry entry, uint8_t generation);
+
+// storeSlot writes the key and data to the slot.
+static void storeSlot(TranspositionSlot* slot, bitboard key, uint64_t data);
+
+// unpackEntry returns the entry held in the data word of a slot.
+static TranspositionEntry unpackEntry(uint64_t data);
+
+/*** Functions ***/
+
+void ageTranspositionTable(TranspositionTable* table) { table->generation++; }
+
+void clearTranspositionTable(TranspositionTable* table) {
+  memset(table->buckets, 0,
+         (table->bucket_mask + 1) * sizeof(TranspositionBucket));
+  table->generation = 0;
+}
+
+int createTranspositionTable(TranspositionTable* table, int megabytes) {
+  uint64_t bytes = (uint64_t)megabytes * 1024 * 1024;
+  uint64_t bucket_count = 1;
+  while (bucket_count * 2 * sizeof(TranspositionBucket) <= bytes) {
+    bucket_count *= 2;
+  }
+
+  table->buckets = calloc(bucket_count, sizeof(TranspositionBucket));
+  if (table->buckets == NULL) {
+    return -1;
+  }
+  table->bucket_mask = bucket_count - 1;
+  table->generation = 0;
+  return 0;
+}
+
+void destroyTranspositionTable(TranspositionTable* table) {
+  free(table->buckets);
+  table->buckets = NULL;
+}
+
+static TranspositionBucket* findBucket(const TranspositionTable* table,
+                                       bitboard key) {
+  uint64_t hash = (uint64_t)key * 0x9e3779b97f4a7c15ULL;
+  return &table->buckets[(hash >> 32) & table->bucket_mask];
+}
+
+static bitboard loadSlot(const TranspositionSlot* slot, uint64_t* out_data) {
+  uint64_t checked_key = __atomic_load_n(&slot->checked_key, __ATOMIC_RELAXED);
+  *out_data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+  return checked_key ^ *out_data;
+}
+
+static uint64_t packEntry(TranspositionEntry entry, uint8_t generation) {
+  return (uint64_t)(entry.score + SCORE_OFFSET) |
+         (uint64_t)entry.depth << DEPTH_SHIFT |
+         (uint64_t)entry.bound << BOUND_SHIFT |
+         (uint64_t)entry.best_move << BEST_MOVE_SHIFT |
+         (uint64_t)generation << GENERATION_SHIFT;
+}
+
+boolean probeTranspositionTable(const TranspositionTable* table, bitboard key,
+                                TranspositionEntry* out_entry) {
+  TranspositionBucket* bucket = findBucket(table, key);
+  int i;
+  for (i = 0; i < 2; ++i) {
+    uint64_t data;
+    if (loadSlot(&bucket->slots[i], &data) == key) {
+      *out_entry = unpackEntry(data);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+void storeTranspositionEntry(TranspositionTable* table, bitboard key,
+                             TranspositionEntry entry) {
+  TranspositionBucket* bucket = findBucket(table, key);
+  uint64_t data = packEntry(entry, table->generation);
+  uint64_t deep_data, always_data;
+  bitboard deep_key = loadSlot(&bucket->slots[0], &deep_data);
+  bitboard always_key = loadSlot(&bucket->slots[1], &always_data);
+
+  // A position already in the always replaced slot is updated in place so the
+  // bucket never holds the same key twice.
+  if (always_key == key && deep_key != key) {
+    storeSlot(&bucket->slots[1], key, data);
+    return;
+  }
+
+  TranspositionEntry stored = unpackEntry(deep_data);
+  uint8_t stored_generation = deep_data >> GENERATION_SHIFT;
+  if (deep_key == key || deep_key == 0 ||
+      stored_generation != table->generation || entry.depth >= stored.depth) {
+    // The entry pushed out of the depth preferred slot is still worth keeping
+    // for a while.
+    if (deep_key != key && deep_key != 0) {
+      storeSlot(&bucket->slots[1], deep_key, deep_data);
+    }
+    storeSlot(&bucket->slots[0], key, data);
+  } else {
+    storeSlot(&bucket->slots[1], key, data);
+  }
+}
+
+static void storeSlot(TranspositionSlot* slot, bitboard key, uint64_t data) {
+  __atomic_store_n(&slot->checked_key, key ^ data, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+}
+
+static TranspositionEntry unpackEntry(uint64_t data) {
+  TranspositionEntry Entry;
+  Entry.score = (int)(data & 0xffff) - SCORE_OFFSET;
+  Entry.depth = (data >> DEPTH_SHIFT) & 0xff;
+  Entry.bound = (data >> BOUND_SHIFT) & 0x3;
+  Entry.best_move = (data >> BEST_MOVE_SHIFT) & 0xf;
+  return Entry;
+}
@@ -0,0 +1,84 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdint.h>
+
+#include "bitboard.h"
+
+/*** Define ***/
+
+#define DEFAULT_HASH_MEGABYTES 64
+#define NO_MOVE 0xf
+
+/*** Enum ***/
+
+enum bound { EXACT_BOUND, LOWER_BOUND, UPPER_BOUND };
+
+/*** Structures ***/
+
+// TranspositionEntry is the unpacked form of a table entry. score is the
+// search score, depth the plies searched below the position, bound says whether
+// score is exact or a lower or upper bound, and best_move is the column that
+// produced score or NO_MOVE.
+typedef struct TranspositionEntry {
+  int score;
+  int depth;
+  int bound;
+  int best_move;
+} TranspositionEntry;
+
+// TranspositionSlot is one packed entry. data holds the packed
+// TranspositionEntry and the generation of the search that stored it.
+// checked_key is the unique position key from findPositionKey, which already
+// tells the player to move apart, xored with data. Search threads share the
+// table without locks, and a slot torn by two threads writing at once no
+// longer matches any key, so it reads as a miss instead of a wrong entry.
+typedef struct TranspositionSlot {
+  uint64_t checked_key;
+  uint64_t data;
+} TranspositionSlot;
+
+// A bucket holds a depth preferred slot and an always replaced slot. Two
+// buckets fit in a 64 byte cache line.
+typedef struct TranspositionBucket {
+  TranspositionSlot slots[2];
+} TranspositionBucket;
+
+typedef struct TranspositionTable {
+  TranspositionBucket* buckets;
+  uint64_t bucket_mask;
+  uint8_t generation;
+} TranspositionTable;
+
+/*** Declorations ***/
+
+// ageTranspositionTable starts a new search generation. Entries from older
+// generations are replaced first.
+void ageTranspositionTable(TranspositionTable* table);
+
+// clearTranspositionTable empties every slot of the table.
+void clearTranspositionTable(TranspositionTable* table);
+
+// createTranspositionTable allocates the largest power of two number of
+// buckets that fits in megabytes. Returns -1 if the allocation fails, 0
+// otherwise.
+int createTranspositionTable(TranspositionTable* table, int megabytes);
+
+// destroyTranspositionTable frees the memory of the table.
+void destroyTranspositionTable(TranspositionTable* table);
+
+// probeTranspositionTable returns TRUE and fills out_entry if the key is in the
+// table, FALSE otherwise.
+boolean probeTranspositionTable(const TranspositionTable* table, bitboard key,
+                                TranspositionEntry* out_entry);
+
+// storeTranspositionEntry saves the entry for the key. The depth preferred
+// slot is only replaced by an entry at least as deep or by a newer generation,
+// otherwise the entry goes in the always replaced slot.
+void storeTranspositionEntry(TranspositionTable* table, bitboard key,
+                             TranspositionEntry entry);
+
+#endif
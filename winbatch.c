@@ -0,0 +1,163 @@
+// Connect Four
+// Author: Scott Helms
+
+#include "winbatch.h"
+
+#include <string.h>
+
+/*** Define ***/
+
+// The vector kernels are written with the vector extension of GCC and Clang,
+// which compiles them to whatever SIMD the target has. x86-64 always has
+// SSE2 and picks AVX2 at run time.
+#if defined(__GNUC__)
+#define WIN_BATCH_VECTOR
+#endif
+#if defined(WIN_BATCH_VECTOR) && defined(__x86_64__)
+#define WIN_BATCH_AVX2
+#endif
+
+/*** Structures ***/
+
+#ifdef WIN_BATCH_VECTOR
+// BitboardLanes holds the same mask of WIN_BATCH_LANES boards.
+typedef bitboard BitboardLanes
+    __attribute__((vector_size(WIN_BATCH_LANES * sizeof(bitboard))));
+#endif
+
+/*** Declorations ***/
+
+// findBoardWins returns the tokens with a connect four on board i.
+static uint8_t findBoardWins(const WinBatch* batch, size_t i);
+
+#ifdef WIN_BATCH_VECTOR
+// addLanesInARow is findFourInARow on every lane of mask at once, or'ed into
+// lines. The lanes are passed by pointer, a vector wider than the build's
+// registers has no agreed way to be passed by value.
+static inline void addLanesInARow(const BitboardLanes* mask, int vector,
+                                  BitboardLanes* lines)
+    __attribute__((always_inline));
+
+// findLaneWins checks the WIN_BATCH_LANES boards from board i. It is inlined
+// into every kernel, so each is compiled with its own instruction set.
+static inline void findLaneWins(const WinBatch* batch, size_t i,
+                                uint8_t* out_wins)
+    __attribute__((always_inline));
+
+// findVectorWins checks every whole group of WIN_BATCH_LANES boards with the
+// instruction set of the build. Returns the number of boards checked.
+static size_t findVectorWins(const WinBatch* batch, uint8_t* out_wins);
+#endif
+
+#ifdef WIN_BATCH_AVX2
+// findAvx2Wins is findVectorWins compiled for AVX2.
+static size_t findAvx2Wins(const WinBatch* batch, uint8_t* out_wins)
+    __attribute__((target("avx2")));
+#endif
+
+/*** Functions ***/
+
+void findBatchWins(const WinBatch* batch, uint8_t* out_wins) {
+  size_t i = 0;
+#if defined(WIN_BATCH_AVX2)
+  i = __builtin_cpu_supports("avx2") ? findAvx2Wins(batch, out_wins)
+                                     : findVectorWins(batch, out_wins);
+#elif defined(WIN_BATCH_VECTOR)
+  i = findVectorWins(batch, out_wins);
+#endif
+  // The boards after the last whole group of lanes.
+  for (; i < batch->count; ++i) {
+    out_wins[i] = findBoardWins(batch, i);
+  }
+}
+
+void findBatchWinsBuild(const WinBatch* batch, uint8_t* out_wins) {
+  size_t i = 0;
+#ifdef WIN_BATCH_VECTOR
+  i = findVectorWins(batch, out_wins);
+#endif
+  for (; i < batch->count; ++i) {
+    out_wins[i] = findBoardWins(batch, i);
+  }
+}
+
+void findBatchWinsScalar(const WinBatch* batch, uint8_t* out_wins) {
+  size_t i;
+  for (i = 0; i < batch->count; ++i) {
+    out_wins[i] = findBoardWins(batch, i);
+  }
+}
+
+const char* findBatchWinsKernel() {
+#if defined(WIN_BATCH_AVX2)
+  return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#elif defined(WIN_BATCH_VECTOR)
+  return "vector";
+#else
+  return "scalar";
+#endif
+}
+
+static uint8_t findBoardWins(const WinBatch* batch, size_t i) {
+  return hasConnectFour(batch->player_masks[RED][i]) << RED |
+         hasConnectFour(batch->player_masks[YELLOW][i]) << YELLOW;
+}
+
+#ifdef WIN_BATCH_VECTOR
+static inline void addLanesInARow(const BitboardLanes* mask, int vector,
+                                  BitboardLanes* lines) {
+  int shift = vectorShift(vector);
+  BitboardLanes runs = *mask;
+  int length = 1;
+  while (2 * length <= CONNECT_LENGTH) {
+    runs &= runs >> (length * shift);
+    length *= 2;
+  }
+  if (length < CONNECT_LENGTH) {
+    runs &= runs >> ((CONNECT_LENGTH - length) * shift);
+  }
+  *lines |= runs;
+}
+
+static inline void findLaneWins(const WinBatch* batch, size_t i,
+                                uint8_t* out_wins) {
+  BitboardLanes red, yellow;
+  memcpy(&red, batch->player_masks[RED] + i, sizeof(red));
+  memcpy(&yellow, batch->player_masks[YELLOW] + i, sizeof(yellow));
+  BitboardLanes red_lines = red ^ red;
+  BitboardLanes yellow_lines = yellow ^ yellow;
+  addLanesInARow(&red, HORIZONTAL, &red_lines);
+  addLanesInARow(&red, LEFTDIAG, &red_lines);
+  addLanesInARow(&red, VERTICAL, &red_lines);
+  addLanesInARow(&red, RIGHTDIAG, &red_lines);
+  addLanesInARow(&yellow, HORIZONTAL, &yellow_lines);
+  addLanesInARow(&yellow, LEFTDIAG, &yellow_lines);
+  addLanesInARow(&yellow, VERTICAL, &yellow_lines);
+  addLanesInARow(&yellow, RIGHTDIAG, &yellow_lines);
+  // A lane compares to all ones when it holds a line.
+  BitboardLanes wins = ((red_lines != 0) & (1 << RED)) |
+                       ((yellow_lines != 0) & (1 << YELLOW));
+  int lane;
+  for (lane = 0; lane < WIN_BATCH_LANES; ++lane) {
+    out_wins[i + lane] = wins[lane];
+  }
+}
+
+static size_t findVectorWins(const WinBatch* batch, uint8_t* out_wins) {
+  size_t i;
+  for (i = 0; i + WIN_BATCH_LANES <= batch->count; i += WIN_BATCH_LANES) {
+    findLaneWins(batch, i, out_wins);
+  }
+  return i;
+}
+#endif
+
+#ifdef WIN_BATCH_AVX2
+static size_t findAvx2Wins(const WinBatch* batch, uint8_t* out_wins) {
+  size_t i;
+  for (i = 0; i + WIN_BATCH_LANES <= batch->count; i += WIN_BATCH_LANES) {
+    findLaneWins(batch, i, out_wins);
+  }
+  return i;
+}
+#endif
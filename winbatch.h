@@ -0,0 +1,48 @@
+// Connect Four
+// Author: Scott Helms
+
+#ifndef WINBATCH_H
+#define WINBATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitboard.h"
+
+/*** Define ***/
+
+// WIN_BATCH_LANES is the number of boards the vector kernels check at once.
+#define WIN_BATCH_LANES 4
+
+/*** Structures ***/
+
+// WinBatch is count positions in structure of arrays layout: the masks of
+// every position's RED tokens in one array and its YELLOW tokens in another,
+// so the kernels load the same mask of neighbouring boards in one go.
+typedef struct WinBatch {
+  const bitboard* player_masks[2];
+  size_t count;
+} WinBatch;
+
+/*** Declorations ***/
+
+// findBatchWins sets out_wins[i] to the tokens with a connect four on board
+// i, 1 << RED and 1 << YELLOW or'ed together, 0 for neither. The boards are
+// checked WIN_BATCH_LANES at a time with AVX2 where the processor has it and
+// with the SIMD of the build otherwise, SSE2 on x86-64. Compilers without
+// vector extensions check them one at a time like findBatchWinsScalar.
+void findBatchWins(const WinBatch* batch, uint8_t* out_wins);
+
+// findBatchWinsBuild is findBatchWins on the SIMD of the build only, never
+// AVX2, so the kernels can be checked against each other on one processor.
+void findBatchWinsBuild(const WinBatch* batch, uint8_t* out_wins);
+
+// findBatchWinsScalar is findBatchWins one board at a time with
+// hasConnectFour.
+void findBatchWinsScalar(const WinBatch* batch, uint8_t* out_wins);
+
+// findBatchWinsKernel returns the name of the kernel findBatchWins runs on
+// this processor.
+const char* findBatchWinsKernel();
+
+#endif